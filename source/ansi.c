@@ -34,6 +34,7 @@
 #include "states.h"
 #include "screen.h"
 #include "netclient.h"
+#include "session.h"
 #include "ansi.h"
 
 /* Set this to a not-NULL value to enable debug log. */
@@ -117,6 +118,48 @@ void ansi_reset() {
     DLOG(("ansi_reset()\n"));
 }
 
+/**
+ * The ANSI emulator state that is saved with a session.
+ */
+struct ansi_session {
+    SCAN_STATE scan_state;
+    int saved_cursor_x;
+    int saved_cursor_y;
+    wchar_t rep_character;
+    Q_BOOL private_mode_flag;
+    Q_BOOL dec_private_mode_flag;
+    Q_BOOL discard_mode_flag;
+    unsigned char music_buffer[ANSI_MUSIC_BUFFER_SIZE];
+    int music_buffer_n;
+    attr_t old_character_color;
+};
+
+/**
+ * Save or restore the ANSI emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t ansi_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct ansi_session * saved = (struct ansi_session *) buffer;
+
+    if ((op == Q_SESSION_SAVE) || (op == Q_SESSION_RESTORE)) {
+        Q_SESSION_COPY(op, saved->scan_state, scan_state);
+        Q_SESSION_COPY(op, saved->saved_cursor_x, saved_cursor_x);
+        Q_SESSION_COPY(op, saved->saved_cursor_y, saved_cursor_y);
+        Q_SESSION_COPY(op, saved->rep_character, rep_character);
+        Q_SESSION_COPY(op, saved->private_mode_flag, private_mode_flag);
+        Q_SESSION_COPY(op, saved->dec_private_mode_flag,
+                       dec_private_mode_flag);
+        Q_SESSION_COPY(op, saved->discard_mode_flag, discard_mode_flag);
+        Q_SESSION_COPY(op, saved->music_buffer, music_buffer);
+        Q_SESSION_COPY(op, saved->music_buffer_n, music_buffer_n);
+        Q_SESSION_COPY(op, saved->old_character_color, old_character_color);
+    }
+    return sizeof(struct ansi_session);
+}
+
 /**
  * Reset the scan state for a new sequence.
  *
@@ -883,7 +926,6 @@ static Q_BOOL ansi_cha(unsigned char ** count) {
  * @return true if the parameters were parsed successfully
  */
 static Q_BOOL ansi_rep(unsigned char ** count) {
-    int i;
     int ps;
     int rep_count = -1;
 
@@ -951,9 +993,7 @@ static Q_BOOL ansi_rep(unsigned char ** count) {
     } /* while (*count < q_emul_buffer + sizeof(q_emul_buffer)) */
 
     DLOG(("ANSI REP: %d\n", rep_count));
-    for (i = 0; i < rep_count; i++) {
-        print_character(rep_character);
-    }
+    print_character_repeat(rep_character, rep_count);
 
     return Q_TRUE;
 }
@@ -25,6 +25,7 @@
 #include "scrollback.h"
 #include "options.h"
 #include "ansi.h"
+#include "session.h"
 #include "atascii.h"
 
 /* Set this to a not-NULL value to enable debug log. */
@@ -198,6 +199,36 @@ void atascii_reset() {
     reset_tab_stops();
 }
 
+/**
+ * Save or restore the ATASCII emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t atascii_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct atari_state * saved = (struct atari_state *) buffer;
+
+    switch (op) {
+    case Q_SESSION_SAVE:
+    case Q_SESSION_RESTORE:
+        Q_SESSION_COPY(op, *saved, state);
+        break;
+    case Q_SESSION_FREE:
+        if (state.tab_stops != NULL) {
+            Xfree(state.tab_stops, __FILE__, __LINE__);
+        }
+        /* Fall through... */
+    case Q_SESSION_DETACH:
+        state.tab_stops = NULL;
+        state.tab_stops_n = 0;
+        break;
+    case Q_SESSION_SIZE:
+        break;
+    }
+    return sizeof(struct atari_state);
+}
+
 /**
  * Process a special ATASCII control character.
  *
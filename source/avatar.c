@@ -25,6 +25,7 @@
 #include "scrollback.h"
 #include "options.h"
 #include "ansi.h"
+#include "session.h"
 #include "avatar.h"
 
 /* Set this to a not-NULL value to enable debug log. */
@@ -69,10 +70,16 @@ static SCAN_STATE scan_state;
 /* For the ^Y and ^V^Y sequences. */
 static unsigned char y_char;
 static int y_count;
-static unsigned char * v_y_chars = NULL;
+static unsigned char v_y_chars[256];
 static int v_y_chars_i;
 static int v_y_chars_n;
 
+/**
+ * True while a ^V^Y pattern is being replayed.  A ^V^Y inside the pattern
+ * is dropped rather than nested.
+ */
+static Q_BOOL v_y_repeating = Q_FALSE;
+
 /* For the ^V^J and ^V^K sequences. */
 static Q_BOOL v_jk_scrollup;
 static int v_jk_numlines;
@@ -94,15 +101,62 @@ static int ansi_buffer_i;
  */
 void avatar_reset() {
     scan_state = SCAN_NONE;
-    if (v_y_chars != NULL) {
-        Xfree(v_y_chars, __FILE__, __LINE__);
-        v_y_chars = NULL;
-    }
     v_y_chars_i = 0;
     v_y_chars_n = 0;
     DLOG(("avatar_reset()\n"));
 }
 
+/**
+ * The Avatar emulator state that is saved with a session.
+ */
+struct avatar_session {
+    SCAN_STATE scan_state;
+    unsigned char y_char;
+    int y_count;
+    unsigned char v_y_chars[sizeof(v_y_chars)];
+    int v_y_chars_i;
+    int v_y_chars_n;
+    Q_BOOL v_jk_scrollup;
+    int v_jk_numlines;
+    int v_jk_upper;
+    int v_jk_left;
+    int v_jk_lower;
+    int v_jk_right;
+    unsigned char ansi_buffer[sizeof(q_emul_buffer)];
+    int ansi_buffer_n;
+    int ansi_buffer_i;
+};
+
+/**
+ * Save or restore the Avatar emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t avatar_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct avatar_session * saved = (struct avatar_session *) buffer;
+
+    if ((op == Q_SESSION_SAVE) || (op == Q_SESSION_RESTORE)) {
+        Q_SESSION_COPY(op, saved->scan_state, scan_state);
+        Q_SESSION_COPY(op, saved->y_char, y_char);
+        Q_SESSION_COPY(op, saved->y_count, y_count);
+        Q_SESSION_COPY(op, saved->v_y_chars, v_y_chars);
+        Q_SESSION_COPY(op, saved->v_y_chars_i, v_y_chars_i);
+        Q_SESSION_COPY(op, saved->v_y_chars_n, v_y_chars_n);
+        Q_SESSION_COPY(op, saved->v_jk_scrollup, v_jk_scrollup);
+        Q_SESSION_COPY(op, saved->v_jk_numlines, v_jk_numlines);
+        Q_SESSION_COPY(op, saved->v_jk_upper, v_jk_upper);
+        Q_SESSION_COPY(op, saved->v_jk_left, v_jk_left);
+        Q_SESSION_COPY(op, saved->v_jk_lower, v_jk_lower);
+        Q_SESSION_COPY(op, saved->v_jk_right, v_jk_right);
+        Q_SESSION_COPY(op, saved->ansi_buffer, ansi_buffer);
+        Q_SESSION_COPY(op, saved->ansi_buffer_n, ansi_buffer_n);
+        Q_SESSION_COPY(op, saved->ansi_buffer_i, ansi_buffer_i);
+    }
+    return sizeof(struct avatar_session);
+}
+
 /**
  * Reset the scan state for a new sequence.
  *
@@ -115,13 +169,8 @@ static void clear_state(wchar_t * to_screen) {
     memset(q_emul_buffer, 0, sizeof(q_emul_buffer));
     scan_state = SCAN_NONE;
     *to_screen = 1;
-
-    if (v_y_chars != NULL) {
-        Xfree(v_y_chars, __FILE__, __LINE__);
-        v_y_chars = NULL;
-        v_y_chars_i = 0;
-        v_y_chars_n = 0;
-    }
+    v_y_chars_i = 0;
+    v_y_chars_n = 0;
 }
 
 /**
@@ -201,6 +250,40 @@ static void avatar_set_color(const unsigned char from_modem) {
     DLOG(("new color: %04x\n", (unsigned int) q_current_color));
 }
 
+/**
+ * Replay a ^V^Y pattern through the emulator.  Runs of a single printable
+ * character go straight to the screen; anything else is pushed back through
+ * avatar() one byte at a time.
+ *
+ * @param pattern the bytes to repeat
+ * @param pattern_n the number of bytes in pattern
+ * @param times the number of times to repeat the pattern
+ */
+static void repeat_pattern(const unsigned char * pattern, const int pattern_n,
+                           int times) {
+    Q_EMULATION_STATUS rc;
+    wchar_t ch;
+    int i;
+
+    if ((pattern_n == 1) && !iscntrl(pattern[0])) {
+        print_character_repeat(codepage_map_char(pattern[0]), times);
+        return;
+    }
+
+    for (; times > 0; times--) {
+        for (i = 0; i < pattern_n; i++) {
+            rc = avatar(pattern[i], &ch);
+            while (rc == Q_EMUL_FSM_MANY_CHARS) {
+                print_character(ch);
+                rc = avatar(-1, &ch);
+            }
+            if (rc == Q_EMUL_FSM_ONE_CHAR) {
+                print_character(ch);
+            }
+        }
+    }
+}
+
 /**
  * Push one byte through the AVATAR emulator.
  *
@@ -218,6 +301,8 @@ Q_EMULATION_STATUS avatar(const unsigned char from_modem, wchar_t * to_screen) {
     int old_x;
     int old_y;
     int i;
+    unsigned char pattern[sizeof(v_y_chars)];
+    int pattern_n;
 
     DLOG(("STATE: %d CHAR: 0x%02x '%c'\n", scan_state, from_modem, from_modem));
 
@@ -395,6 +480,10 @@ avatar_start:
 
         DLOG(("RLE char '%c' count=%d\n", y_char, y_count));
 
+        if (!iscntrl(y_char)) {
+            print_character_repeat(codepage_map_char(y_char), y_count);
+            y_count = 0;
+        }
         scan_state = SCAN_Y_EMIT;
         /*
          * Fall through ...
@@ -500,13 +589,13 @@ repeat_loop:
     case SCAN_V_Y_1:
         save_char(from_modem, to_screen);
         v_y_chars_n = from_modem;
-        v_y_chars =
-            (unsigned char *) Xmalloc(sizeof(unsigned char) * (v_y_chars_n + 1),
-                                      __FILE__, __LINE__);
-        memset(v_y_chars, 0, sizeof(unsigned char) * (v_y_chars_n + 1));
         v_y_chars_i = 0;
 
-        scan_state = SCAN_V_Y_2;
+        if (v_y_chars_n == 0) {
+            scan_state = SCAN_V_Y_3;
+        } else {
+            scan_state = SCAN_V_Y_2;
+        }
         return Q_EMUL_FSM_NO_CHAR_YET;
 
     case SCAN_V_Y_2:
@@ -522,7 +611,8 @@ repeat_loop:
         y_count = from_modem;
         v_y_chars_i = 0;
 
-        DLOG(("RLE pattern '%s' count=%d\n", v_y_chars, y_count));
+        DLOG(("RLE pattern '%.*s' count=%d\n", v_y_chars_n, v_y_chars,
+                y_count));
         scan_state = SCAN_V_Y_EMIT;
 
         /*
@@ -531,20 +621,13 @@ repeat_loop:
     case SCAN_V_Y_EMIT:
 
         /*
-         * It's possible to repeat the entire state machine...ick.
+         * It's possible to repeat the entire state machine...ick.  The
+         * pattern is copied out first because replaying it reuses the scan
+         * state.
          */
-        q_emul_repeat_state_count = v_y_chars_n * y_count;
-        q_emul_repeat_state_buffer =
-            (unsigned char *) Xmalloc(sizeof(unsigned char) *
-                                      q_emul_repeat_state_count, __FILE__,
-                                      __LINE__);
-        while (y_count > 0) {
-            memcpy(q_emul_repeat_state_buffer + (v_y_chars_n * (y_count - 1)),
-                   v_y_chars, v_y_chars_n);
-            y_count--;
-        }
-        Xfree(v_y_chars, __FILE__, __LINE__);
-        v_y_chars = NULL;
+        pattern_n = v_y_chars_n;
+        memcpy(pattern, v_y_chars, pattern_n);
+        i = y_count;
 
         if (q_status.insert_mode == Q_TRUE) {
             /*
@@ -556,7 +639,13 @@ repeat_loop:
         } else {
             clear_state(to_screen);
         }
-        return Q_EMUL_FSM_REPEAT_STATE;
+
+        if (v_y_repeating == Q_FALSE) {
+            v_y_repeating = Q_TRUE;
+            repeat_pattern(pattern, pattern_n, i);
+            v_y_repeating = Q_FALSE;
+        }
+        return Q_EMUL_FSM_NO_CHAR_YET;
 
     case SCAN_V_M_1:
         save_char(from_modem, to_screen);
@@ -0,0 +1,223 @@
+/*
+ * batch.c
+ *
+ * qodem - Qodem Terminal Emulator
+ *
+ * Written 2003-2017 by Kevin Lamonte
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to the
+ * public domain worldwide. This software is distributed without any
+ * warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see
+ * <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+/*
+ * The --render batch mode runs captures and ANSI art through the emulator
+ * into an off-screen scrollback and saves the result as text or HTML,
+ * without ever starting curses.
+ *
+ * The emulators all share one set of global state, so files cannot be
+ * rendered on several threads at once.  Instead, on POSIX systems the
+ * files are divided between forked worker processes, each of which has its
+ * own copy of that state.
+ */
+
+#include "common.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef Q_PDCURSES_WIN32
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+#include "qodem.h"
+#include "console.h"
+#include "emulation.h"
+#include "scrollback.h"
+#include "session.h"
+#include "translate.h"
+#include "batch.h"
+
+/**
+ * How much of the input file to read at a time.
+ */
+#define BATCH_BUFFER_SIZE 65536
+
+/**
+ * Empty the scrollback and put the emulator back at its power-on state.
+ */
+static void batch_reset() {
+    scrollback_session_state(NULL, Q_SESSION_FREE);
+    q_status.scrollback_lines = 0;
+    new_scrollback_line();
+    q_scrollback_current = q_scrollback_last;
+    q_scrollback_position = q_scrollback_current;
+    q_status.cursor_x = 0;
+    q_status.cursor_y = 0;
+    reset_emulation();
+}
+
+/**
+ * Render one file and save it.
+ *
+ * @param filename the file to render
+ * @param type Q_CAPTURE_TYPE_NORMAL or Q_CAPTURE_TYPE_HTML
+ * @return true if the output was written successfully
+ */
+static Q_BOOL batch_render_file(const char * filename,
+                                const Q_CAPTURE_TYPE type) {
+
+    static unsigned char buffer[BATCH_BUFFER_SIZE];
+    const unsigned char * inbound_map;
+    char * output_filename;
+    size_t output_filename_n;
+    FILE * file;
+    size_t n;
+    size_t i;
+    Q_BOOL rc;
+
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        fprintf(stderr, _("Error opening file \"%s\" for reading: %s"),
+                filename, strerror(errno));
+        fprintf(stderr, "\n");
+        return Q_FALSE;
+    }
+
+    batch_reset();
+    inbound_map = translate_8bit_in_map();
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        for (i = 0; i < n; i++) {
+            console_emulate(inbound_map[buffer[i]]);
+        }
+    }
+    if (ferror(file)) {
+        fprintf(stderr, _("Error reading file \"%s\": %s"), filename,
+                strerror(errno));
+        fprintf(stderr, "\n");
+        fclose(file);
+        return Q_FALSE;
+    }
+    fclose(file);
+
+    output_filename_n = strlen(filename) + 6;
+    output_filename = (char *) Xmalloc(output_filename_n, __FILE__, __LINE__);
+    snprintf(output_filename, output_filename_n, "%s.%s", filename,
+             (type == Q_CAPTURE_TYPE_HTML ? "html" : "txt"));
+    rc = render_scrollback_file(output_filename, type);
+    Xfree(output_filename, __FILE__, __LINE__);
+    return rc;
+}
+
+/**
+ * Render every jobs'th file starting at first.
+ *
+ * @param files the files to render
+ * @param files_n the number of files
+ * @param type Q_CAPTURE_TYPE_NORMAL or Q_CAPTURE_TYPE_HTML
+ * @param first the index of the first file to render
+ * @param jobs the distance between files to render
+ * @return the number of files that could not be rendered
+ */
+static int batch_render_share(char * const files[], const int files_n,
+                              const Q_CAPTURE_TYPE type, const int first,
+                              const int jobs) {
+    int failed = 0;
+    int i;
+
+    for (i = first; i < files_n; i += jobs) {
+        if (batch_render_file(files[i], type) == Q_FALSE) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/**
+ * Render files through the emulator without a screen and save each one
+ * as text or HTML next to the original, e.g. "foo.ans" becomes
+ * "foo.ans.html".  The emulation, codepage, and screen size must already
+ * be set up.
+ *
+ * @param files the files to render
+ * @param files_n the number of files
+ * @param type Q_CAPTURE_TYPE_NORMAL or Q_CAPTURE_TYPE_HTML
+ * @param jobs the number of files to render at once, or 0 to use one per
+ * CPU
+ * @return the number of files that could not be rendered
+ */
+int batch_render(char * const files[], const int files_n,
+                 const Q_CAPTURE_TYPE type, int jobs) {
+#ifndef Q_PDCURSES_WIN32
+    pid_t pid;
+    int status;
+    int failed = 0;
+    int i;
+#endif
+
+    /*
+     * Nothing here may touch the screen.
+     */
+    q_status.beeps = Q_FALSE;
+    q_status.ansi_music = Q_FALSE;
+    q_status.xterm_mouse_reporting = Q_FALSE;
+    q_status.scrollback_enabled = Q_TRUE;
+    q_scrollback_max = 0;
+
+#ifdef Q_PDCURSES_WIN32
+    /*
+     * No fork() here: render everything in this process.
+     */
+    return batch_render_share(files, files_n, type, 0, 1);
+#else
+
+    if (jobs <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (jobs <= 0) {
+            jobs = 1;
+        }
+    }
+    if (jobs > files_n) {
+        jobs = files_n;
+    }
+    if (jobs <= 1) {
+        return batch_render_share(files, files_n, type, 0, 1);
+    }
+
+    fflush(NULL);
+    for (i = 0; i < jobs; i++) {
+        pid = fork();
+        if (pid == 0) {
+            /*
+             * Child: render my share and report how many failed.
+             */
+            status = batch_render_share(files, files_n, type, i, jobs);
+            fflush(NULL);
+            _exit(status > 255 ? 255 : status);
+        }
+        if (pid == -1) {
+            /*
+             * Could not start another worker: do this share here.
+             */
+            failed += batch_render_share(files, files_n, type, i, jobs);
+        }
+    }
+
+    while ((pid = wait(&status)) != -1) {
+        if (WIFEXITED(status)) {
+            failed += WEXITSTATUS(status);
+        } else {
+            failed++;
+        }
+    }
+    return failed;
+#endif
+}
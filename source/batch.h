@@ -0,0 +1,55 @@
+/*
+ * batch.h
+ *
+ * qodem - Qodem Terminal Emulator
+ *
+ * Written 2003-2017 by Kevin Lamonte
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to the
+ * public domain worldwide. This software is distributed without any
+ * warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see
+ * <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+/* Includes --------------------------------------------------------------- */
+
+#include "qodem.h"              /* Q_CAPTURE_TYPE */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defines ---------------------------------------------------------------- */
+
+/* Globals ---------------------------------------------------------------- */
+
+/* Functions -------------------------------------------------------------- */
+
+/**
+ * Render files through the emulator without a screen and save each one
+ * as text or HTML next to the original, e.g. "foo.ans" becomes
+ * "foo.ans.html".  The emulation, codepage, and screen size must already
+ * be set up.
+ *
+ * @param files the files to render
+ * @param files_n the number of files
+ * @param type Q_CAPTURE_TYPE_NORMAL or Q_CAPTURE_TYPE_HTML
+ * @param jobs the number of files to render at once, or 0 to use one per
+ * CPU
+ * @return the number of files that could not be rendered
+ */
+extern int batch_render(char * const files[], const int files_n,
+                        const Q_CAPTURE_TYPE type, int jobs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BATCH_H__ */
@@ -2004,172 +2004,151 @@ wchar_t codepage_map_char(const unsigned char ch) {
 }
 
 /**
- * Map a Unicode code point / glyph to a byte in a codepage.
- *
- * @param ch the Unicode code point.
- * @param codepage the codepage to look through.
- * @param success if true, the reverse mapping worked.
- * @return the 8-bit character in one of the 8-bit codepages.
+ * The number of slots in a reverse codepage map.  Must be a power of two
+ * and at least twice the size of a codepage.
  */
-extern wchar_t codepage_unmap_byte(const wchar_t ch, const Q_CODEPAGE codepage,
-                                   Q_BOOL * success) {
+#define CODEPAGE_UNMAP_SIZE     512
 
-    int i;
-    *success = Q_FALSE;
+/**
+ * A reverse codepage map: an open-addressed hash from Unicode code point to
+ * byte, built the first time the codepage is unmapped.
+ */
+struct codepage_unmap {
+    Q_BOOL built;
+    wchar_t glyph[CODEPAGE_UNMAP_SIZE];
+    short byte[CODEPAGE_UNMAP_SIZE];    /* -1 for an empty slot */
+};
 
-    assert(codepage != Q_CODEPAGE_DEC);
+/**
+ * The reverse maps for the 8-bit codepages.
+ */
+static struct codepage_unmap codepage_unmaps[Q_CODEPAGE_PHONEBOOK_MAX];
 
+/**
+ * Get the Unicode glyphs for an 8-bit codepage.
+ *
+ * @param codepage one of the 8-bit codepages
+ * @return the 256-entry glyph table
+ */
+static wchar_t * codepage_chars(const Q_CODEPAGE codepage) {
     switch (codepage) {
     case Q_CODEPAGE_CP437:
-        for (i = 0; i < 256; i++) {
-            if (cp437_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp437_chars;
     case Q_CODEPAGE_ISO8859_1:
-        for (i = 0; i < 256; i++) {
-            if (iso8859_1_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
-    case Q_CODEPAGE_DEC:
-    case Q_CODEPAGE_PETSCII:
-        /*
-         * BUG: should never get here
-         */
-        abort();
-        return 0;
+        return iso8859_1_chars;
     case Q_CODEPAGE_CP720:
-        for (i = 0; i < 256; i++) {
-            if (cp720_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp720_chars;
     case Q_CODEPAGE_CP737:
-        for (i = 0; i < 256; i++) {
-            if (cp737_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp737_chars;
     case Q_CODEPAGE_CP775:
-        for (i = 0; i < 256; i++) {
-            if (cp775_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp775_chars;
     case Q_CODEPAGE_CP850:
-        for (i = 0; i < 256; i++) {
-            if (cp850_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp850_chars;
     case Q_CODEPAGE_CP852:
-        for (i = 0; i < 256; i++) {
-            if (cp852_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp852_chars;
     case Q_CODEPAGE_CP857:
-        for (i = 0; i < 256; i++) {
-            if (cp857_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp857_chars;
     case Q_CODEPAGE_CP858:
-        for (i = 0; i < 256; i++) {
-            if (cp858_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp858_chars;
     case Q_CODEPAGE_CP860:
-        for (i = 0; i < 256; i++) {
-            if (cp860_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp860_chars;
     case Q_CODEPAGE_CP862:
-        for (i = 0; i < 256; i++) {
-            if (cp862_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp862_chars;
     case Q_CODEPAGE_CP863:
-        for (i = 0; i < 256; i++) {
-            if (cp863_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp863_chars;
     case Q_CODEPAGE_CP866:
-        for (i = 0; i < 256; i++) {
-            if (cp866_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp866_chars;
     case Q_CODEPAGE_CP1250:
-        for (i = 0; i < 256; i++) {
-            if (cp1250_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp1250_chars;
     case Q_CODEPAGE_CP1251:
-        for (i = 0; i < 256; i++) {
-            if (cp1251_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp1251_chars;
     case Q_CODEPAGE_CP1252:
-        for (i = 0; i < 256; i++) {
-            if (cp1252_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return cp1252_chars;
     case Q_CODEPAGE_KOI8_R:
-        for (i = 0; i < 256; i++) {
-            if (koi8_r_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
-        }
-        return 0;
+        return koi8_r_chars;
     case Q_CODEPAGE_KOI8_U:
-        for (i = 0; i < 256; i++) {
-            if (koi8_u_chars[i] == ch) {
-                *success = Q_TRUE;
-                return i;
-            }
+        return koi8_u_chars;
+    case Q_CODEPAGE_DEC:
+    case Q_CODEPAGE_PETSCII:
+    case Q_CODEPAGE_ATASCII:
+        break;
+    }
+
+    /*
+     * BUG: should never get here
+     */
+    abort();
+    return NULL;
+}
+
+/**
+ * Find the slot for a code point in a reverse codepage map: either the slot
+ * that holds it, or the empty slot where it belongs.
+ *
+ * @param unmap the reverse map
+ * @param ch the Unicode code point
+ * @return the slot index
+ */
+static int codepage_unmap_slot(const struct codepage_unmap * unmap,
+                               const wchar_t ch) {
+    int i;
+
+    i = (int) (((uint32_t) ch * 0x9E3779B1U) >> 23);
+    while ((unmap->byte[i] >= 0) && (unmap->glyph[i] != ch)) {
+        i = (i + 1) & (CODEPAGE_UNMAP_SIZE - 1);
+    }
+    return i;
+}
+
+/**
+ * Build the reverse map for an 8-bit codepage.  When several bytes show the
+ * same glyph, the lowest byte wins.
+ *
+ * @param codepage one of the 8-bit codepages
+ */
+static void build_codepage_unmap(const Q_CODEPAGE codepage) {
+    struct codepage_unmap * unmap = &codepage_unmaps[codepage];
+    wchar_t * chars = codepage_chars(codepage);
+    int i;
+    int j;
+
+    for (i = 0; i < CODEPAGE_UNMAP_SIZE; i++) {
+        unmap->byte[i] = -1;
+    }
+    for (i = 0; i < 256; i++) {
+        j = codepage_unmap_slot(unmap, chars[i]);
+        if (unmap->byte[j] < 0) {
+            unmap->glyph[j] = chars[i];
+            unmap->byte[j] = (short) i;
         }
+    }
+    unmap->built = Q_TRUE;
+}
+
+/**
+ * Map a Unicode code point / glyph to a byte in a codepage.
+ *
+ * @param ch the Unicode code point.
+ * @param codepage the codepage to look through.
+ * @param success if true, the reverse mapping worked.
+ * @return the 8-bit character in one of the 8-bit codepages.
+ */
+extern wchar_t codepage_unmap_byte(const wchar_t ch, const Q_CODEPAGE codepage,
+                                   Q_BOOL * success) {
+
+    struct codepage_unmap * unmap;
+    int i;
+    *success = Q_FALSE;
+
+    assert(codepage != Q_CODEPAGE_DEC);
+
+    switch (codepage) {
+    case Q_CODEPAGE_DEC:
+    case Q_CODEPAGE_PETSCII:
+        /*
+         * BUG: should never get here
+         */
+        abort();
         return 0;
     case Q_CODEPAGE_ATASCII:
         for (i = 0; i < 128; i++) {
@@ -2179,11 +2158,18 @@ extern wchar_t codepage_unmap_byte(const wchar_t ch, const Q_CODEPAGE codepage,
             }
         }
         return 0;
+    default:
+        break;
     }
 
-    /*
-     * BUG: should never get here
-     */
-    abort();
-    return 0;
+    unmap = &codepage_unmaps[codepage];
+    if (unmap->built == Q_FALSE) {
+        build_codepage_unmap(codepage);
+    }
+    i = codepage_unmap_slot(unmap, ch);
+    if (unmap->byte[i] < 0) {
+        return 0;
+    }
+    *success = Q_TRUE;
+    return unmap->byte[i];
 }
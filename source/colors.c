@@ -933,14 +933,19 @@ void q_setup_colors() {
 static char font_color[256];
 
 /**
- * Convert a curses attr_t into an HTML &lt;font color&gt; tag.  Note that
- * the string returned is a single static buffer, i.e. this is NOT
- * thread-safe.
+ * The CSS declarations for each HTML class, built on first use.
+ */
+static char * html_class_styles[Q_HTML_CLASS_MAX];
+
+/**
+ * Write the CSS declarations for a curses attr_t to a buffer.
  *
  * @param attr the curses attribute
- * @return the HTML string
+ * @param buffer the buffer to write to
+ * @param buffer_n the size of buffer
  */
-char * color_to_html(const attr_t attr) {
+static void html_style(const attr_t attr, char * buffer,
+                       const size_t buffer_n) {
     char * font_weight = "normal";
     char * text_decoration = "none";
     char * fg_text;
@@ -971,11 +976,9 @@ char * color_to_html(const attr_t attr) {
     short fg;
     short bg;
 
-    fg = (short) (PAIR_NUMBER(attr) >> 3);
+    fg = (short) ((PAIR_NUMBER(attr) >> 3) & 0x07);
     bg = (short) (PAIR_NUMBER(attr) & 0x07);
 
-    memset(font_color, 0, sizeof(font_color));
-
     if ((attr & A_BLINK) && (attr & A_UNDERLINE)) {
         text_decoration = "blink, underline";
     } else if (attr & A_UNDERLINE) {
@@ -999,13 +1002,89 @@ char * color_to_html(const attr_t attr) {
         }
     }
 
-    sprintf(font_color, "style=\"color: %s; background-color: %s; " \
-        "text-decoration: %s; font-weight: %s\"",
+    snprintf(buffer, buffer_n, "color: %s; background-color: %s; " \
+        "text-decoration: %s; font-weight: %s",
         fg_text, bg_text, text_decoration, font_weight);
+}
 
+/**
+ * Convert a curses attr_t into an HTML &lt;font color&gt; tag.  Note that
+ * the string returned is a single static buffer, i.e. this is NOT
+ * thread-safe.
+ *
+ * @param attr the curses attribute
+ * @return the HTML string
+ */
+char * color_to_html(const attr_t attr) {
+    char style[sizeof(font_color) - 16];
+
+    html_style(attr, style, sizeof(style));
+    snprintf(font_color, sizeof(font_color), "style=\"%s\"", style);
     return font_color;
 }
 
+/**
+ * Convert a curses attr_t into the number of the CSS class that renders
+ * it.  Only the color pair, bold, reverse, blink, and underline affect the
+ * output, so attributes that differ in anything else share a class.
+ *
+ * @param attr the curses attribute
+ * @return a class number between 0 and Q_HTML_CLASS_MAX - 1
+ */
+int color_to_html_class(const attr_t attr) {
+    int html_class;
+
+    html_class = (PAIR_NUMBER(attr) & 0x3F) << 4;
+    if (attr & A_BOLD) {
+        html_class |= 0x08;
+    }
+    if (attr & A_REVERSE) {
+        html_class |= 0x04;
+    }
+    if (attr & A_BLINK) {
+        html_class |= 0x02;
+    }
+    if (attr & A_UNDERLINE) {
+        html_class |= 0x01;
+    }
+    return html_class;
+}
+
+/**
+ * Get the CSS declarations for a class returned by color_to_html_class().
+ * The strings are built once and kept for the life of the program.
+ *
+ * @param html_class the class number
+ * @return the declarations, e.g. "color: #ABABAB; background-color: ..."
+ */
+const char * color_html_class_style(const int html_class) {
+    char style[sizeof(font_color)];
+    attr_t attr;
+
+    if ((html_class < 0) || (html_class >= Q_HTML_CLASS_MAX)) {
+        return "";
+    }
+
+    if (html_class_styles[html_class] == NULL) {
+        attr = COLOR_PAIR(html_class >> 4);
+        if (html_class & 0x08) {
+            attr |= A_BOLD;
+        }
+        if (html_class & 0x04) {
+            attr |= A_REVERSE;
+        }
+        if (html_class & 0x02) {
+            attr |= A_BLINK;
+        }
+        if (html_class & 0x01) {
+            attr |= A_UNDERLINE;
+        }
+        html_style(attr, style, sizeof(style));
+        html_class_styles[html_class] = Xstrdup(style, __FILE__, __LINE__);
+    }
+    return html_class_styles[html_class];
+}
+
 /* Thank you to TheDraw 4.63! */
 
 /**
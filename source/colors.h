@@ -62,6 +62,12 @@ extern "C" {
  */
 #define NO_COLOR_MASK (~Q_A_COLOR)
 
+/**
+ * The number of distinct CSS classes color_to_html_class() can return: 64
+ * color pairs times bold, reverse, blink, and underline.
+ */
+#define Q_HTML_CLASS_MAX 1024
+
 /**
  * One entry in the colors.cfg list.  Each entry currently has a foreground,
  * background, and boldness flag, but we could easily add other attributes
@@ -262,6 +268,23 @@ extern void convert_thedraw_screen(const unsigned char * screen,
  */
 extern char * color_to_html(const attr_t attr);
 
+/**
+ * Convert a curses attr_t into the number of the CSS class that renders
+ * it.
+ *
+ * @param attr the curses attribute
+ * @return a class number between 0 and Q_HTML_CLASS_MAX - 1
+ */
+extern int color_to_html_class(const attr_t attr);
+
+/**
+ * Get the CSS declarations for a class returned by color_to_html_class().
+ *
+ * @param html_class the class number
+ * @return the declarations, e.g. "color: #ABABAB; background-color: ..."
+ */
+extern const char * color_html_class_style(const int html_class);
+
 /**
  * Get the full path to the colors.cfg file.
  *
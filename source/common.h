@@ -76,6 +76,7 @@ extern "C" {
 #define EXIT_ERROR_SELECT_FAILED        20
 #define EXIT_ERROR_SERIAL_FAILED        21
 #define EXIT_ERROR_COMMANDLINE          30
+#define EXIT_ERROR_RENDER               31
 #define EXIT_HELP                       1
 #define EXIT_VERSION                    2
 #define EXIT_OK                         0
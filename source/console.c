@@ -33,6 +33,9 @@
 #include "script.h"
 #include "netclient.h"
 #include "help.h"
+#include "session.h"
+#include "replay.h"
+#include "music.h"
 
 /* Set this to a not-NULL value to enable debug log. */
 /* static const char * DLOGNAME = "console"; */
@@ -79,6 +82,10 @@ static int quicklearn_send_buffer_n;
 /* The file to save the quicklearn script to */
 static FILE * quicklearn_file = NULL;
 
+/* Raw capture bytes not yet handed to the capture file */
+static unsigned char capture_buffer[16384];
+static size_t capture_buffer_n = 0;
+
 /**
  * A flag to indicate a data flood on the console.  We need to not permit
  * download protocol autostarts during a flood.
@@ -146,7 +153,12 @@ void start_capture(const char * filename) {
             qlog(_("Capture open to file '%s'\n"), filename);
             time(&current_time);
 
-            if (q_status.capture_type == Q_CAPTURE_TYPE_HTML) {
+            if (q_status.capture_type == Q_CAPTURE_TYPE_TIMED) {
+                /*
+                 * Timed - binary, no text header
+                 */
+                start_timed_capture();
+            } else if (q_status.capture_type == Q_CAPTURE_TYPE_HTML) {
                 /*
                  * HTML
                  */
@@ -177,6 +189,63 @@ void start_capture(const char * filename) {
     }
 }
 
+/**
+ * Hand the raw capture buffer to the capture file.
+ */
+static void write_capture_buffer() {
+    if (capture_buffer_n > 0) {
+        fwrite(capture_buffer, 1, capture_buffer_n, q_status.capture_file);
+        capture_buffer_n = 0;
+    }
+}
+
+/**
+ * Append bytes to a raw or timed capture.  The bytes are held in memory
+ * and written to the capture file in blocks by flush_capture(), or when
+ * the buffer fills up.  This does nothing if neither capture is running.
+ *
+ * @param data the bytes to capture
+ * @param n the number of bytes in data
+ */
+void capture_raw(const unsigned char * data, const size_t n) {
+    if ((q_status.capture == Q_FALSE) || (n == 0)) {
+        return;
+    }
+    if (q_status.capture_type == Q_CAPTURE_TYPE_TIMED) {
+        timed_capture(data, n);
+        return;
+    }
+    if (q_status.capture_type != Q_CAPTURE_TYPE_RAW) {
+        return;
+    }
+
+    if (capture_buffer_n + n > sizeof(capture_buffer)) {
+        write_capture_buffer();
+        if (n >= sizeof(capture_buffer)) {
+            /*
+             * Too big to be worth copying
+             */
+            fwrite(data, 1, n, q_status.capture_file);
+            return;
+        }
+    }
+    memcpy(capture_buffer + capture_buffer_n, data, n);
+    capture_buffer_n += n;
+}
+
+/**
+ * Write any buffered raw capture bytes to the capture file and flush it.
+ */
+void flush_capture() {
+    if (q_status.capture == Q_FALSE) {
+        return;
+    }
+    write_capture_buffer();
+    flush_timed_capture(Q_FALSE);
+    fflush(q_status.capture_file);
+    q_status.capture_flush_time = time(NULL);
+}
+
 /**
  * Stop capturing and close the capture file.
  */
@@ -188,9 +257,15 @@ void stop_capture() {
         return;
     }
 
+    write_capture_buffer();
     time(&current_time);
 
-    if (q_status.capture_type == Q_CAPTURE_TYPE_HTML) {
+    if (q_status.capture_type == Q_CAPTURE_TYPE_TIMED) {
+        /*
+         * Timed - binary, no text footer
+         */
+        flush_timed_capture(Q_TRUE);
+    } else if (q_status.capture_type == Q_CAPTURE_TYPE_HTML) {
         /*
          * HTML
          */
@@ -406,6 +481,56 @@ static Q_BOOL check_kermit_autostart(unsigned char from_modem) {
     return Q_FALSE;
 }
 
+/**
+ * The console state that is saved with a session.
+ */
+struct console_session {
+    unsigned char zrqinit_buffer[sizeof(zrqinit_buffer)];
+    unsigned int zrqinit_buffer_n;
+    char kermit_autostart_buffer[sizeof(kermit_autostart_buffer)];
+    unsigned int kermit_autostart_buffer_n;
+};
+
+/**
+ * Save or restore the console autostart state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t console_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct console_session * saved = (struct console_session *) buffer;
+
+    switch (op) {
+    case Q_SESSION_SAVE:
+        /*
+         * q_status is still the outgoing session's here, so its raw
+         * capture bytes go to its own file.
+         */
+        if (q_status.capture == Q_TRUE) {
+            write_capture_buffer();
+            flush_timed_capture(Q_TRUE);
+        }
+        /* Fall through... */
+    case Q_SESSION_RESTORE:
+        Q_SESSION_COPY(op, saved->zrqinit_buffer, zrqinit_buffer);
+        Q_SESSION_COPY(op, saved->zrqinit_buffer_n, zrqinit_buffer_n);
+        Q_SESSION_COPY(op, saved->kermit_autostart_buffer,
+                       kermit_autostart_buffer);
+        Q_SESSION_COPY(op, saved->kermit_autostart_buffer_n,
+                       kermit_autostart_buffer_n);
+        break;
+    case Q_SESSION_DETACH:
+    case Q_SESSION_FREE:
+        reset_zmodem_autostart();
+        reset_kermit_autostart();
+        break;
+    case Q_SESSION_SIZE:
+        break;
+    }
+    return sizeof(struct console_session);
+}
+
 /**
  * Begin saving prompts and responses to a Perl language script file.
  *
@@ -954,6 +1079,27 @@ void console_keyboard_handler(int keystroke, int flags) {
 
 #endif
 
+    /*
+     * A running replay takes the plain keys for its own controls.
+     */
+    if ((replay_active() == Q_TRUE) &&
+        (replay_keyboard_handler(keystroke, flags) == Q_TRUE)
+    ) {
+        return;
+    }
+
+    /*
+     * Backtick or ESC stops music playing in the background and bans it
+     * for a few seconds.
+     */
+    if (((keystroke == '`') || (keystroke == Q_KEY_ESCAPE)) &&
+        ((flags & KEY_FLAG_ALT) == 0) &&
+        (music_playing() == Q_TRUE)
+    ) {
+        music_stop();
+        return;
+    }
+
     if (keystroke == Q_KEY_BRACKET_ON) {
         if (q_status.bracketed_paste_mode == Q_TRUE) {
             bracketed_paste_on();
@@ -2101,6 +2247,26 @@ void console_keyboard_handler(int keystroke, int flags) {
         }
         break;
 
+    case '.':
+        if (flags & KEY_FLAG_ALT) {
+            /*
+             * Alt-. Next session
+             */
+            session_switch();
+            return;
+        }
+        break;
+
+    case '\'':
+        if (flags & KEY_FLAG_ALT) {
+            /*
+             * Alt-' New session
+             */
+            session_new();
+            return;
+        }
+        break;
+
     default:
         break;
     }
@@ -2215,6 +2381,63 @@ void console_keyboard_handler(int keystroke, int flags) {
     }
 }
 
+/**
+ * Pass one byte from the remote side through the emulator and print
+ * whatever characters it produces.
+ *
+ * @param ch the byte, after translation and 8th bit stripping
+ */
+void console_emulate(const unsigned char ch) {
+    wchar_t emulated_char;
+    Q_EMULATION_STATUS emulation_rc;
+
+    emulation_rc = terminal_emulator(ch, &emulated_char);
+
+    DLOG(("terminal_emulator() (outside) RC %d char '%lc' 0x%x\n",
+            emulation_rc, emulated_char, emulated_char));
+
+    for (;;) {
+
+        if (emulation_rc == Q_EMUL_FSM_ONE_CHAR) {
+
+            /*
+             * Print this character
+             */
+            print_character(emulated_char);
+
+            /*
+             * We grabbed the one character, get out
+             */
+            break;
+        } else if (emulation_rc == Q_EMUL_FSM_NO_CHAR_YET) {
+
+            /*
+             * No more characters, break out
+             */
+            break;
+        } else {
+            /*
+             * Q_EMUL_FSM_MANY_CHARS
+             */
+
+            /*
+             * Print this character
+             */
+            print_character(emulated_char);
+
+            /*
+             * ...and continue pulling more characters
+             */
+            emulation_rc = terminal_emulator(-1, &emulated_char);
+
+            DLOG(("terminal_emulator() (inside) RC %d char '%lc' 0x%x\n",
+                    emulation_rc, emulated_char, emulated_char));
+
+        }
+
+    } /* for (;;) */
+}
+
 /**
  * Process raw bytes from the remote side through the emulation layer,
  * handling zmodem/kermit autostart, translation tables, etc.
@@ -2226,9 +2449,9 @@ void console_keyboard_handler(int keystroke, int flags) {
  */
 void console_process_incoming_data(unsigned char * buffer, const int n,
                                    int * remaining) {
+    const unsigned char * inbound_map = translate_8bit_in_map();
     int i;
-    wchar_t emulated_char;
-    Q_EMULATION_STATUS emulation_rc;
+    unsigned char ch;
 
     DLOG(("buffer_full %s buffer_empty %s running %s paused %s\n",
             (q_running_script.print_buffer_full == Q_TRUE ? "true" : "false"),
@@ -2251,45 +2474,40 @@ void console_process_incoming_data(unsigned char * buffer, const int n,
             }
         }
 
-        /*
-         * Capture
-         */
-        if (q_status.capture == Q_TRUE) {
-            if (q_status.capture_type == Q_CAPTURE_TYPE_RAW) {
-                /*
-                 * Raw
-                 */
-                fprintf(q_status.capture_file, "%c", buffer[i]);
-                if (q_status.capture_flush_time < time(NULL)) {
-                    fflush(q_status.capture_file);
-                    q_status.capture_flush_time = time(NULL);
-                }
-            }
-        }
-
         /*
          * Run received characters through the 8-bit input translation table
-         * before doing anything else.  This can break UTF-8 decoding,
-         * Zmodem/Kermit autostart, and more.
+         * and strip 8th bit processing before doing anything else.  This
+         * can break UTF-8 decoding, Zmodem/Kermit autostart, and more.
+         *
+         * buffer[] keeps the bytes as received until the loop is done, so
+         * that raw capture can take them in one piece.
          */
-        buffer[i] = translate_8bit_in(buffer[i]);
+        ch = inbound_map[buffer[i]];
 
         /*
-         * Strip 8th bit processing
+         * Only do Zmodem and Kermit autostart when in actual console mode,
+         * and never for a session running in the background.  Neither
+         * check can fire unless this byte starts a signature or one is
+         * already under way, so most bytes skip them.
          */
-        if (q_status.strip_8th_bit == Q_TRUE) {
-            buffer[i] &= 0x7F;
-        }
-
-        /*
-         * Only do Zmodem and Kermit autostart when in actual console mode.
-         */
-        if (q_program_state == Q_STATE_CONSOLE) {
+        if (((ch == ZRQINIT_STRING[0]) ||
+             (ch == KERMIT_AUTOSTART_STRING[0]) ||
+             (zrqinit_buffer_n > 0) ||
+             (kermit_autostart_buffer_n > 0)) &&
+            (q_program_state == Q_STATE_CONSOLE) &&
+            (session_in_background() == Q_FALSE)
+        ) {
 
             /*
              * Check for Zmodem autostart
              */
-            if (check_zmodem_autostart(buffer[i]) == Q_TRUE) {
+            if (check_zmodem_autostart(ch) == Q_TRUE) {
+                /*
+                 * The protocol picks up from this byte
+                 */
+                capture_raw(buffer, i + 1);
+                buffer[i] = ch;
+
                 if (q_download_location == NULL) {
                     q_download_location =
                         save_form(_("Download Directory"),
@@ -2317,7 +2535,13 @@ void console_process_incoming_data(unsigned char * buffer, const int n,
             /*
              * Check for Kermit autostart
              */
-            if (check_kermit_autostart(buffer[i]) == Q_TRUE) {
+            if (check_kermit_autostart(ch) == Q_TRUE) {
+                /*
+                 * The protocol picks up from this byte
+                 */
+                capture_raw(buffer, i + 1);
+                buffer[i] = ch;
+
                 if (q_download_location == NULL) {
                     q_download_location =
                         save_form(_("Download Directory"),
@@ -2347,55 +2571,16 @@ void console_process_incoming_data(unsigned char * buffer, const int n,
         /*
          * Normal character -- pass it through emulator
          */
-        emulation_rc = terminal_emulator(buffer[i], &emulated_char);
+        console_emulate(ch);
         *remaining -= 1;
 
-        DLOG(("terminal_emulator() (outside) RC %d char '%lc' 0x%x\n",
-                emulation_rc, emulated_char, emulated_char));
-
-        for (;;) {
-
-            if (emulation_rc == Q_EMUL_FSM_ONE_CHAR) {
-
-                /*
-                 * Print this character
-                 */
-                print_character(emulated_char);
-
-                /*
-                 * We grabbed the one character, get out
-                 */
-                break;
-            } else if (emulation_rc == Q_EMUL_FSM_NO_CHAR_YET) {
-
-                /*
-                 * No more characters, break out
-                 */
-                break;
-            } else {
-                /*
-                 * Q_EMUL_FSM_MANY_CHARS
-                 */
-
-                /*
-                 * Print this character
-                 */
-                print_character(emulated_char);
-
-                /*
-                 * ...and continue pulling more characters
-                 */
-                emulation_rc = terminal_emulator(-1, &emulated_char);
-
-                DLOG(("terminal_emulator() (inside) RC %d char '%lc' 0x%x\n",
-                        emulation_rc, emulated_char, emulated_char));
-
-            }
-
-        } /* for (;;) */
-
     } /* for (i = 0; i < n; i++) */
 
+    /*
+     * Capture everything that was processed
+     */
+    capture_raw(buffer, i);
+
     q_screen_dirty = Q_TRUE;
     if (q_status.split_screen == Q_TRUE) {
         q_split_screen_dirty = Q_TRUE;
@@ -2623,6 +2808,9 @@ void console_refresh(Q_BOOL status_line) {
                  */
                 abort();
             }
+            if (replay_active() == Q_TRUE) {
+                online_string = _("Replay");
+            }
 
             screen_put_color_str_yx(HEIGHT - 1, 1, online_string,
                                     Q_COLOR_STATUS);
@@ -2745,6 +2933,9 @@ void console_refresh(Q_BOOL status_line) {
                  */
                 abort();
             }
+            if (replay_active() == Q_TRUE) {
+                online_string = _("Replay");
+            }
 
             if (q_status.online == Q_TRUE) {
                 /*
@@ -3529,6 +3720,8 @@ void console_menu_keyboard_handler(const int keystroke, const int flags) {
         case '\\':
         case ';':
         case ':':
+        case '.':
+        case '\'':
             switch_state(Q_STATE_CONSOLE);
             q_screen_dirty = Q_TRUE;
             console_refresh(Q_TRUE);
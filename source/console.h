@@ -98,6 +98,14 @@ extern void console_menu_refresh();
  */
 extern void console_info_refresh();
 
+/**
+ * Pass one byte from the remote side through the emulator and print
+ * whatever characters it produces.
+ *
+ * @param ch the byte, after translation and 8th bit stripping
+ */
+extern void console_emulate(const unsigned char ch);
+
 /**
  * Process raw bytes from the remote side through the emulation layer,
  * handling zmodem/kermit autostart, translation tables, etc.
@@ -121,6 +129,21 @@ extern void start_capture(const char * filename);
  */
 extern void stop_capture();
 
+/**
+ * Append bytes to a raw capture.  The bytes are held in memory and written
+ * to the capture file in blocks by flush_capture(), or when the buffer
+ * fills up.  This does nothing if raw capture is not running.
+ *
+ * @param data the bytes to capture
+ * @param n the number of bytes in data
+ */
+extern void capture_raw(const unsigned char * data, const size_t n);
+
+/**
+ * Write any buffered raw capture bytes to the capture file and flush it.
+ */
+extern void flush_capture();
+
 /**
  * Begin logging major events for the session to file.
  *
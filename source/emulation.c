@@ -35,6 +35,7 @@
 #include "options.h"
 #include "console.h"
 #include "help.h"
+#include "session.h"
 
 /**
  * Local buffer for multiple returned characters.
@@ -58,15 +59,6 @@ int q_emulation_right_margin = -1;
  */
 unsigned long q_connection_bytes_received;
 
-/**
- * Avatar has a special command that requires the entire state machine be
- * re-run.  It is the responsibility of an emulation to set these two
- * variables and then return Q_EMUL_FSM_REPEAT_STATE.  terminal_emulator()
- * will free it afterwards.
- */
-unsigned char * q_emul_repeat_state_buffer = NULL;
-int q_emul_repeat_state_count;
-
 /**
  * Given an emulation string, return a Q_EMULATION enum.
  *
@@ -474,6 +466,7 @@ static Q_EMULATION_STATUS tty(const unsigned char from_modem,
             if (q_scrollback_current->chars[q_status.cursor_x] != ' ') {
                 q_scrollback_current->colors[q_status.cursor_x] |=
                     Q_A_UNDERLINE;
+                q_scrollback_current->dirty = Q_TRUE;
                 q_status.cursor_x++;
                 break;
             }
@@ -555,6 +548,7 @@ static void print_byte_offset() {
      */
     q_scrollback_current->chars[60] = '|';
     q_scrollback_current->colors[60] = q_current_color;
+    q_scrollback_current->dirty = Q_TRUE;
 }
 
 /**
@@ -711,6 +705,7 @@ static void debug_print_character(const unsigned char ch,
     q_scrollback_current->chars[62 + offset] = codepage_map_char(ch);
     q_scrollback_current->colors[62 + offset] = q_current_color;
     q_scrollback_current->length = 62 + offset + 1;
+    q_scrollback_current->dirty = Q_TRUE;
     q_current_color = Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
 
     /*
@@ -775,6 +770,215 @@ static Q_EMULATION_STATUS debug_emulator(const unsigned char from_modem,
     return Q_EMUL_FSM_NO_CHAR_YET;
 }
 
+/* Emulator dispatch -------------------------------------------------------- */
+
+/**
+ * The TTY keyboard with the signature of q_emulator.keystroke.
+ */
+static wchar_t * tty_keys(const int keystroke, const int flags) {
+    return tty_keystroke(keystroke);
+}
+
+/**
+ * The ANSI keyboard with the signature of q_emulator.keystroke.
+ */
+static wchar_t * ansi_keys(const int keystroke, const int flags) {
+    return ansi_keystroke(keystroke);
+}
+
+/**
+ * The VT52 keyboard with the signature of q_emulator.keystroke.
+ */
+static wchar_t * vt52_keys(const int keystroke, const int flags) {
+    return vt52_keystroke(keystroke);
+}
+
+/**
+ * The VT100 keyboard with the signature of q_emulator.keystroke.
+ */
+static wchar_t * vt100_keys(const int keystroke, const int flags) {
+    return vt100_keystroke(keystroke);
+}
+
+/**
+ * The PETSCII keyboard with the signature of q_emulator.keystroke.
+ */
+static wchar_t * petscii_keys(const int keystroke, const int flags) {
+    return petscii_keystroke(keystroke);
+}
+
+/**
+ * The ATASCII keyboard with the signature of q_emulator.keystroke.
+ */
+static wchar_t * atascii_keys(const int keystroke, const int flags) {
+    return atascii_keystroke(keystroke);
+}
+
+/**
+ * The Linux console keyboard with the signature of q_emulator.keystroke.
+ */
+static wchar_t * linux_keys(const int keystroke, const int flags) {
+    return linux_keystroke(keystroke);
+}
+
+/**
+ * Right margin for the BBS-ish emulations: check the assume_80_columns
+ * flag.
+ */
+static int bbs_right_margin() {
+    if (q_status.assume_80_columns == Q_TRUE) {
+        return 79;
+    }
+    return WIDTH - 1;
+}
+
+/**
+ * Right margin for ATASCII.  ATASCII is always 40 columns on screen.  But
+ * these might be double-width lines, so the visible right margin is 80
+ * columns.
+ */
+static int atascii_right_margin() {
+    if (q_status.atascii_has_wide_font == Q_FALSE) {
+        /*
+         * We think we are running with a narrow font, so will need to use
+         * double-width characters.
+         */
+        return 79;
+    }
+    /*
+     * We already have a wide font, so restrict to 40 columns.
+     */
+    return 39;
+}
+
+/**
+ * Right margin for PETSCII, which works the same as ATASCII.
+ */
+static int petscii_right_margin() {
+    if (q_status.petscii_has_wide_font == Q_FALSE) {
+        return 79;
+    }
+    return 39;
+}
+
+/**
+ * Right margin for the VT100-ish emulations: check the actual right margin
+ * value.
+ */
+static int vt_right_margin() {
+    if (q_emulation_right_margin > 0) {
+        return q_emulation_right_margin;
+    }
+    return WIDTH - 1;
+}
+
+/**
+ * The functions that implement one emulation.
+ */
+struct q_emulator {
+    /**
+     * Push one byte through the emulator.
+     */
+    Q_EMULATION_STATUS (*emulate)(const unsigned char from_modem,
+                                  wchar_t * to_screen);
+
+    /**
+     * Translate a special keystroke for the remote side.
+     */
+    wchar_t * (*keystroke)(const int keystroke, const int flags);
+
+    /**
+     * The column that printed characters wrap at.
+     */
+    int (*right_margin)();
+
+    /**
+     * If true, terminal_emulator() handles bare CR and LF itself.  The
+     * VT100 family needs to see them for scrolling regions, DEBUG does its
+     * own CR/LF handling, and AVATAR, PETSCII, and ATASCII use them as
+     * codes.
+     */
+    Q_BOOL generic_crlf;
+
+    /**
+     * If true, the emulator dumps its own unknown sequences from
+     * q_emul_buffer.  Everybody else just has the buffer dumped for them.
+     */
+    Q_BOOL dumps_own_buffer;
+};
+
+/**
+ * Every emulation, indexed by Q_EMULATION.
+ */
+static const struct q_emulator emulators[Q_EMULATION_MAX] = {
+    /* Q_EMUL_TTY */
+    { tty, tty_keys, bbs_right_margin, Q_TRUE, Q_FALSE },
+    /* Q_EMUL_ANSI */
+    { ansi, ansi_keys, bbs_right_margin, Q_TRUE, Q_FALSE },
+    /* Q_EMUL_VT52 */
+    { vt52, vt52_keys, vt_right_margin, Q_TRUE, Q_FALSE },
+    /* Q_EMUL_VT100 */
+    { vt100, vt100_keys, vt_right_margin, Q_FALSE, Q_FALSE },
+    /* Q_EMUL_VT102 */
+    { vt100, vt100_keys, vt_right_margin, Q_FALSE, Q_FALSE },
+    /* Q_EMUL_VT220 */
+    { vt100, vt100_keys, vt_right_margin, Q_FALSE, Q_FALSE },
+    /* Q_EMUL_AVATAR */
+    { avatar, ansi_keys, bbs_right_margin, Q_FALSE, Q_TRUE },
+    /* Q_EMUL_PETSCII */
+    { petscii, petscii_keys, petscii_right_margin, Q_FALSE, Q_TRUE },
+    /* Q_EMUL_ATASCII */
+    { atascii, atascii_keys, atascii_right_margin, Q_FALSE, Q_TRUE },
+    /* Q_EMUL_DEBUG */
+    { debug_emulator, tty_keys, vt_right_margin, Q_FALSE, Q_FALSE },
+    /* Q_EMUL_LINUX */
+    { vt100, linux_keys, vt_right_margin, Q_FALSE, Q_FALSE },
+    /* Q_EMUL_LINUX_UTF8 */
+    { vt100, linux_keys, vt_right_margin, Q_FALSE, Q_FALSE },
+    /* Q_EMUL_XTERM */
+    { vt100, xterm_keystroke, vt_right_margin, Q_FALSE, Q_FALSE },
+    /* Q_EMUL_XTERM_UTF8 */
+    { vt100, xterm_keystroke, vt_right_margin, Q_FALSE, Q_FALSE },
+};
+
+/**
+ * The emulator for q_status.emulation.  This is chosen by reset_emulation()
+ * and when a session is restored, so that the per-byte path does not have
+ * to look at the emulation type.
+ */
+static const struct q_emulator * emulator = &emulators[Q_EMUL_VT102];
+
+/**
+ * Point emulator at the entry for q_status.emulation.
+ */
+static void select_emulator() {
+    emulator = &emulators[q_status.emulation];
+}
+
+/**
+ * Generate a sequence of bytes to send to the remote side that correspond
+ * to a keystroke, using the current emulation's keyboard function.
+ *
+ * @param keystroke one of the Q_KEY values, OR a Unicode code point.  See
+ * input.h.
+ * @param flags KEY_FLAG_ALT, KEY_FLAG_CTRL, etc.  See input.h.
+ * @return a wide string that is appropriate to send to the remote side, or
+ * NULL if the emulation does not know the keystroke
+ */
+wchar_t * emulation_keystroke(const int keystroke, const int flags) {
+    return emulator->keystroke(keystroke, flags);
+}
+
+/**
+ * Get the column that printed characters wrap at for the current
+ * emulation, before any double-width adjustment.
+ *
+ * @return the right margin column
+ */
+int emulation_right_margin() {
+    return emulator->right_margin();
+}
+
 /* The main entry point for all terminal emulation -------------------------- */
 
 /**
@@ -809,8 +1013,6 @@ static Q_EMULATION_STATUS debug_emulator(const unsigned char from_modem,
 Q_EMULATION_STATUS terminal_emulator(const unsigned char from_modem,
                                      wchar_t * to_screen) {
 
-    int i;
-
     /*
      * Junk extraneous data
      */
@@ -823,24 +1025,12 @@ Q_EMULATION_STATUS terminal_emulator(const unsigned char from_modem,
 
     if (last_state == Q_EMUL_FSM_MANY_CHARS) {
 
-        if (q_status.emulation == Q_EMUL_AVATAR) {
-            /*
-             * Avatar has its own logic that needs to handle RLE strings.  It
-             * will also dump unknown sequences.
-             */
-            last_state = avatar(from_modem, to_screen);
-            return last_state;
-        } else if (q_status.emulation == Q_EMUL_PETSCII) {
-            /*
-             * PETSCII needs to dump unknown sequences.
-             */
-            last_state = petscii(from_modem, to_screen);
-            return last_state;
-        } else if (q_status.emulation == Q_EMUL_ATASCII) {
+        if (emulator->dumps_own_buffer == Q_TRUE) {
             /*
-             * ATASCII needs to dump unknown sequences.
+             * Avatar has its own logic that needs to handle RLE strings.
+             * Avatar, PETSCII, and ATASCII all dump unknown sequences.
              */
-            last_state = atascii(from_modem, to_screen);
+            last_state = emulator->emulate(from_modem, to_screen);
             return last_state;
         } else {
             /*
@@ -875,30 +1065,10 @@ Q_EMULATION_STATUS terminal_emulator(const unsigned char from_modem,
     q_connection_bytes_received++;
 
     /*
-     * VT100 scrolling regions require that the vt100() function sees these
-     * characters.
-     *
-     * DEBUG emulation also performs its own CR/LF handling.
-     *
-     * AVATAR uses the other control characters as its codes, so we can't
-     * process them here.
-     *
-     * PETSCII processes every byte on its own.
-     *
-     * ATASCII processes every byte on its own.
+     * TTY, ANSI, and VT52 leave bare CR and LF to us, see
+     * q_emulator.generic_crlf.
      */
-    if ((q_status.emulation != Q_EMUL_VT100) &&
-        (q_status.emulation != Q_EMUL_VT102) &&
-        (q_status.emulation != Q_EMUL_VT220) &&
-        (q_status.emulation != Q_EMUL_LINUX) &&
-        (q_status.emulation != Q_EMUL_LINUX_UTF8) &&
-        (q_status.emulation != Q_EMUL_XTERM) &&
-        (q_status.emulation != Q_EMUL_XTERM_UTF8) &&
-        (q_status.emulation != Q_EMUL_AVATAR) &&
-        (q_status.emulation != Q_EMUL_PETSCII) &&
-        (q_status.emulation != Q_EMUL_ATASCII) &&
-        (q_status.emulation != Q_EMUL_DEBUG)
-    ) {
+    if (emulator->generic_crlf == Q_TRUE) {
         if (from_modem == C_CR) {
             cursor_carriage_return();
             *to_screen = 1;
@@ -913,96 +1083,7 @@ Q_EMULATION_STATUS terminal_emulator(const unsigned char from_modem,
     /*
      * Dispatch to the specific emulation function.
      */
-    switch (q_status.emulation) {
-    case Q_EMUL_ANSI:
-        last_state = ansi(from_modem, to_screen);
-        break;
-    case Q_EMUL_VT52:
-        last_state = vt52(from_modem, to_screen);
-        break;
-    case Q_EMUL_AVATAR:
-        last_state = avatar(from_modem, to_screen);
-        break;
-    case Q_EMUL_PETSCII:
-        last_state = petscii(from_modem, to_screen);
-        break;
-    case Q_EMUL_ATASCII:
-        last_state = atascii(from_modem, to_screen);
-        break;
-    case Q_EMUL_VT100:
-    case Q_EMUL_VT102:
-    case Q_EMUL_VT220:
-    case Q_EMUL_LINUX:
-    case Q_EMUL_LINUX_UTF8:
-    case Q_EMUL_XTERM:
-    case Q_EMUL_XTERM_UTF8:
-        last_state = vt100(from_modem, to_screen);
-        break;
-    case Q_EMUL_TTY:
-        last_state = tty(from_modem, to_screen);
-        break;
-    case Q_EMUL_DEBUG:
-        last_state = debug_emulator(from_modem, to_screen);
-        break;
-    }
-
-    if (last_state == Q_EMUL_FSM_REPEAT_STATE) {
-
-        for (i = 0; i < q_emul_repeat_state_count; i++) {
-
-            switch (q_status.emulation) {
-            case Q_EMUL_ANSI:
-                last_state = ansi(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            case Q_EMUL_VT52:
-                last_state = vt52(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            case Q_EMUL_AVATAR:
-                last_state = avatar(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            case Q_EMUL_PETSCII:
-                last_state = petscii(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            case Q_EMUL_ATASCII:
-                last_state = atascii(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            case Q_EMUL_VT100:
-            case Q_EMUL_VT102:
-            case Q_EMUL_VT220:
-            case Q_EMUL_LINUX:
-            case Q_EMUL_LINUX_UTF8:
-            case Q_EMUL_XTERM:
-            case Q_EMUL_XTERM_UTF8:
-                last_state = vt100(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            case Q_EMUL_TTY:
-                last_state = tty(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            case Q_EMUL_DEBUG:
-                last_state =
-                    debug_emulator(q_emul_repeat_state_buffer[i], to_screen);
-                break;
-            }
-
-            /*
-             * Ugly hack, this should be console
-             */
-            if (last_state == Q_EMUL_FSM_ONE_CHAR) {
-                /*
-                 * Print this character
-                 */
-                print_character(codepage_map_char((unsigned char) *to_screen));
-            }
-
-        }
-
-        Xfree(q_emul_repeat_state_buffer, __FILE__, __LINE__);
-        q_emul_repeat_state_buffer = NULL;
-
-        *to_screen = 1;
-        last_state = Q_EMUL_FSM_NO_CHAR_YET;
-    }
-
+    last_state = emulator->emulate(from_modem, to_screen);
     return last_state;
 }
 
@@ -1015,11 +1096,6 @@ void reset_emulation() {
     memset(q_emul_buffer, 0, sizeof(q_emul_buffer));
     last_state = Q_EMUL_FSM_NO_CHAR_YET;
 
-    if (q_emul_repeat_state_buffer != NULL) {
-        Xfree(q_emul_repeat_state_buffer, __FILE__, __LINE__);
-        q_emul_repeat_state_buffer = NULL;
-    }
-
     q_current_color = Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
 
     /*
@@ -1033,6 +1109,7 @@ void reset_emulation() {
     vt100_reset();
     debug_reset();
     q_emulation_right_margin = -1;
+    select_emulator();
     q_status.scroll_region_top = 0;
     q_status.scroll_region_bottom = HEIGHT - STATUS_HEIGHT - 1;
     q_status.reverse_video = Q_FALSE;
@@ -1104,6 +1181,47 @@ void reset_emulation() {
 
 }
 
+/**
+ * The common emulation state that is saved with a session.
+ */
+struct emulation_session {
+    unsigned char emul_buffer[sizeof(q_emul_buffer)];
+    int emul_buffer_n;
+    int emul_buffer_i;
+    Q_EMULATION_STATUS last_state;
+    int right_margin;
+    unsigned long connection_bytes_received;
+    int local_echo_count;
+    attr_t current_color;
+};
+
+/**
+ * Save or restore the common emulation state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t emulation_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct emulation_session * saved = (struct emulation_session *) buffer;
+
+    if ((op == Q_SESSION_SAVE) || (op == Q_SESSION_RESTORE)) {
+        Q_SESSION_COPY(op, saved->emul_buffer, q_emul_buffer);
+        Q_SESSION_COPY(op, saved->emul_buffer_n, q_emul_buffer_n);
+        Q_SESSION_COPY(op, saved->emul_buffer_i, q_emul_buffer_i);
+        Q_SESSION_COPY(op, saved->last_state, last_state);
+        Q_SESSION_COPY(op, saved->right_margin, q_emulation_right_margin);
+        Q_SESSION_COPY(op, saved->connection_bytes_received,
+                       q_connection_bytes_received);
+        Q_SESSION_COPY(op, saved->local_echo_count, local_echo_count);
+        Q_SESSION_COPY(op, saved->current_color, q_current_color);
+        if (op == Q_SESSION_RESTORE) {
+            select_emulator();
+        }
+    }
+    return sizeof(struct emulation_session);
+}
+
 /**
  * Draw screen for the emulation selection dialog.
  */
@@ -55,8 +55,7 @@ typedef enum Q_EMULATIONS {
 typedef enum Q_EMULATION_STATUSS {
     Q_EMUL_FSM_NO_CHAR_YET,     /* Need more data */
     Q_EMUL_FSM_ONE_CHAR,        /* One screen character is ready */
-    Q_EMUL_FSM_MANY_CHARS,      /* More screen characters are ready */
-    Q_EMUL_FSM_REPEAT_STATE     /* Repeat the entire state */
+    Q_EMUL_FSM_MANY_CHARS       /* More screen characters are ready */
 } Q_EMULATION_STATUS;
 
 /**
@@ -97,15 +96,6 @@ extern int q_emul_buffer_i;
  */
 extern int q_emulation_right_margin;
 
-/**
- * Avatar has a special command that requires the entire state machine be
- * re-run.  It is the responsibility of an emulation to set these two
- * variables and then return Q_EMUL_FSM_REPEAT_STATE.  terminal_emulator()
- * will free it afterwards.
- */
-extern unsigned char * q_emul_repeat_state_buffer;
-extern int q_emul_repeat_state_count;
-
 /* Functions -------------------------------------------------------------- */
 
 /**
@@ -145,6 +135,26 @@ extern void reset_emulation();
 extern Q_EMULATION_STATUS terminal_emulator(const unsigned char from_modem,
                                             wchar_t * to_screen);
 
+/**
+ * Generate a sequence of bytes to send to the remote side that correspond
+ * to a keystroke, using the current emulation's keyboard function.
+ *
+ * @param keystroke one of the Q_KEY values, OR a Unicode code point.  See
+ * input.h.
+ * @param flags KEY_FLAG_ALT, KEY_FLAG_CTRL, etc.  See input.h.
+ * @return a wide string that is appropriate to send to the remote side, or
+ * NULL if the emulation does not know the keystroke
+ */
+extern wchar_t * emulation_keystroke(const int keystroke, const int flags);
+
+/**
+ * Get the column that printed characters wrap at for the current
+ * emulation, before any double-width adjustment.
+ *
+ * @return the right margin column
+ */
+extern int emulation_right_margin();
+
 /**
  * Return a string for a Q_EMULATION enum.
  *
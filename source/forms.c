@@ -3417,7 +3417,7 @@ Q_CAPTURE_TYPE ask_capture_type() {
     void * form_window;
     int window_left;
     int window_top;
-    int window_height = 8;
+    int window_height = 9;
     int window_length;
     int keystroke;
     int status_left_stop;
@@ -3499,6 +3499,9 @@ Q_CAPTURE_TYPE ask_capture_type() {
     screen_win_put_color_str_yx(form_window, i, 7, "R", Q_COLOR_MENU_COMMAND);
     screen_win_put_color_str(form_window, _(" - Raw"), Q_COLOR_MENU_TEXT);
     i++;
+    screen_win_put_color_str_yx(form_window, i, 7, "T", Q_COLOR_MENU_COMMAND);
+    screen_win_put_color_str(form_window, _(" - Timed"), Q_COLOR_MENU_TEXT);
+    i++;
     i++;
 
     /*
@@ -3534,6 +3537,12 @@ Q_CAPTURE_TYPE ask_capture_type() {
             done = Q_TRUE;
             break;
 
+        case 'T':
+        case 't':
+            capture_type = Q_CAPTURE_TYPE_TIMED;
+            done = Q_TRUE;
+            break;
+
         case '`':
             /*
              * Backtick works too
@@ -90,11 +90,35 @@ struct help_topic {
     struct help_link ** links;
     int links_n;
     struct help_topic * next;
+    struct help_topic * hash_next;
 };
 
 /* The global list of help topics. */
 static struct help_topic * TOPICS = NULL;
 
+/* The help topics hashed by key, see topic_hash(). */
+#define HELP_TOPIC_HASH_SIZE 64
+static struct help_topic * topic_table[HELP_TOPIC_HASH_SIZE];
+
+/* When true, raw_help_text has been parsed. */
+static Q_BOOL help_ready = Q_FALSE;
+
+/**
+ * Hash a topic key into topic_table.
+ *
+ * @param key the topic key
+ * @return the bucket index
+ */
+static unsigned int topic_hash(const char * key) {
+    unsigned int hash = 5381;
+
+    while (*key != 0) {
+        hash = (hash * 33) ^ (unsigned char) *key;
+        key++;
+    }
+    return hash % HELP_TOPIC_HASH_SIZE;
+}
+
 /**
  * Find a topic in the list.
  *
@@ -102,14 +126,14 @@ static struct help_topic * TOPICS = NULL;
  * @return the help_topic entry
  */
 static struct help_topic * find_topic(const char * key) {
-    struct help_topic *topic = TOPICS;
+    struct help_topic *topic = topic_table[topic_hash(key)];
     DLOG(("find_topic: look for %s\n", key));
     while (topic != NULL) {
         if (strcmp(topic->key, key) == 0) {
             DLOG(("find_topic: found %ls\n", topic->title));
             return topic;
         }
-        topic = topic->next;
+        topic = topic->hash_next;
     }
 
     DLOG(("find_topic: NOT FOUND\n"));
@@ -135,18 +159,24 @@ static struct help_link * new_link() {
 /**
  * Allocate a new topic and add it to the list of topics.
  *
+ * @param key the topic key
+ * @param title the topic title
  * @return the new help_topic
  */
-struct help_topic * new_topic() {
+static struct help_topic * new_topic(char * key, wchar_t * title) {
     struct help_topic * topic;
+    unsigned int hash;
     DLOG(("new_topic() : "));
     topic =
         (struct help_topic *) Xmalloc(sizeof(struct help_topic), __FILE__,
                                       __LINE__);
     memset(topic, 0, sizeof(struct help_topic));
+    topic->key = key;
+    topic->title = title;
 
     /*
-     * Prepend to list of topics.
+     * Prepend to list of topics, and to its hash bucket so that the newest
+     * topic with a key is found first.
      */
     if (TOPICS == NULL) {
         TOPICS = topic;
@@ -154,6 +184,9 @@ struct help_topic * new_topic() {
         topic->next = TOPICS;
         TOPICS = topic;
     }
+    hash = topic_hash(key);
+    topic->hash_next = topic_table[hash];
+    topic_table[hash] = topic;
 
     DLOG2(("%p\n", topic));
     return topic;
@@ -607,9 +640,7 @@ static void build_help_index() {
     /*
      * Finally, build the index topic itself.
      */
-    topic_index = new_topic();
-    topic_index->key = HELP_INDEX_KEY;
-    topic_index->title = L"Index";
+    topic_index = new_topic(HELP_INDEX_KEY, L"Index");
     line_number = 0;
 
     for (i = 0; i < index_links_n; i++) {
@@ -636,7 +667,8 @@ static void build_help_index() {
 }
 
 /**
- * Parse raw_help_text into data structures to feed help_handler().
+ * Parse raw_help_text into data structures to feed help_handler().  This
+ * is done the first time help is launched; later calls do nothing.
  */
 void setup_help() {
 
@@ -665,6 +697,11 @@ void setup_help() {
     int rc;
     unsigned int i;
 
+    if (help_ready == Q_TRUE) {
+        return;
+    }
+    help_ready = Q_TRUE;
+
     DLOG(("HELP: setup_help()\n"));
 
     /*
@@ -769,9 +806,8 @@ void setup_help() {
 
                 memset(title_wcs, 0, sizeof(title_wcs));
                 convert_unicode(title, title_wcs);
-                topic = new_topic();
-                topic->key = Xstrdup(key, __FILE__, __LINE__);
-                topic->title = Xwcsdup(title_wcs, __FILE__, __LINE__);
+                topic = new_topic(Xstrdup(key, __FILE__, __LINE__),
+                                  Xwcsdup(title_wcs, __FILE__, __LINE__));
 
 
                 DLOG(("Added topic key: \'%s\' Title: \'%ls\'\n", topic->key,
@@ -1472,6 +1508,8 @@ reload:
  * @param help_screen the screen to start with
  */
 void launch_help(Q_HELP_SCREEN help_screen) {
+    setup_help();
+
     switch (help_screen) {
     case Q_HELP_PHONEBOOK:
         help_handler(HELP_PHONEBOOK_KEY);
@@ -1634,6 +1672,15 @@ char * raw_help_text = \
 "Windows-1251 (Cyrillic), Windows-1252 (West European), KOI8-R (Russian), and\n"
 "KOI8-U (Ukrainian).\n"
 "\n"
+"@BOLD{Alt-'} New Session\n"
+"This opens a new session and brings up the phone book to dial it.  The\n"
+"current connection keeps running in the background, including capture\n"
+"and logging.  Modem and serial connections cannot run in the background.\n"
+"\n"
+"@BOLD{Alt-.} Next Session\n"
+"This switches to the next open session.  A session that has gone offline\n"
+"is closed when it is switched away from.\n"
+"\n"
 "@BOLD{Alt-/} Scroll Back\n"
 "This selects the scrollback buffer.  When viewing the buffer, @BOLD{S}\n"
 "saves to file and @BOLD{C} clears the scrollback buffer.  By default qodem\n"
@@ -2412,6 +2459,8 @@ char * raw_help_text = \
 "    @BOLD{Alt-\\}    Alt Code Key           -\n"
 "    @BOLD{Alt-;}    Codepage               -\n"
 "    @BOLD{Alt-:}    Colors                 -\n"
+"    @BOLD{Alt-'}    New Session            -\n"
+"    @BOLD{Alt-.}    Next Session           -\n"
 "\n"
 "The Phone Book stores an arbitrary number of entries, not the\n"
 "hard-coded 200 of Qmodem.\n"
@@ -2792,6 +2841,27 @@ char * raw_help_text = \
 "@BOLD{--play-exit}\n"
 "    If @BOLD{--play} was specified, exit immediately after playing MUSIC.\n"
 "\n"
+"@BOLD{--replay} FILENAME\n"
+"    Play back FILENAME, a capture saved with the 'Timed' capture type,\n"
+"    in the console.  While it plays, Space pauses and resumes, + and -\n"
+"    double and halve the speed, Left and Right seek 10 seconds, PgUp and\n"
+"    PgDn seek 5 minutes, Home and End jump to the start and end, and\n"
+"    ESC stops the replay.\n"
+"\n"
+"@BOLD{--replay-speed} N\n"
+"    Start the @BOLD{--replay} at N times real speed, up to 64.\n"
+"\n"
+"@BOLD{--render} { text | html }\n"
+"    Run each FILE named on the command line through the emulator\n"
+"    without opening a screen, save the result to FILE.txt or FILE.html,\n"
+"    and exit.  @BOLD{--emulation}, @BOLD{--codepage}, and @BOLD{--geometry}\n"
+"    select how the files are interpreted.  Useful for converting captures\n"
+"    and ANSI art in bulk.\n"
+"\n"
+"@BOLD{--render-jobs} N\n"
+"    Render N files at once with @BOLD{--render}.  The default is one per\n"
+"    CPU.\n"
+"\n"
 "@BOLD{--geometry} COLSxROWS\n"
 "    Request text window size COLS x ROWS.\n"
 "\n"
@@ -2883,6 +2953,12 @@ char * raw_help_text = \
 "enter chat mode, or press @BOLD{Alt-H} to forcibly hangup the user (terminate the\n"
 "connection).\n"
 "\n"
+"The socket, telnetd, and sshd hosts accept more than one caller at a time,\n"
+"up to @BOLD{host_max_callers} in the options file.  Only one caller is shown\n"
+"on the screen; press @BOLD{Alt-N} to switch to the next one.  A caller that\n"
+"pages the sysop or starts a file transfer is brought to the screen.  Only\n"
+"one file transfer can run at a time.\n"
+"\n"
 "\n"
 "\n"
 "See Also: @LINK{CONSOLE_MENU,TERMINAL Mode Commands , 12}\n"
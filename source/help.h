@@ -52,8 +52,8 @@ typedef enum {
 /* Functions -------------------------------------------------------------- */
 
 /**
- * This must be called to initialize the help screens from the long raw help
- * text string.
+ * Parse raw_help_text into data structures to feed help_handler().  This
+ * is done the first time help is launched; later calls do nothing.
  */
 extern void setup_help();
 
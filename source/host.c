@@ -31,8 +31,10 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <errno.h>
-#if defined(Q_PDCURSES_WIN32) && !defined(__BORLANDC__)
+#ifdef Q_PDCURSES_WIN32
 #  include <windows.h>
+#endif
+#if defined(Q_PDCURSES_WIN32) && !defined(__BORLANDC__)
 #  include <shlwapi.h>
 #  define S_ISDIR(x) ((x & _S_IFDIR))
 #endif
@@ -45,6 +47,7 @@
 #include "music.h"
 #include "protocols.h"
 #include "translate.h"
+#include "session.h"
 #include "host.h"
 
 /* Set this to a not-NULL value to enable debug log. */
@@ -56,6 +59,25 @@ static const char * DLOGNAME = NULL;
 /* The file in ~/qodem/hosts that stores user-generated messages. */
 #define MESSAGE_FILENAME "messages.txt"
 
+/*
+ * A killed message has its "." separator line overwritten with this line
+ * of the same length.  It cannot be typed into the line editor, where DEL
+ * is backspace.
+ */
+#define MESSAGE_KILLED "\x7f"
+
+/*
+ * The messages file is compacted when it holds at least this many killed
+ * messages, and more killed messages than live ones.
+ */
+#define MESSAGE_COMPACT_MIN 16
+
+/* The most callers that can be connected at once to a network host. */
+#define HOST_MAX_CALLERS 16
+
+/* The number of files shown per page of the files listing. */
+#define LIST_FILES_PAGE 20
+
 /**
  * The available host mode functions.
  */
@@ -78,6 +100,7 @@ typedef enum {
     UPLOAD_FILE_ZMODEM,
     UPLOAD_FILE_KERMIT,
     LIST_FILES,
+    LIST_FILES_MORE,
     DOWNLOAD_FILE,
     DOWNLOAD_FILE_XMODEM,
     DOWNLOAD_FILE_YMODEM,
@@ -128,7 +151,9 @@ static void previous_message();
 static void next_message();
 static void page_sysop();
 static void chat();
+static void list_files_menu();
 static void list_files();
+static void list_files_page();
 static void download_file_menu();
 static void upload_file_menu();
 static void main_menu();
@@ -142,6 +167,11 @@ static void upload_file_ymodem();
 static void upload_file_zmodem();
 static void upload_file_kermit();
 static void enter_message_finish_menu();
+static void clear_messages_index();
+static void clear_filename();
+static Q_BOOL foreground_next_caller();
+static void close_background_callers();
+static void clear_host_files();
 
 /**
  * The state transition table
@@ -150,7 +180,7 @@ static struct host_state states[] = {
     {MAIN_MENU, 'e', ENTER_MESSAGE, enter_message},
     {MAIN_MENU, 'r', READ_MESSAGES, read_messages_menu},
     {MAIN_MENU, 'p', PAGE_SYSOP, page_sysop},
-    {MAIN_MENU, 'f', MAIN_MENU, list_files},
+    {MAIN_MENU, 'f', LIST_FILES, list_files_menu},
     {MAIN_MENU, 'd', DOWNLOAD_FILE, download_file_menu},
     {MAIN_MENU, 'u', UPLOAD_FILE, upload_file_menu},
     {MAIN_MENU, 'g', GOODBYE, goodbye},
@@ -188,6 +218,10 @@ static struct host_state states[] = {
     {ENTER_MESSAGE_FINISH, 's', MAIN_MENU, save_message},
     {ENTER_MESSAGE_FINISH, C_CR, ENTER_MESSAGE_FINISH,
      enter_message_finish_menu},
+    {LIST_FILES, 0, LIST_FILES, list_files},
+    {LIST_FILES_MORE, 'q', MAIN_MENU, main_menu},
+    {LIST_FILES_MORE, C_CR, LIST_FILES_MORE, list_files_page},
+    {LIST_FILES_MORE, C_LF, LIST_FILES_MORE, list_files_page},
     {CHAT, 0, CHAT, chat},
     {LOGIN, 0, LOGIN, do_login},
 
@@ -248,11 +282,30 @@ static wchar_t * msg_to = NULL;
 static wchar_t ** msg_body = NULL;
 static int msg_body_n = 0;
 
-/* The messages list supporting the read messages function. */
-static wchar_t *** all_messages = NULL;
-static int all_messages_n = 0;
+/* The message being read by the read messages function. */
 static int current_message = 0;
 
+/*
+ * The messages file index: the file offset of the separator line of each
+ * live message, in file order.  It is shared by all callers, and is
+ * re-scanned only when the file's size or mtime shows that something else
+ * changed it.
+ */
+static long * message_offsets = NULL;
+static int message_offsets_n = 0;
+static int message_offsets_max = 0;
+static int messages_killed = 0;
+static long messages_size = -1;
+static time_t messages_mtime;
+
+/*
+ * messages_serial counts the changes that renumber the messages.  A
+ * caller's current_message is stale when messages_seen_serial does not
+ * match it, i.e. another caller killed a message after it was displayed.
+ */
+static unsigned long messages_serial = 0;
+static unsigned long messages_seen_serial = 0;
+
 /**
  * The available states for the file transfer menus.
  */
@@ -273,6 +326,43 @@ static FILE_STATE file_state = FILENAME;
  */
 static char * transfer_filename;
 
+/**
+ * The full path of the file being uploaded, kept while asking about resume.
+ */
+static char * upload_filename = NULL;
+
+/**
+ * One entry in the host directory index.
+ */
+struct host_file {
+    char * name;
+    struct stat fstats;
+};
+
+/*
+ * The host directory index, sorted by name.  It is shared by all callers
+ * and rebuilt only when the directory's mtime shows that it changed.
+ */
+static struct host_file * host_files = NULL;
+static int host_files_n = 0;
+static Q_BOOL host_files_valid = Q_FALSE;
+static time_t host_files_mtime;
+static time_t host_files_time;
+
+/**
+ * Set when an upload is started, so that the index is rebuilt once the
+ * transfer is over (the file size changes without touching the directory).
+ */
+static Q_BOOL upload_running = Q_FALSE;
+
+/*
+ * The files listing state: the lowercase glob to match, the last name
+ * shown, and how many files were shown so far.
+ */
+static char list_pattern[COMMAND_LINE_SIZE];
+static char list_last[FILENAME_SIZE];
+static int list_shown = 0;
+
 /**
  * The available states for the login function.
  */
@@ -330,6 +420,84 @@ Q_BOOL q_host_active;
  */
 static Q_BOOL page = Q_FALSE;
 
+/**
+ * Everything host mode keeps about one caller.  Only one caller at a time
+ * is live in the statics above, q_child_tty_fd, and the netclient
+ * connection state; the others wait here until they have data to process
+ * or the sysop switches to them.
+ */
+struct host_caller {
+    Q_BOOL in_use;
+    int child_tty_fd;
+    Q_BOOL online;
+    void * net_state;
+    STATE current_state;
+    STATE chat_previous_state;
+    STATE chat_previous_line_buffer;
+    Q_BOOL host_online;
+    Q_BOOL local_login;
+    Q_BOOL sysop_chat;
+    Q_BOOL page;
+    MSG_STATE msg_state;
+    wchar_t * msg_from;
+    wchar_t * msg_to;
+    wchar_t ** msg_body;
+    int msg_body_n;
+    int current_message;
+    unsigned long messages_seen_serial;
+    FILE_STATE file_state;
+    char * transfer_filename;
+    char * upload_filename;
+    char list_pattern[COMMAND_LINE_SIZE];
+    char list_last[FILENAME_SIZE];
+    int list_shown;
+    LOGIN_STATE login_state;
+    char login_username[64];
+    char login_password[64];
+    wchar_t line_buffer[80];
+    int line_buffer_n;
+    wchar_t saved_line_buffer[80];
+    int saved_line_buffer_n;
+    Q_BOOL do_line_buffer;
+    uint32_t utf8_state;
+    uint32_t utf8_char;
+};
+
+/**
+ * The caller slots.  The slot of the live caller is stale until it is
+ * swapped out again.  Node numbers shown to the sysop are slot + 1.
+ */
+static struct host_caller callers[HOST_MAX_CALLERS];
+
+/**
+ * The slot of the caller that is live, i.e. on the sysop's screen.
+ */
+static int live_caller = 0;
+
+/**
+ * The host_max_callers option, read when host mode starts.
+ */
+static int max_callers = 1;
+
+/**
+ * When true, the live caller is being processed in the background: output
+ * goes only to the caller, not to the screen or capture file.
+ */
+static Q_BOOL background = Q_FALSE;
+
+/**
+ * When true, a file transfer is running for the caller on the sysop's
+ * screen, so background callers cannot start one or page the sysop.
+ */
+static Q_BOOL transfer_busy = Q_FALSE;
+
+/**
+ * When true, the sysop is chatting with, being paged by, or locally logged
+ * on as the caller on the screen, so background callers cannot page the
+ * sysop.
+ */
+static Q_BOOL sysop_busy = Q_FALSE;
+
 /**
  * Clear the line buffer.
  */
@@ -372,33 +540,29 @@ static void reset_host() {
 }
 
 /**
- * Send a string to the remote side, echoing to the local side also.
+ * Echo a string to the local side (and the capture file) only.
  *
- * @param buffer the bytes to send to the remote side
+ * @param buffer the bytes to display
  * @param count the number of bytes in buffer
  */
-static void host_write(char * buffer, int count) {
+static void host_echo(char * buffer, int count) {
+    unsigned char ch;
     int i;
-    if (host_online == Q_TRUE) {
-        qodem_write(q_child_tty_fd, buffer, count, Q_TRUE);
-    }
     for (i = 0; i < count; i++) {
 
         /*
          * Capture
          */
         if (q_status.capture == Q_TRUE) {
-            if (q_status.capture_type == Q_CAPTURE_TYPE_RAW) {
+            if ((q_status.capture_type == Q_CAPTURE_TYPE_RAW) ||
+                (q_status.capture_type == Q_CAPTURE_TYPE_TIMED)
+            ) {
                 /*
                  * Raw - use the translation map here because it will match
                  * what went out on the wire.
                  */
-                fprintf(q_status.capture_file, "%c",
-                    translate_8bit_out(buffer[i]));
-                if (q_status.capture_flush_time < time(NULL)) {
-                    fflush(q_status.capture_file);
-                    q_status.capture_flush_time = time(NULL);
-                }
+                ch = translate_8bit_out(buffer[i]);
+                capture_raw(&ch, 1);
             }
         }
 
@@ -427,6 +591,21 @@ static void host_write(char * buffer, int count) {
     q_screen_dirty = Q_TRUE;
 }
 
+/**
+ * Send a string to the remote side, echoing to the local side also.
+ *
+ * @param buffer the bytes to send to the remote side
+ * @param count the number of bytes in buffer
+ */
+static void host_write(char * buffer, int count) {
+    if (host_online == Q_TRUE) {
+        qodem_write(q_child_tty_fd, buffer, count, Q_TRUE);
+    }
+    if (background == Q_FALSE) {
+        host_echo(buffer, count);
+    }
+}
+
 /**
  * Emit a menu string to the remote side.  This also performs translation of
  * the string.
@@ -456,6 +635,20 @@ void host_start(Q_HOST_TYPE type, const char * port) {
     reset_host();
     q_host_active = Q_TRUE;
 
+    /*
+     * The first caller always lands in the first slot
+     */
+    memset(callers, 0, sizeof(callers));
+    callers[0].in_use = Q_TRUE;
+    live_caller = 0;
+    max_callers = atoi(get_option(Q_OPTION_HOST_MAX_CALLERS));
+    if (max_callers < 1) {
+        max_callers = 1;
+    }
+    if (max_callers > HOST_MAX_CALLERS) {
+        max_callers = HOST_MAX_CALLERS;
+    }
+
     /*
      * Setup the listener depending on host type
      */
@@ -571,9 +764,15 @@ void host_start(Q_HOST_TYPE type, const char * port) {
  * Kill host mode.
  */
 static void host_stop() {
+    int i;
 
     qlog(_("Leaving host mode.\n"));
 
+    /*
+     * Hang up on everyone who is not on the screen
+     */
+    close_background_callers();
+
     /*
      * Kill the listening socket
      */
@@ -624,6 +823,16 @@ static void host_stop() {
 
     host_online = Q_FALSE;
     q_host_active = Q_FALSE;
+    clear_host_files();
+    clear_messages_index();
+
+    for (i = 0; i < HOST_MAX_CALLERS; i++) {
+        if (callers[i].net_state != NULL) {
+            Xfree(callers[i].net_state, __FILE__, __LINE__);
+            callers[i].net_state = NULL;
+        }
+        callers[i].in_use = Q_FALSE;
+    }
 }
 
 /**
@@ -684,8 +893,10 @@ static Q_BOOL line_buffer_char(const unsigned char ch) {
     if (line_buffer_n < 80) {
         line_buffer[line_buffer_n] = (wchar_t) utf8_char;
         line_buffer_n++;
-        print_character((wchar_t) utf8_char);
-        q_screen_dirty = Q_TRUE;
+        if (background == Q_FALSE) {
+            print_character((wchar_t) utf8_char);
+            q_screen_dirty = Q_TRUE;
+        }
         if ((current_state == LOGIN) && (login_state == PASSWORD)) {
             rc = utf8_encode(L'X', utf8_buffer);
         } else {
@@ -943,24 +1154,168 @@ static void kill_message() {
     main_menu();
 }
 
+/**
+ * Build the full path to the messages file.
+ *
+ * @return the newly-allocated filename
+ */
+static char * messages_filename() {
+    char * filename;
+
+    filename = (char *) Xmalloc(strlen(MESSAGE_FILENAME) +
+                                strlen(get_option(Q_OPTION_HOST_DIR)) + 2,
+                                __FILE__, __LINE__);
+    sprintf(filename, "%s/%s", get_option(Q_OPTION_HOST_DIR),
+            MESSAGE_FILENAME);
+    return filename;
+}
+
+/* Forget the messages file index */
+static void clear_messages_index() {
+    if (message_offsets != NULL) {
+        Xfree(message_offsets, __FILE__, __LINE__);
+        message_offsets = NULL;
+    }
+    message_offsets_n = 0;
+    message_offsets_max = 0;
+    messages_killed = 0;
+    messages_size = -1;
+}
+
+/**
+ * Add a message to the end of the messages file index.
+ *
+ * @param offset the file offset of the message's separator line
+ */
+static void add_message_offset(const long offset) {
+    if (message_offsets_n == message_offsets_max) {
+        message_offsets_max = (message_offsets_max == 0) ? 256 :
+                              message_offsets_max * 2;
+        message_offsets = (long *) Xrealloc(message_offsets,
+                                            sizeof(long) * message_offsets_max,
+                                            __FILE__, __LINE__);
+    }
+    message_offsets[message_offsets_n] = offset;
+    message_offsets_n++;
+}
+
+/**
+ * Remember the messages file's size and mtime after this module wrote to
+ * it, so that the write does not look like an outside change.
+ *
+ * @param filename the messages file
+ */
+static void messages_written(const char * filename) {
+    struct stat fstats;
+
+    if (stat(filename, &fstats) == 0) {
+        messages_size = (long) fstats.st_size;
+        messages_mtime = fstats.st_mtime;
+    } else {
+        messages_size = -1;
+    }
+}
+
+/**
+ * Bring the messages file index up to date.  This is a stat() unless the
+ * file was changed by someone else, in which case it is scanned once.
+ *
+ * @return true if the index is usable
+ */
+static Q_BOOL index_messages() {
+    FILE * file;
+    char * filename;
+    struct stat fstats;
+    char line[Q_MAX_LINE_LENGTH];
+    long offset;
+
+    filename = messages_filename();
+    if (stat(filename, &fstats) < 0) {
+        /*
+         * File isn't present, there are no messages
+         */
+        if ((messages_size != 0) || (message_offsets_n > 0)) {
+            messages_serial++;
+        }
+        clear_messages_index();
+        messages_size = 0;
+        Xfree(filename, __FILE__, __LINE__);
+        return Q_TRUE;
+    }
+
+    if ((messages_size == (long) fstats.st_size) &&
+        (messages_mtime == fstats.st_mtime)
+    ) {
+        /*
+         * Unchanged since we last looked
+         */
+        Xfree(filename, __FILE__, __LINE__);
+        return Q_TRUE;
+    }
+
+    DLOG(("index_messages(): re-scanning %s\n", filename));
+
+    clear_messages_index();
+    messages_serial++;
+
+    file = fopen(filename, "r");
+    if (file == NULL) {
+        snprintf(line, sizeof(line),
+                 _("Error opening file \"%s\" for reading: %s"),
+                 filename, strerror(errno));
+        host_write(line, strlen(line));
+        Xfree(filename, __FILE__, __LINE__);
+        return Q_FALSE;
+    }
+
+    for (;;) {
+        offset = ftell(file);
+        if (fgets(line, sizeof(line), file) == NULL) {
+            break;
+        }
+        while ((strlen(line) > 0) && q_isspace(line[strlen(line) - 1])) {
+            /*
+             * Trim trailing whitespace
+             */
+            line[strlen(line) - 1] = '\0';
+        }
+
+        if (strcmp(line, ".") == 0) {
+            /*
+             * Single period is the message separator since it cannot be
+             * entered in the line editor.
+             */
+            add_message_offset(offset);
+        } else if (strcmp(line, MESSAGE_KILLED) == 0) {
+            messages_killed++;
+        }
+    }
+    fclose(file);
+
+    messages_size = (long) fstats.st_size;
+    messages_mtime = fstats.st_mtime;
+
+    /*
+     * No leak
+     */
+    Xfree(filename, __FILE__, __LINE__);
+    return Q_TRUE;
+}
+
 /* Save a message to the message file */
 static void save_message() {
     FILE * file;
     char * filename;
     char notify_message[DIALOG_MESSAGE_SIZE];
+    long offset;
     int i;
 
-    filename = (char *) Xmalloc(strlen(MESSAGE_FILENAME) +
-                                strlen(get_option(Q_OPTION_HOST_DIR)) + 2,
-                                __FILE__, __LINE__);
-    memset(filename, 0,
-           strlen(MESSAGE_FILENAME) + strlen(get_option(Q_OPTION_HOST_DIR)) +
-           2);
-    strncpy(filename, get_option(Q_OPTION_HOST_DIR),
-            strlen(get_option(Q_OPTION_HOST_DIR)));
-    filename[strlen(filename)] = '/';
-    strncpy(filename + strlen(filename), MESSAGE_FILENAME,
-            strlen(MESSAGE_FILENAME));
+    /*
+     * Make sure the index is current before adding to it
+     */
+    index_messages();
+
+    filename = messages_filename();
 
     /*
      * Append to file
@@ -971,8 +1326,11 @@ static void save_message() {
                  _("Error opening file \"%s\" for writing: %s"),
                  filename, strerror(errno));
         host_write(notify_message, strlen(notify_message));
+        Xfree(filename, __FILE__, __LINE__);
         return;
     }
+    fseek(file, 0, SEEK_END);
+    offset = ftell(file);
 
     /*
      * Emit message to file
@@ -995,6 +1353,13 @@ static void save_message() {
      */
     fclose(file);
 
+    /*
+     * The new message goes on the end of the index.  Nobody else's
+     * message numbers change.
+     */
+    add_message_offset(offset);
+    messages_written(filename);
+
     /*
      * No leak
      */
@@ -1011,284 +1376,171 @@ static void save_message() {
     main_menu();
 }
 
-/* Clear messages from memory */
-static void clear_all_messages() {
-    int message_i;
-    int line_i;
-    wchar_t ** message;
-    wchar_t * line;
-    if (all_messages != NULL) {
-        assert(all_messages_n > 0);
-        for (message_i = 0; message_i < all_messages_n; message_i++) {
-            message = all_messages[message_i];
-            line_i = 0;
-            line = message[line_i];
-            while (line != NULL) {
-                Xfree(line, __FILE__, __LINE__);
-                line_i++;
-                line = message[line_i];
-            }
-            Xfree(message, __FILE__, __LINE__);
-            message_i++;
-        }
+/* Switch to previous message */
+static void previous_message() {
+    if (current_message > 0) {
+        current_message--;
+    }
+    /*
+     * Re-display the read message menu
+     */
+    read_messages_menu();
+}
 
-        Xfree(all_messages, __FILE__, __LINE__);
-        all_messages = NULL;
-        all_messages_n = 0;
+/* Switch to next message */
+static void next_message() {
+    if (current_message < message_offsets_n - 1) {
+        current_message++;
     }
+    /*
+     * Re-display the read message menu
+     */
+    read_messages_menu();
 }
 
-/* Load all messages into memory */
-static void read_all_messages() {
+/**
+ * Rewrite the messages file without its killed messages.
+ *
+ * @param filename the messages file
+ */
+static void compact_messages(const char * filename) {
     FILE * file;
-    char * filename;
-    char notify_message[DIALOG_MESSAGE_SIZE];
-    char * begin;
-    wchar_t ** message = NULL;
-    int message_n = 0;
-    wchar_t line_wchar[Q_MAX_LINE_LENGTH];
+    FILE * new_file;
+    char * new_filename;
     char line[Q_MAX_LINE_LENGTH];
+    char trimmed[Q_MAX_LINE_LENGTH];
+    Q_BOOL keep = Q_TRUE;
 
-    filename = (char *) Xmalloc(strlen(MESSAGE_FILENAME) +
-                                strlen(get_option(Q_OPTION_HOST_DIR)) + 2,
-                                __FILE__, __LINE__);
-    memset(filename, 0,
-           strlen(MESSAGE_FILENAME) + strlen(get_option(Q_OPTION_HOST_DIR)) +
-           2);
-    strncpy(filename, get_option(Q_OPTION_HOST_DIR),
-            strlen(get_option(Q_OPTION_HOST_DIR)));
-    filename[strlen(filename)] = '/';
-    strncpy(filename + strlen(filename), MESSAGE_FILENAME,
-            strlen(MESSAGE_FILENAME));
+    DLOG(("compact_messages(): %d live %d killed\n", message_offsets_n,
+          messages_killed));
 
-    /*
-     * Read from file
-     */
-    if (file_exists(filename) == Q_FALSE) {
-        /*
-         * File isn't present, bail out
-         */
-        return;
-    }
+    new_filename = (char *) Xmalloc(strlen(filename) + 5, __FILE__, __LINE__);
+    sprintf(new_filename, "%s.new", filename);
 
     file = fopen(filename, "r");
     if (file == NULL) {
-        snprintf(notify_message, sizeof(notify_message),
-                 _("Error opening file \"%s\" for reading: %s"),
-                 filename, strerror(errno));
-        host_write(notify_message, strlen(notify_message));
+        Xfree(new_filename, __FILE__, __LINE__);
+        return;
+    }
+    new_file = fopen(new_filename, "w");
+    if (new_file == NULL) {
+        fclose(file);
+        Xfree(new_filename, __FILE__, __LINE__);
         return;
     }
 
-    while (!feof(file)) {
-        if (fgets(line, sizeof(line), file) == NULL) {
-            /*
-             * This will cause the outer while's feof() check to fail and
-             * smoothly exit the while loop.
-             */
-            continue;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        strcpy(trimmed, line);
+        while ((strlen(trimmed) > 0) &&
+               q_isspace(trimmed[strlen(trimmed) - 1])) {
+            trimmed[strlen(trimmed) - 1] = '\0';
         }
-        begin = line;
-
-        while ((strlen(line) > 0) && q_isspace(line[strlen(line) - 1])) {
-            /*
-             * Trim trailing whitespace
-             */
-            line[strlen(line) - 1] = '\0';
+        if (strcmp(trimmed, ".") == 0) {
+            keep = Q_TRUE;
+        } else if (strcmp(trimmed, MESSAGE_KILLED) == 0) {
+            keep = Q_FALSE;
         }
-        while (q_isspace(*begin)) {
-            /*
-             * Trim leading whitespace
-             */
-            begin++;
+        if (keep == Q_TRUE) {
+            fputs(line, new_file);
         }
+    }
+    fclose(file);
 
+    if (fclose(new_file) == 0) {
+#ifdef Q_PDCURSES_WIN32
         /*
-         * Convert from UTF-8
+         * rename() will not replace an existing file on Windows, but
+         * MoveFileExA() can do it without a window where neither exists.
          */
-        memset(line_wchar, 0, sizeof(line_wchar));
-        mbstowcs(line_wchar, begin, strlen(begin) + 1);
-
-        /*
-         * See if this is '.'
-         */
-        if (wcscmp(line_wchar, L".") == 0) {
-            /*
-             * New message
-             */
-            all_messages = (wchar_t ***) Xrealloc(all_messages,
-                                                  sizeof(wchar_t **) *
-                                                  (all_messages_n + 1),
-                                                  __FILE__, __LINE__);
-            all_messages_n++;
-
-            if (message != NULL) {
-                message = (wchar_t **) Xrealloc(message,
-                                                sizeof(wchar_t *) * (message_n +
-                                                                     1),
-                                                __FILE__, __LINE__);
-                message[message_n] = NULL;
-                all_messages[all_messages_n - 2] = message;
-                message = NULL;
-                message_n = 0;
-            }
-            continue;
-        }
-
-        /*
-         * Append this line to message
-         */
-        message =
-            (wchar_t **) Xrealloc(message, sizeof(wchar_t *) * (message_n + 1),
-                                  __FILE__, __LINE__);
-        message[message_n] = Xwcsdup(line_wchar, __FILE__, __LINE__);
-        message_n++;
-    }
+        if (MoveFileExA(new_filename, filename,
+                        MOVEFILE_REPLACE_EXISTING |
+                        MOVEFILE_WRITE_THROUGH) == 0
+        ) {
+            unlink(new_filename);
+        }
+#else
+        if (rename(new_filename, filename) != 0) {
+            unlink(new_filename);
+        }
+#endif
+    } else {
+        unlink(new_filename);
+    }
 
     /*
-     * Append last message
+     * Every offset moved, start over
      */
-    if (message != NULL) {
-        message =
-            (wchar_t **) Xrealloc(message, sizeof(wchar_t *) * (message_n + 1),
-                                  __FILE__, __LINE__);
-        message[message_n] = NULL;
-        all_messages[all_messages_n - 1] = message;
-        message = NULL;
-        message_n = 0;
-    }
-
-    /*
-     * All done
-     */
-    fclose(file);
+    clear_messages_index();
+    index_messages();
 
     /*
      * No leak
      */
-    Xfree(filename, __FILE__, __LINE__);
+    Xfree(new_filename, __FILE__, __LINE__);
 }
 
-/* Switch to previous message */
-static void previous_message() {
-    if (current_message > 0) {
-        current_message--;
-    }
-    /*
-     * Re-display the read message menu
-     */
-    read_messages_menu();
-}
-
-/* Switch to next message */
-static void next_message() {
-    if (current_message < all_messages_n - 1) {
-        current_message++;
-    }
-    /*
-     * Re-display the read message menu
-     */
-    read_messages_menu();
-}
-
-/* Update the entire messages file */
-static void save_all_messages() {
-    int message_i;
-    int line_i;
-    wchar_t ** message;
-    wchar_t * line;
+/* Remove the current message */
+static void kill_read_message() {
     FILE * file;
     char * filename;
     char notify_message[DIALOG_MESSAGE_SIZE];
 
-    filename = (char *) Xmalloc(strlen(MESSAGE_FILENAME) +
-                                strlen(get_option(Q_OPTION_HOST_DIR)) + 2,
-                                __FILE__, __LINE__);
-    memset(filename, 0,
-           strlen(MESSAGE_FILENAME) + strlen(get_option(Q_OPTION_HOST_DIR)) +
-           2);
-    strncpy(filename, get_option(Q_OPTION_HOST_DIR),
-            strlen(get_option(Q_OPTION_HOST_DIR)));
-    filename[strlen(filename)] = '/';
-    strncpy(filename + strlen(filename), MESSAGE_FILENAME,
-            strlen(MESSAGE_FILENAME));
+    index_messages();
+    if (messages_seen_serial != messages_serial) {
+        /*
+         * Another caller killed a message since this one was displayed, so
+         * current_message might not be the same message any more.  Show
+         * it again and let the user pick again.
+         */
+        do_menu(EOL "The messages were changed by another caller." EOL);
+        read_messages_menu();
+        return;
+    }
+    if (current_message >= message_offsets_n) {
+        read_messages_menu();
+        return;
+    }
+
+    filename = messages_filename();
 
     /*
-     * Overwrite file
+     * Overwrite the message's separator with the tombstone, in place
      */
-    file = fopen(filename, "w");
+    file = fopen(filename, "r+");
     if (file == NULL) {
         snprintf(notify_message, sizeof(notify_message),
                  _("Error opening file \"%s\" for writing: %s"),
                  filename, strerror(errno));
         host_write(notify_message, strlen(notify_message));
+        Xfree(filename, __FILE__, __LINE__);
+        read_messages_menu();
         return;
     }
-
-    if (all_messages != NULL) {
-        assert(all_messages_n > 0);
-        for (message_i = 0; message_i < all_messages_n; message_i++) {
-            /*
-             * Single period is the message separator since it cannot be
-             * entered in the line editor.
-             */
-            fprintf(file, ".\n");
-            message = all_messages[message_i];
-            line_i = 0;
-            line = message[line_i];
-            while (line != NULL) {
-                fprintf(file, "%ls\n", line);
-                line_i++;
-                line = message[line_i];
-            }
-            message_i++;
-        }
-    }
-
-    /*
-     * All done
-     */
+    fseek(file, message_offsets[current_message], SEEK_SET);
+    fputs(MESSAGE_KILLED, file);
     fclose(file);
-
-    /*
-     * No leak
-     */
-    Xfree(filename, __FILE__, __LINE__);
-}
-
-/* Remove the current message */
-static void kill_read_message() {
-    wchar_t * line;
-    int line_i;
-    wchar_t ** message;
-
-    message = all_messages[current_message];
-    memmove(all_messages + current_message,
-            all_messages + current_message + 1,
-            all_messages_n - current_message - 1);
-    all_messages_n--;
-    if (current_message == all_messages_n) {
+    messages_written(filename);
+
+    memmove(message_offsets + current_message,
+            message_offsets + current_message + 1,
+            sizeof(long) * (message_offsets_n - current_message - 1));
+    message_offsets_n--;
+    messages_killed++;
+    if ((current_message == message_offsets_n) && (current_message > 0)) {
         current_message--;
     }
+    messages_serial++;
 
-    line_i = 0;
-    line = message[line_i];
-    while (line != NULL) {
-        Xfree(line, __FILE__, __LINE__);
-        line_i++;
-        line = message[line_i];
-    }
-    Xfree(message, __FILE__, __LINE__);
-
-    if (all_messages_n == 0) {
-        Xfree(all_messages, __FILE__, __LINE__);
-        all_messages = NULL;
+    if ((messages_killed >= MESSAGE_COMPACT_MIN) &&
+        (messages_killed > message_offsets_n)
+    ) {
+        compact_messages(filename);
     }
 
     /*
-     * Update messages file
+     * No leak
      */
-    save_all_messages();
+    Xfree(filename, __FILE__, __LINE__);
 
     /*
      * Re-display the read message menu
@@ -1298,40 +1550,70 @@ static void kill_read_message() {
 
 /* Display one message to the console */
 static void display_message(const int n) {
+    FILE * file;
+    char * filename;
     char buffer[Q_MAX_LINE_LENGTH];
-    int line_i;
-    wchar_t ** message;
-    wchar_t * line;
-    if (all_messages_n == 0) {
+    char line[Q_MAX_LINE_LENGTH];
+    char * begin;
+
+    if (message_offsets_n == 0) {
         do_menu("No messages." EOL);
         return;
     }
 
-    assert(all_messages != NULL);
-    assert(all_messages_n > 0);
-    assert(n < all_messages_n);
+    assert(n < message_offsets_n);
 
-    message = all_messages[n];
+    filename = messages_filename();
+    file = fopen(filename, "r");
+    Xfree(filename, __FILE__, __LINE__);
+    if (file == NULL) {
+        do_menu("No messages." EOL);
+        return;
+    }
 
     /*
      * Print message #
      */
     sprintf(buffer, _("Message #%d of %d%s"), current_message + 1,
-            all_messages_n, EOL);
+            message_offsets_n, EOL);
     host_write(buffer, strlen(buffer));
 
-    line_i = 0;
-    line = message[line_i];
-    while (line != NULL) {
-        sprintf(buffer, "%ls%s", line, EOL);
+    /*
+     * Read just this message: skip its separator, stop at the next one
+     */
+    fseek(file, message_offsets[n], SEEK_SET);
+    fgets(line, sizeof(line), file);
+    while (fgets(line, sizeof(line), file) != NULL) {
+        begin = line;
+
+        while ((strlen(line) > 0) && q_isspace(line[strlen(line) - 1])) {
+            /*
+             * Trim trailing whitespace
+             */
+            line[strlen(line) - 1] = '\0';
+        }
+        if ((strcmp(line, ".") == 0) || (strcmp(line, MESSAGE_KILLED) == 0)) {
+            break;
+        }
+        while (q_isspace(*begin)) {
+            /*
+             * Trim leading whitespace
+             */
+            begin++;
+        }
+
+        snprintf(buffer, sizeof(buffer), "%s%s", begin, EOL);
         host_write(buffer, strlen(buffer));
-        line_i++;
-        line = message[line_i];
     }
+    fclose(file);
 }
 
 /* View a message again */
 static void view_current_message() {
+    index_messages();
+    if ((current_message >= message_offsets_n) && (message_offsets_n > 0)) {
+        current_message = message_offsets_n - 1;
+    }
     do_menu(EOL);
     display_message(current_message);
     do_menu(EOL
@@ -1341,18 +1623,17 @@ static void view_current_message() {
 
 /* Read the saved messages */
 static void read_messages_menu() {
-    if (all_messages == NULL) {
-        read_all_messages();
-    }
+    index_messages();
+    messages_seen_serial = messages_serial;
 
-    if ((current_message >= all_messages_n) && (all_messages_n > 0)
+    if ((current_message >= message_offsets_n) && (message_offsets_n > 0)
         ) {
         do_menu(EOL
             "A message was deleted, displaying last message." EOL);
         /*
          * Truncate to the last message
          */
-        current_message = all_messages_n - 1;
+        current_message = message_offsets_n - 1;
     }
 
     do_menu(EOL);
@@ -1362,134 +1643,294 @@ static void read_messages_menu() {
         "Your choice?  ");
 }
 
-/* List files excluding '.', '..', and the messages file */
-static void list_files() {
+/**
+ * Compare two host_file entries by name for qsort() and bsearch().
+ *
+ * @param a the first entry
+ * @param b the second entry
+ * @return strcmp() of the names
+ */
+static int compare_host_files(const void * a, const void * b) {
+    return strcmp(((const struct host_file *) a)->name,
+                  ((const struct host_file *) b)->name);
+}
+
+/**
+ * Free the host directory index.
+ */
+static void clear_host_files() {
+    int i;
+
+    for (i = 0; i < host_files_n; i++) {
+        Xfree(host_files[i].name, __FILE__, __LINE__);
+    }
+    if (host_files != NULL) {
+        Xfree(host_files, __FILE__, __LINE__);
+        host_files = NULL;
+    }
+    host_files_n = 0;
+    host_files_valid = Q_FALSE;
+}
+
+/**
+ * Make sure the host directory index is current, re-reading the directory
+ * only if it changed since the last time.  '.', '..', hidden files, and the
+ * messages file are not in the index.
+ *
+ * @return true if the index is usable, false if the directory could not be
+ * read
+ */
+static Q_BOOL index_host_files() {
     DIR * directory = NULL;
     struct dirent * dir_entry;
-    char buffer[COMMAND_LINE_SIZE];
     struct stat fstats;
-    int total = 0;
+    char * full_filename;
+    const char * host_dir = get_option(Q_OPTION_HOST_DIR);
+    int host_files_max = 0;
+
+    if (stat(host_dir, &fstats) < 0) {
+        clear_host_files();
+        return Q_FALSE;
+    }
 
     /*
-     * Read directory
+     * The directory mtime only has one second resolution, so an index made
+     * in the same second as the last change might have missed something.
      */
-    directory = opendir(get_option(Q_OPTION_HOST_DIR));
+    if ((host_files_valid == Q_TRUE) &&
+        (fstats.st_mtime == host_files_mtime) &&
+        (host_files_mtime < host_files_time)
+    ) {
+        return Q_TRUE;
+    }
+
+    DLOG(("index_host_files() re-reading %s\n", host_dir));
+
+    clear_host_files();
+    directory = opendir(host_dir);
     if (directory == NULL) {
-        sprintf(buffer, _("Unable to display files in %s%s"),
-                get_option(Q_OPTION_HOST_DIR), EOL);
-        host_write(buffer, strlen(buffer));
-        return;
+        return Q_FALSE;
     }
-    sprintf(buffer, _("%sFiles in host directory:%s"), EOL, EOL);
-    host_write(buffer, strlen(buffer));
+    host_files_mtime = fstats.st_mtime;
+    time(&host_files_time);
 
-    dir_entry = readdir(directory);
-    while (dir_entry != NULL) {
-        char * full_filename;
+    full_filename = (char *) Xmalloc(strlen(host_dir) + FILENAME_SIZE + 2,
+                                     __FILE__, __LINE__);
 
-        /*
-         * Get the full filename
-         */
-        full_filename = (char *) Xmalloc(strlen(dir_entry->d_name) +
-                                         strlen(get_option(Q_OPTION_HOST_DIR)) +
-                                         2, __FILE__, __LINE__);
-        memset(full_filename, 0,
-               strlen(dir_entry->d_name) +
-               strlen(get_option(Q_OPTION_HOST_DIR)) + 2);
-        memcpy(full_filename, get_option(Q_OPTION_HOST_DIR),
-               strlen(get_option(Q_OPTION_HOST_DIR)));
-        full_filename[strlen(get_option(Q_OPTION_HOST_DIR))] = '/';
-        memcpy(full_filename + strlen(get_option(Q_OPTION_HOST_DIR)) + 1,
-               dir_entry->d_name, strlen(dir_entry->d_name));
-        full_filename[strlen(dir_entry->d_name) +
-                      strlen(get_option(Q_OPTION_HOST_DIR)) + 1] = '\0';
+    for (dir_entry = readdir(directory); dir_entry != NULL;
+         dir_entry = readdir(directory)) {
 
         /*
-         * Skip '.', '..', and hidden files
+         * Skip '.', '..', hidden files, and the messages file
          */
-        if (dir_entry->d_name[0] == '.') {
-            dir_entry = readdir(directory);
-            Xfree(full_filename, __FILE__, __LINE__);
-            full_filename = NULL;
+        if ((dir_entry->d_name[0] == '.') ||
+            (strcmp(dir_entry->d_name, MESSAGE_FILENAME) == 0) ||
+            (strlen(dir_entry->d_name) >= FILENAME_SIZE)
+        ) {
             continue;
         }
 
-        /*
-         * Skip the messages file
-         */
-        if (strcmp(dir_entry->d_name, MESSAGE_FILENAME) == 0) {
-            dir_entry = readdir(directory);
-            Xfree(full_filename, __FILE__, __LINE__);
-            full_filename = NULL;
+        sprintf(full_filename, "%s/%s", host_dir, dir_entry->d_name);
+        if (stat(full_filename, &fstats) < 0) {
             continue;
         }
 
-        total++;
+        if (host_files_n == host_files_max) {
+            host_files_max = (host_files_max == 0 ? 64 : host_files_max * 2);
+            host_files = (struct host_file *) Xrealloc(host_files,
+                sizeof(struct host_file) * host_files_max, __FILE__, __LINE__);
+        }
+        host_files[host_files_n].name = Xstrdup(dir_entry->d_name,
+                                                __FILE__, __LINE__);
+        memcpy(&host_files[host_files_n].fstats, &fstats, sizeof(fstats));
+        host_files_n++;
+    }
+    closedir(directory);
+    Xfree(full_filename, __FILE__, __LINE__);
 
-        /*
-         * Get the file stats
-         */
-        if (stat(full_filename, &fstats) < 0) {
-            sprintf(buffer, _("Can't stat %s: %s%s"),
-                    full_filename, strerror(errno), EOL);
-            host_write(buffer, strlen(buffer));
+    if (host_files_n > 1) {
+        qsort(host_files, host_files_n, sizeof(struct host_file),
+              compare_host_files);
+    }
+    host_files_valid = Q_TRUE;
+    return Q_TRUE;
+}
+
+/**
+ * Look up a file in the host directory index.
+ *
+ * @param name the filename, without any directory
+ * @return the entry, or NULL if it is not in the directory
+ */
+static struct host_file * find_host_file(const char * name) {
+    struct host_file key;
+
+    if ((index_host_files() == Q_FALSE) || (host_files_n == 0)) {
+        return NULL;
+    }
+    key.name = (char *) name;
+    return (struct host_file *) bsearch(&key, host_files, host_files_n,
+                                        sizeof(struct host_file),
+                                        compare_host_files);
+}
+
+/**
+ * Match a filename against a glob pattern, ignoring case.  '*' matches any
+ * number of characters and '?' matches one character.
+ *
+ * @param pattern the lowercase pattern
+ * @param name the filename
+ * @return true if the name matches
+ */
+static Q_BOOL glob_match(const char * pattern, const char * name) {
+    while (*pattern != 0) {
+        if (*pattern == '*') {
+            while (*pattern == '*') {
+                pattern++;
+            }
+            if (*pattern == 0) {
+                return Q_TRUE;
+            }
+            for (; *name != 0; name++) {
+                if (glob_match(pattern, name) == Q_TRUE) {
+                    return Q_TRUE;
+                }
+            }
+            return Q_FALSE;
         }
+        if (*name == 0) {
+            return Q_FALSE;
+        }
+        if ((*pattern != '?') &&
+            (*pattern != tolower((unsigned char) *name))
+        ) {
+            return Q_FALSE;
+        }
+        pattern++;
+        name++;
+    }
+    if (*name == 0) {
+        return Q_TRUE;
+    }
+    return Q_FALSE;
+}
 
-        /*
-         * Print the file information
-         */
+/* Ask which files to list */
+static void list_files_menu() {
+    do_menu(EOL "Filename or pattern to list (Enter for all): ");
+    reset_line_buffer();
+    do_line_buffer = Q_TRUE;
+}
 
-        /*
-         * Size or <dir>
-         */
-        if (S_ISDIR(fstats.st_mode)) {
-            /*
-             * Name + Directory
-             */
-            snprintf(buffer, sizeof(buffer), _(" %-30s        <dir>"),
-                     dir_entry->d_name);
+/* List files matching the pattern in the line buffer */
+static void list_files() {
+    char buffer[COMMAND_LINE_SIZE];
+    char pattern[COMMAND_LINE_SIZE - 2];
+    int i;
+
+    /*
+     * Line buffer has the pattern.  A plain word searches for names that
+     * contain it.
+     */
+    memset(pattern, 0, sizeof(pattern));
+    wcstombs(pattern, line_buffer, sizeof(pattern) - 1);
+    for (i = 0; pattern[i] != 0; i++) {
+        pattern[i] = tolower((unsigned char) pattern[i]);
+    }
+    if ((strchr(pattern, '*') != NULL) || (strchr(pattern, '?') != NULL)) {
+        snprintf(list_pattern, sizeof(list_pattern), "%s", pattern);
+    } else {
+        snprintf(list_pattern, sizeof(list_pattern), "*%s*", pattern);
+    }
+    memset(list_last, 0, sizeof(list_last));
+    list_shown = 0;
+
+    if (index_host_files() == Q_FALSE) {
+        sprintf(buffer, _("%sUnable to display files in %s%s"), EOL,
+                get_option(Q_OPTION_HOST_DIR), EOL);
+        host_write(buffer, strlen(buffer));
+        current_state = MAIN_MENU;
+        main_menu();
+        return;
+    }
+
+    sprintf(buffer, _("%sFiles in host directory:%s"), EOL, EOL);
+    host_write(buffer, strlen(buffer));
+
+    current_state = LIST_FILES_MORE;
+    list_files_page();
+}
+
+/* Show the next page of the files listing */
+static void list_files_page() {
+    struct host_file * file;
+    char buffer[COMMAND_LINE_SIZE];
+    int shown = 0;
+    int lo;
+    int hi;
+    int i;
+
+    index_host_files();
+
+    /*
+     * Pick up after the last name shown.  Searching by name rather than
+     * keeping a position means a re-index between pages does no harm.
+     */
+    lo = 0;
+    hi = host_files_n;
+    while (lo < hi) {
+        i = (lo + hi) / 2;
+        if (strcmp(host_files[i].name, list_last) <= 0) {
+            lo = i + 1;
         } else {
+            hi = i;
+        }
+    }
+
+    for (i = lo; i < host_files_n; i++) {
+        file = &host_files[i];
+        if (glob_match(list_pattern, file->name) == Q_FALSE) {
+            continue;
+        }
+        if (shown == LIST_FILES_PAGE) {
             /*
-             * Name + File size
+             * There is at least one more, stop here
              */
-            snprintf(buffer, sizeof(buffer), " %-30s %12lu",
-                     dir_entry->d_name, (unsigned long) fstats.st_size);
+            do_menu(EOL "-- More --  Enter for the next page, Q to quit: ");
+            return;
         }
 
         /*
-         * Time
+         * Name + Directory or Name + File size
          */
-        strftime(buffer + strlen(buffer), sizeof(buffer),
-                 "  %d/%b/%Y %H:%M:%S", localtime(&fstats.st_mtime));
+        if (S_ISDIR(file->fstats.st_mode)) {
+            snprintf(buffer, sizeof(buffer), _(" %-30s        <dir>"),
+                     file->name);
+        } else {
+            snprintf(buffer, sizeof(buffer), " %-30s %12lu",
+                     file->name, (unsigned long) file->fstats.st_size);
+        }
 
         /*
-         * Mask
+         * Time
          */
-        snprintf(buffer + strlen(buffer), sizeof(buffer), " %s",
-                 file_mode_string(fstats.st_mode));
+        strftime(buffer + strlen(buffer), sizeof(buffer) - strlen(buffer),
+                 "  %d/%b/%Y %H:%M:%S", localtime(&file->fstats.st_mtime));
 
         /*
-         * EOL
+         * Mask, EOL
          */
-        snprintf(buffer + strlen(buffer), sizeof(buffer), "%s", EOL);
+        snprintf(buffer + strlen(buffer), sizeof(buffer) - strlen(buffer),
+                 " %s%s", file_mode_string(file->fstats.st_mode), EOL);
 
-        /*
-         * Emit
-         */
         host_write(buffer, strlen(buffer));
 
-        /*
-         * Get next entry
-         */
-        dir_entry = readdir(directory);
-        Xfree(full_filename, __FILE__, __LINE__);
-        full_filename = NULL;
+        snprintf(list_last, sizeof(list_last), "%s", file->name);
+        list_shown++;
+        shown++;
     }
-    assert(directory != NULL);
-    closedir(directory);
-    directory = NULL;
 
-    if (total == 0) {
+    if (list_shown == 0) {
         /*
          * No files
          */
@@ -1500,6 +1941,7 @@ static void list_files() {
     /*
      * Re-display the main menu
      */
+    current_state = MAIN_MENU;
     main_menu();
 }
 
@@ -1550,6 +1992,7 @@ static void clear_filename() {
 /* Do download */
 static void download_file(Q_PROTOCOL protocol) {
     struct file_info * upload_file_info;
+    struct host_file * host_file;
     char * filename;
     int rc;
     struct stat fstats;
@@ -1561,6 +2004,14 @@ static void download_file(Q_PROTOCOL protocol) {
         main_menu();
         return;
     }
+    if ((background == Q_TRUE) && (transfer_busy == Q_TRUE)) {
+        do_menu(EOL
+            "Another caller is transferring a file, please try again later."
+            EOL);
+        current_state = MAIN_MENU;
+        main_menu();
+        return;
+    }
     assert(host_online == Q_TRUE);
 
 download_top:
@@ -1608,7 +2059,23 @@ download_top:
         strncpy(filename + strlen(filename), transfer_filename,
                 strlen(transfer_filename));
 
-        rc = stat(filename, &fstats);
+        if ((strchr(transfer_filename, '/') == NULL) &&
+            (strchr(transfer_filename, '\\') == NULL)
+        ) {
+            /*
+             * Plain filename: the directory index already has it
+             */
+            host_file = find_host_file(transfer_filename);
+            if (host_file != NULL) {
+                memcpy(&fstats, &host_file->fstats, sizeof(fstats));
+                rc = 0;
+            } else {
+                errno = ENOENT;
+                rc = -1;
+            }
+        } else {
+            rc = stat(filename, &fstats);
+        }
         if (rc < 0) {
 
             /*
@@ -1727,7 +2194,6 @@ static void download_file_kermit() {
 
 /* Do upload */
 static void upload_file(Q_PROTOCOL protocol) {
-    static char * filename = NULL;
     int length;
     int rc;
     struct stat fstats;
@@ -1744,6 +2210,14 @@ static void upload_file(Q_PROTOCOL protocol) {
         main_menu();
         return;
     }
+    if ((background == Q_TRUE) && (transfer_busy == Q_TRUE)) {
+        do_menu(EOL
+            "Another caller is transferring a file, please try again later."
+            EOL);
+        current_state = MAIN_MENU;
+        main_menu();
+        return;
+    }
     assert(host_online == Q_TRUE);
 upload_top:
     if (file_state == FILENAME) {
@@ -1786,19 +2260,19 @@ upload_top:
         snprintf(transfer_filename, length, "%ls", line_buffer);
         DLOG(("upload_file(): filename = \'%s\'\n", transfer_filename));
 
-        filename = (char *) Xmalloc(strlen(transfer_filename) +
+        upload_filename = (char *) Xmalloc(strlen(transfer_filename) +
                                     strlen(get_option(Q_OPTION_HOST_DIR)) + 2,
                                     __FILE__, __LINE__);
-        memset(filename, 0,
+        memset(upload_filename, 0,
                strlen(transfer_filename) +
                strlen(get_option(Q_OPTION_HOST_DIR)) + 2);
-        strncpy(filename, get_option(Q_OPTION_HOST_DIR),
+        strncpy(upload_filename, get_option(Q_OPTION_HOST_DIR),
                 strlen(get_option(Q_OPTION_HOST_DIR)));
-        filename[strlen(filename)] = '/';
-        strncpy(filename + strlen(filename), transfer_filename,
+        upload_filename[strlen(upload_filename)] = '/';
+        strncpy(upload_filename + strlen(upload_filename), transfer_filename,
                 strlen(transfer_filename));
 
-        rc = stat(filename, &fstats);
+        rc = stat(upload_filename, &fstats);
         if (rc < 0) {
 
             if (errno == ENOENT) {
@@ -1813,7 +2287,8 @@ upload_top:
                     /*
                      * Xmodem: full filename
                      */
-                    q_download_location = Xstrdup(filename, __FILE__, __LINE__);
+                    q_download_location = Xstrdup(upload_filename,
+                                                  __FILE__, __LINE__);
                     break;
                 case Q_PROTOCOL_YMODEM:
                 case Q_PROTOCOL_ZMODEM:
@@ -1835,6 +2310,7 @@ upload_top:
                 switch_state(Q_STATE_DOWNLOAD);
                 file_state = TRANSFER;
                 start_file_transfer();
+                upload_running = Q_TRUE;
 
                 clear_filename();
                 current_state = UPLOAD_FILE;
@@ -1842,16 +2318,16 @@ upload_top:
                 /*
                  * No leak
                  */
-                Xfree(filename, __FILE__, __LINE__);
-                filename = NULL;
+                Xfree(upload_filename, __FILE__, __LINE__);
+                upload_filename = NULL;
                 return;
             }
 
             /*
              * No leak
              */
-            Xfree(filename, __FILE__, __LINE__);
-            filename = NULL;
+            Xfree(upload_filename, __FILE__, __LINE__);
+            upload_filename = NULL;
 
             /*
              * Error stat()ing file
@@ -1879,8 +2355,8 @@ upload_top:
             /*
              * No leak
              */
-            Xfree(filename, __FILE__, __LINE__);
-            filename = NULL;
+            Xfree(upload_filename, __FILE__, __LINE__);
+            upload_filename = NULL;
             return;
         }
         do_menu(EOL "File already exists, resume? ");
@@ -1894,7 +2370,7 @@ upload_top:
 
         DLOG(("upload_file(): FILENAME_RESUME\n"));
 
-        assert(filename != NULL);
+        assert(upload_filename != NULL);
 
         if (wcslen(line_buffer) > 0) {
             if ((line_buffer[0] == 'y') || (line_buffer[0] == 'Y')) {
@@ -1911,6 +2387,7 @@ upload_top:
                 switch_state(Q_STATE_DOWNLOAD);
                 file_state = TRANSFER;
                 start_file_transfer();
+                upload_running = Q_TRUE;
 
                 clear_filename();
                 current_state = UPLOAD_FILE;
@@ -1918,8 +2395,8 @@ upload_top:
                 /*
                  * No leak
                  */
-                Xfree(filename, __FILE__, __LINE__);
-                filename = NULL;
+                Xfree(upload_filename, __FILE__, __LINE__);
+                upload_filename = NULL;
                 return;
             }
         }
@@ -1937,8 +2414,8 @@ upload_top:
         /*
          * No leak
          */
-        Xfree(filename, __FILE__, __LINE__);
-        filename = NULL;
+        Xfree(upload_filename, __FILE__, __LINE__);
+        upload_filename = NULL;
         return;
     }
 
@@ -2011,7 +2488,21 @@ static void hangup(char *msg) {
         qlog(_("Host mode local login end.\n"));
     }
 
-    reset_host();
+    reset_host();
+
+    if (background == Q_TRUE) {
+        /*
+         * host_process_callers() will release this caller's slot
+         */
+        return;
+    }
+
+    /*
+     * If someone else is still connected, show them instead
+     */
+    if (foreground_next_caller() == Q_TRUE) {
+        return;
+    }
 
 #ifndef Q_NO_SERIAL
     if (q_host_type == Q_HOST_TYPE_MODEM) {
@@ -2037,6 +2528,15 @@ static void page_sysop() {
     static time_t music_start;
     time_t now;
 
+    if ((page == Q_FALSE) && (background == Q_TRUE) &&
+        ((transfer_busy == Q_TRUE) || (sysop_busy == Q_TRUE))
+    ) {
+        do_menu(EOL " ** The sysop is busy, please try again later. **" EOL);
+        current_state = MAIN_MENU;
+        main_menu();
+        return;
+    }
+
     if (page == Q_FALSE) {
         /*
          * User requested sysop page
@@ -2128,7 +2628,6 @@ static void main_menu() {
     /*
      * Reset read messages state
      */
-    clear_all_messages();
     current_message = 0;
 }
 
@@ -2220,6 +2719,494 @@ static void state_machine_keyboard_handler(const int keystroke) {
     return;
 }
 
+/* Callers ---------------------------------------------------------------- */
+
+/**
+ * Save or restore the live caller.
+ *
+ * @param caller the caller slot.  For DETACH and FREE this is not used and
+ * may be NULL.
+ * @param op SAVE copies the live caller into the slot, RESTORE copies the
+ * slot into the live caller, DETACH forgets the live caller after it has
+ * been saved, and FREE releases the live caller's memory
+ */
+static void caller_state(struct host_caller * caller, const Q_SESSION_OP op) {
+    int i;
+
+    switch (op) {
+    case Q_SESSION_SAVE:
+    case Q_SESSION_RESTORE:
+        Q_SESSION_COPY(op, caller->child_tty_fd, q_child_tty_fd);
+        Q_SESSION_COPY(op, caller->online, q_status.online);
+        Q_SESSION_COPY(op, caller->current_state, current_state);
+        Q_SESSION_COPY(op, caller->chat_previous_state, chat_previous_state);
+        Q_SESSION_COPY(op, caller->chat_previous_line_buffer,
+                       chat_previous_line_buffer);
+        Q_SESSION_COPY(op, caller->host_online, host_online);
+        Q_SESSION_COPY(op, caller->local_login, local_login);
+        Q_SESSION_COPY(op, caller->sysop_chat, sysop_chat);
+        Q_SESSION_COPY(op, caller->page, page);
+        Q_SESSION_COPY(op, caller->msg_state, msg_state);
+        Q_SESSION_COPY(op, caller->msg_from, msg_from);
+        Q_SESSION_COPY(op, caller->msg_to, msg_to);
+        Q_SESSION_COPY(op, caller->msg_body, msg_body);
+        Q_SESSION_COPY(op, caller->msg_body_n, msg_body_n);
+        Q_SESSION_COPY(op, caller->current_message, current_message);
+        Q_SESSION_COPY(op, caller->messages_seen_serial,
+                       messages_seen_serial);
+        Q_SESSION_COPY(op, caller->file_state, file_state);
+        Q_SESSION_COPY(op, caller->transfer_filename, transfer_filename);
+        Q_SESSION_COPY(op, caller->upload_filename, upload_filename);
+        Q_SESSION_COPY(op, caller->list_pattern, list_pattern);
+        Q_SESSION_COPY(op, caller->list_last, list_last);
+        Q_SESSION_COPY(op, caller->list_shown, list_shown);
+        Q_SESSION_COPY(op, caller->login_state, login_state);
+        Q_SESSION_COPY(op, caller->login_username, login_username);
+        Q_SESSION_COPY(op, caller->login_password, login_password);
+        Q_SESSION_COPY(op, caller->line_buffer, line_buffer);
+        Q_SESSION_COPY(op, caller->line_buffer_n, line_buffer_n);
+        Q_SESSION_COPY(op, caller->saved_line_buffer, saved_line_buffer);
+        Q_SESSION_COPY(op, caller->saved_line_buffer_n, saved_line_buffer_n);
+        Q_SESSION_COPY(op, caller->do_line_buffer, do_line_buffer);
+        Q_SESSION_COPY(op, caller->utf8_state, utf8_state);
+        Q_SESSION_COPY(op, caller->utf8_char, utf8_char);
+        if (caller->net_state == NULL) {
+            caller->net_state = Xmalloc(net_session_state(NULL,
+                                            Q_SESSION_SIZE),
+                                        __FILE__, __LINE__);
+        }
+        net_session_state(caller->net_state, op);
+        break;
+    case Q_SESSION_DETACH:
+        q_child_tty_fd = -1;
+        q_status.online = Q_FALSE;
+        msg_from = NULL;
+        msg_to = NULL;
+        msg_body = NULL;
+        msg_body_n = 0;
+        current_message = 0;
+        transfer_filename = NULL;
+        upload_filename = NULL;
+        list_shown = 0;
+        page = Q_FALSE;
+        reset_host();
+        net_session_state(NULL, Q_SESSION_DETACH);
+        break;
+    case Q_SESSION_FREE:
+        clear_filename();
+        if (upload_filename != NULL) {
+            Xfree(upload_filename, __FILE__, __LINE__);
+            upload_filename = NULL;
+        }
+        if (msg_from != NULL) {
+            Xfree(msg_from, __FILE__, __LINE__);
+            msg_from = NULL;
+        }
+        if (msg_to != NULL) {
+            Xfree(msg_to, __FILE__, __LINE__);
+            msg_to = NULL;
+        }
+        for (i = 0; i < msg_body_n; i++) {
+            Xfree(msg_body[i], __FILE__, __LINE__);
+        }
+        if (msg_body != NULL) {
+            Xfree(msg_body, __FILE__, __LINE__);
+            msg_body = NULL;
+        }
+        msg_body_n = 0;
+        break;
+    case Q_SESSION_SIZE:
+        break;
+    }
+}
+
+/**
+ * Make another caller slot the live one.
+ *
+ * @param slot the slot to swap in
+ */
+static void swap_caller(const int slot) {
+    caller_state(&callers[live_caller], Q_SESSION_SAVE);
+    caller_state(&callers[slot], Q_SESSION_RESTORE);
+    live_caller = slot;
+}
+
+/**
+ * Count the callers that are logged in, including a local logon.
+ *
+ * @return the number of callers
+ */
+static int caller_count() {
+    int i;
+    int count = 0;
+
+    for (i = 0; i < HOST_MAX_CALLERS; i++) {
+        if (i == live_caller) {
+            if ((host_online == Q_TRUE) || (local_login == Q_TRUE)) {
+                count++;
+            }
+        } else if (callers[i].in_use == Q_TRUE) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Find the next slot after the live caller that has a caller in it.
+ *
+ * @return the slot, or -1 if the live caller is the only one
+ */
+static int next_caller() {
+    int i;
+    int slot;
+
+    for (i = 1; i < HOST_MAX_CALLERS; i++) {
+        slot = (live_caller + i) % HOST_MAX_CALLERS;
+        if (callers[slot].in_use == Q_TRUE) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Let the sysop know what happened to a caller that is not on the screen.
+ *
+ * @param node the caller slot
+ * @param message the event, e.g. "logged in"
+ */
+static void sysop_notify(const int node, const char * message) {
+    char buffer[DIALOG_MESSAGE_SIZE];
+
+    snprintf(buffer, sizeof(buffer), _("%s[Node %d %s]%s"), EOL, node + 1,
+             message, EOL);
+    host_echo(buffer, strlen(buffer));
+}
+
+/**
+ * Called after the live caller hung up: if another caller is connected,
+ * put them on the screen.
+ *
+ * @return true if another caller is now live
+ */
+static Q_BOOL foreground_next_caller() {
+    int slot = next_caller();
+
+    if (slot == -1) {
+        return Q_FALSE;
+    }
+
+    /*
+     * The live caller is gone, so there is nothing to save.
+     */
+    caller_state(NULL, Q_SESSION_FREE);
+    callers[live_caller].in_use = Q_FALSE;
+    caller_state(&callers[slot], Q_SESSION_RESTORE);
+    live_caller = slot;
+    sysop_notify(slot, _("is now on screen"));
+    return Q_TRUE;
+}
+
+/**
+ * Close the connection of the live caller without any of the
+ * hangup() screen messages.
+ */
+static void drop_caller() {
+    if (net_is_connected() == Q_TRUE) {
+        net_force_close();
+    }
+    if (q_child_tty_fd != -1) {
+#ifdef Q_PDCURSES_WIN32
+        closesocket(q_child_tty_fd);
+#else
+        close(q_child_tty_fd);
+#endif
+        q_child_tty_fd = -1;
+    }
+    q_status.online = Q_FALSE;
+    host_online = Q_FALSE;
+}
+
+/**
+ * Hang up on every caller except the live one.  Called when host mode
+ * stops.
+ */
+static void close_background_callers() {
+    int i;
+    int live = live_caller;
+
+    caller_state(&callers[live], Q_SESSION_SAVE);
+    for (i = 0; i < HOST_MAX_CALLERS; i++) {
+        if ((i == live) || (callers[i].in_use == Q_FALSE)) {
+            continue;
+        }
+        caller_state(&callers[i], Q_SESSION_RESTORE);
+        if (host_online == Q_TRUE) {
+            drop_caller();
+            qlog(_("Host mode node %d disconnected.\n"), i + 1);
+        }
+        caller_state(NULL, Q_SESSION_FREE);
+        callers[i].in_use = Q_FALSE;
+    }
+    caller_state(&callers[live], Q_SESSION_RESTORE);
+}
+
+/**
+ * Accept a new network caller into a free slot while the live caller is
+ * busy.  The new caller starts at the login prompt in the background.
+ */
+static void accept_caller() {
+    char notify_message[DIALOG_MESSAGE_SIZE];
+    int live = live_caller;
+    int slot;
+    int fd;
+
+    if (caller_count() >= max_callers) {
+        return;
+    }
+    for (slot = 0; slot < HOST_MAX_CALLERS; slot++) {
+        if (callers[slot].in_use == Q_FALSE) {
+            break;
+        }
+    }
+    if (slot == HOST_MAX_CALLERS) {
+        return;
+    }
+
+    /*
+     * net_accept() replaces the live connection state, so put the live
+     * caller away first.
+     */
+    caller_state(&callers[live], Q_SESSION_SAVE);
+    caller_state(NULL, Q_SESSION_DETACH);
+    fd = net_accept();
+    if (fd == -1) {
+        caller_state(&callers[live], Q_SESSION_RESTORE);
+        return;
+    }
+
+    snprintf(notify_message, sizeof(notify_message) - 1,
+        _("Incoming connection on node %d established from %s port %s\n"),
+        slot + 1, net_ip_address(), net_port());
+    qlog(notify_message);
+
+    callers[slot].in_use = Q_TRUE;
+    live_caller = slot;
+    q_child_tty_fd = fd;
+    q_status.online = Q_TRUE;
+    host_online = Q_TRUE;
+    current_state = LOGIN;
+    background = Q_TRUE;
+    do_login();
+    background = Q_FALSE;
+    caller_state(&callers[slot], Q_SESSION_SAVE);
+    caller_state(&callers[live], Q_SESSION_RESTORE);
+    live_caller = live;
+
+    sysop_notify(slot, _("connected"));
+}
+
+/**
+ * Pass bytes from the caller into the menus as keystrokes.
+ *
+ * @param input the bytes from the remote side
+ * @param input_n the number of bytes in input_n
+ */
+static void caller_input(unsigned char * input, const unsigned int input_n) {
+    unsigned int i;
+    int slot = live_caller;
+
+    for (i = 0; i < input_n; i++) {
+        if ((live_caller != slot) ||
+            ((host_online == Q_FALSE) && (local_login == Q_FALSE))
+        ) {
+            /*
+             * The caller hung up, the rest is not for anyone else
+             */
+            break;
+        }
+
+        /*
+         * Apply 8-bit translation
+         */
+        input[i] = translate_8bit_in(input[i]);
+
+        /*
+         * Capture
+         */
+        if ((q_status.capture == Q_TRUE) && (background == Q_FALSE)) {
+            if ((q_status.capture_type == Q_CAPTURE_TYPE_RAW) ||
+                (q_status.capture_type == Q_CAPTURE_TYPE_TIMED)
+            ) {
+                /*
+                 * Raw
+                 */
+                capture_raw(&input[i], 1);
+            }
+        }
+
+        state_machine_keyboard_handler(input[i]);
+    }
+}
+
+/**
+ * Add the descriptors of the callers that are not on the screen to a
+ * select() read set.  The listening socket is added too while there is
+ * room for another caller.
+ *
+ * @param readfds the set to add to
+ * @param select_fd_max the highest descriptor in the set, updated as
+ * descriptors are added
+ */
+void host_add_fds(fd_set * readfds, int * select_fd_max) {
+    int i;
+
+    if ((q_host_active == Q_FALSE) || (listen_fd == -1)) {
+        return;
+    }
+
+    if (((host_online == Q_TRUE) || (local_login == Q_TRUE)) &&
+        (caller_count() < max_callers)
+    ) {
+        FD_SET(listen_fd, readfds);
+        if (listen_fd > *select_fd_max) {
+            *select_fd_max = listen_fd;
+        }
+    }
+
+    for (i = 0; i < HOST_MAX_CALLERS; i++) {
+        if ((i == live_caller) || (callers[i].in_use == Q_FALSE) ||
+            (callers[i].child_tty_fd == -1)
+        ) {
+            continue;
+        }
+        FD_SET(callers[i].child_tty_fd, readfds);
+        if (callers[i].child_tty_fd > *select_fd_max) {
+            *select_fd_max = callers[i].child_tty_fd;
+        }
+    }
+}
+
+/**
+ * Accept new callers and process incoming data for the callers that are
+ * not on the screen.  Each caller is swapped in, given its data, and
+ * swapped out again.  A caller that starts a file transfer or pages the
+ * sysop stays swapped in and becomes the caller on the screen.
+ *
+ * @param readfds the read set returned by select()
+ * @param read_function the function that reads from the live connection
+ */
+void host_process_callers(fd_set * readfds,
+                          ssize_t (*read_function)(const int fd, void * buf,
+                                                   size_t count)) {
+
+    unsigned char buffer[Q_BUFFER_SIZE];
+    Q_PROGRAM_STATE program_state;
+    int live = live_caller;
+    int error;
+    int rc;
+    int i;
+
+    if ((q_host_active == Q_FALSE) || (listen_fd == -1)) {
+        return;
+    }
+
+    /*
+     * The telnet and ssh layers behave differently outside of host mode, so
+     * stay in host mode even while the live caller is transferring a file.
+     */
+    program_state = q_program_state;
+    transfer_busy = (program_state == Q_STATE_HOST ? Q_FALSE : Q_TRUE);
+
+    /*
+     * Like Alt-N, a page must not pull the sysop away from the caller on
+     * the screen.
+     */
+    if ((current_state == CHAT) || (current_state == PAGE_SYSOP) ||
+        (local_login == Q_TRUE)
+    ) {
+        sysop_busy = Q_TRUE;
+    } else {
+        sysop_busy = Q_FALSE;
+    }
+    q_program_state = Q_STATE_HOST;
+
+    if (FD_ISSET(listen_fd, readfds) &&
+        ((host_online == Q_TRUE) || (local_login == Q_TRUE))
+    ) {
+        accept_caller();
+    }
+
+    for (i = 0; i < HOST_MAX_CALLERS; i++) {
+        if ((i == live) || (callers[i].in_use == Q_FALSE) ||
+            (callers[i].child_tty_fd == -1)
+        ) {
+            continue;
+        }
+        if (!FD_ISSET(callers[i].child_tty_fd, readfds)
+#ifdef Q_SSH_CRYPTLIB
+            /*
+             * cryptlib may be holding data that is no longer on the socket
+             */
+            && (q_host_type != Q_HOST_TYPE_SSHD)
+#endif
+        ) {
+            continue;
+        }
+
+        swap_caller(i);
+        background = Q_TRUE;
+
+        set_errno(0);
+        rc = read_function(q_child_tty_fd, buffer, sizeof(buffer));
+        error = get_errno();
+        if (rc > 0) {
+            caller_input(buffer, rc);
+        } else if ((rc == 0) ||
+#ifdef Q_PDCURSES_WIN32
+            ((error != EAGAIN) && (error != WSAEWOULDBLOCK))
+#else
+            ((error != EAGAIN) && (error != EWOULDBLOCK))
+#endif
+        ) {
+            drop_caller();
+        }
+
+        background = Q_FALSE;
+
+        if ((host_online == Q_FALSE) && (local_login == Q_FALSE)) {
+            /*
+             * This caller is gone
+             */
+            qlog(_("Host mode node %d disconnected.\n"), i + 1);
+            caller_state(NULL, Q_SESSION_FREE);
+            callers[i].in_use = Q_FALSE;
+            caller_state(&callers[live], Q_SESSION_RESTORE);
+            live_caller = live;
+            sysop_notify(i, _("disconnected"));
+            continue;
+        }
+
+        if ((transfer_busy == Q_FALSE) &&
+            ((q_program_state != Q_STATE_HOST) || (current_state == PAGE_SYSOP))
+        ) {
+            /*
+             * This caller needs the transfer engine or the sysop, so it
+             * takes over the screen.  The previous caller was already saved
+             * by swap_caller().
+             */
+            sysop_notify(i, _("is now on screen"));
+            q_screen_dirty = Q_TRUE;
+            return;
+        }
+
+        swap_caller(live);
+    }
+
+    q_program_state = program_state;
+}
+
 #ifndef Q_NO_SERIAL
 
 /**
@@ -2610,11 +3597,18 @@ void host_process_data(unsigned char * input, const unsigned int input_n,
                        const unsigned int output_max) {
 
     char notify_message[DIALOG_MESSAGE_SIZE];
-    unsigned int i;
 
     DLOG(("host_process_data() : host_online %s\n",
             (host_online == Q_TRUE ? "true" : "false")));
 
+    if (upload_running == Q_TRUE) {
+        /*
+         * An upload just finished, its size is out of date in the index
+         */
+        upload_running = Q_FALSE;
+        host_files_valid = Q_FALSE;
+    }
+
     if ((host_online == Q_TRUE) || (local_login == Q_TRUE)) {
         /*
          * Special case: page the sysop
@@ -2655,30 +3649,7 @@ void host_process_data(unsigned char * input, const unsigned int input_n,
             /*
              * Online: pass everything in as keystrokes
              */
-            for (i = 0; i < input_n; i++) {
-                /*
-                 * Apply 8-bit translation
-                 */
-                input[i] = translate_8bit_in(input[i]);
-
-                /*
-                 * Capture
-                 */
-                if (q_status.capture == Q_TRUE) {
-                    if (q_status.capture_type == Q_CAPTURE_TYPE_RAW) {
-                        /*
-                         * Raw
-                         */
-                        fprintf(q_status.capture_file, "%c", input[i]);
-                        if (q_status.capture_flush_time < time(NULL)) {
-                            fflush(q_status.capture_file);
-                            q_status.capture_flush_time = time(NULL);
-                        }
-                    }
-                }
-
-                state_machine_keyboard_handler(input[i]);
-            }
+            caller_input(input, input_n);
         }
         *remaining = 0;
         return;
@@ -2693,6 +3664,12 @@ void host_process_data(unsigned char * input, const unsigned int input_n,
 #ifdef Q_SSH_CRYPTLIB
     case Q_HOST_TYPE_SSHD:
 #endif
+        if (local_login == Q_TRUE) {
+            /*
+             * New callers will be picked up by host_process_callers()
+             */
+            return;
+        }
         q_child_tty_fd = net_accept();
         if (q_child_tty_fd != -1) {
             /*
@@ -2824,6 +3801,19 @@ void host_keyboard_handler(const int keystroke, const int flags) {
             return;
         }
 
+        if ((tolower(keystroke) == 'n') && ((flags & KEY_FLAG_ALT) != 0)) {
+            /*
+             * Next caller.  Chat and page need the sysop on this caller.
+             */
+            if ((current_state != CHAT) && (current_state != PAGE_SYSOP) &&
+                (next_caller() != -1)
+            ) {
+                swap_caller(next_caller());
+                sysop_notify(live_caller, _("is now on screen"));
+            }
+            return;
+        }
+
         state_machine_keyboard_handler(keystroke);
         return;
     }
@@ -2876,6 +3866,7 @@ void host_keyboard_handler(const int keystroke, const int flags) {
  */
 void host_refresh() {
     char * status_string;
+    char node_string[DIALOG_MESSAGE_SIZE];
     int status_left_stop;
 
     if (q_screen_dirty == Q_FALSE) {
@@ -2904,6 +3895,14 @@ void host_refresh() {
     } else {
         status_string = _(" Host Mode   L-Local Logon   ESC/`-Exit Host ");
     }
+    if ((caller_count() > 1) && (current_state != PAGE_SYSOP) &&
+        (current_state != CHAT)
+    ) {
+        snprintf(node_string, sizeof(node_string),
+            _(" Node %d (%d Callers)   Alt-N-Next   Alt-C-Chat   Alt-H-Hangup "),
+            live_caller + 1, caller_count());
+        status_string = node_string;
+    }
 
     screen_put_color_hline_yx(HEIGHT - 1, 0, cp437_chars[HATCH], WIDTH,
                               Q_COLOR_STATUS);
@@ -20,6 +20,10 @@
 
 /* Includes --------------------------------------------------------------- */
 
+#ifndef Q_PDCURSES_WIN32
+#include <sys/select.h>         /* fd_set */
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -118,6 +122,31 @@ extern void host_process_data(unsigned char * input, const unsigned int input_n,
                               unsigned int * output_n,
                               const unsigned int output_max);
 
+/**
+ * Add the descriptors of the callers that are not on the screen to a
+ * select() read set.  The listening socket is added too while there is
+ * room for another caller.
+ *
+ * @param readfds the set to add to
+ * @param select_fd_max the highest descriptor in the set, updated as
+ * descriptors are added
+ */
+extern void host_add_fds(fd_set * readfds, int * select_fd_max);
+
+/**
+ * Accept new callers and process incoming data for the callers that are
+ * not on the screen.  Each caller is swapped in, given its data, and
+ * swapped out again.  A caller that starts a file transfer or pages the
+ * sysop stays swapped in and becomes the caller on the screen.
+ *
+ * @param readfds the read set returned by select()
+ * @param read_function the function that reads from the live connection
+ */
+extern void host_process_callers(fd_set * readfds,
+                                 ssize_t (*read_function)(const int fd,
+                                                          void * buf,
+                                                          size_t count));
+
 #ifdef __cplusplus
 }
 #endif
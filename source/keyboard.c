@@ -320,7 +320,7 @@ static struct function_key_textbox * editing_textbox = NULL;
  * Note that ANSI emulation is an 8-bit emulation: only the bottom 8 bits are
  * transmitted to the remote side.  See post_keystroke().
  */
-static wchar_t * tty_keystroke(const int keystroke) {
+wchar_t * tty_keystroke(const int keystroke) {
 
     switch (keystroke) {
 
@@ -1277,38 +1277,7 @@ void post_keystroke(const int keystroke, const int flags) {
         /*
          * Send "special" keys through the proper emulator keyboard function
          */
-        switch (q_status.emulation) {
-        case Q_EMUL_TTY:
-        case Q_EMUL_DEBUG:
-            term_string = tty_keystroke(keystroke);
-            break;
-        case Q_EMUL_ANSI:
-        case Q_EMUL_AVATAR:
-            term_string = ansi_keystroke(keystroke);
-            break;
-        case Q_EMUL_PETSCII:
-            term_string = petscii_keystroke(keystroke);
-            break;
-        case Q_EMUL_ATASCII:
-            term_string = atascii_keystroke(keystroke);
-            break;
-        case Q_EMUL_VT52:
-            term_string = vt52_keystroke(keystroke);
-            break;
-        case Q_EMUL_VT100:
-        case Q_EMUL_VT102:
-        case Q_EMUL_VT220:
-            term_string = vt100_keystroke(keystroke);
-            break;
-        case Q_EMUL_LINUX:
-        case Q_EMUL_LINUX_UTF8:
-            term_string = linux_keystroke(keystroke);
-            break;
-        case Q_EMUL_XTERM:
-        case Q_EMUL_XTERM_UTF8:
-            term_string = xterm_keystroke(keystroke, flags);
-            break;
-        }
+        term_string = emulation_keystroke(keystroke, flags);
     }
 
     if (term_string == NULL) {
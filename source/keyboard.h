@@ -67,6 +67,16 @@ extern void function_key_editor_refresh();
  */
 extern void switch_current_keyboard(const char * filename);
 
+/**
+ * Generate a sequence of bytes to send to the remote side that correspond to
+ * a keystroke for the TTY emulation.
+ *
+ * @param keystroke one of the Q_KEY values, OR a Unicode code point.  See
+ * input.h.
+ * @return a wide string that is appropriate to send to the remote side.
+ */
+extern wchar_t * tty_keystroke(const int keystroke);
+
 /**
  * Create the config files for the keybindings (default.key, ansi.key,
  * vt100.key, etc.)
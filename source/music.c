@@ -71,6 +71,12 @@ static const char * DLOGNAME = NULL;
  */
 static float frequency_table[7][12];
 
+/**
+ * When the user last banned music with backtick or ESC.  No music plays
+ * for five seconds after that.
+ */
+static time_t ban_time = 0;
+
 #ifdef Q_SOUND_SDL
 
 /**
@@ -84,17 +90,48 @@ static Q_BOOL sdl_ok = Q_FALSE;
 static int output_frequency = 11025 * 2;
 
 /**
- * Begin sine wave at x = 0.
+ * The number of samples the callback fills at a time, about 93 millis.
+ * This is how long a newly-queued tune can wait to start.
+ */
+#define SDL_BUFFER_SAMPLES      2048
+
+/**
+ * The output level of silence.
+ */
+#define SDL_SILENCE             128
+
+/**
+ * One period of the sine wave, indexed by the top SDL_SINE_TABLE_BITS bits
+ * of the phase.
  */
-static int sdl_sine_wave_x = 0;
+#define SDL_SINE_TABLE_BITS     10
+static Uint8 sdl_sine_table[1 << SDL_SINE_TABLE_BITS];
 
 /**
- * Frequency of the currently-playing note.
+ * A tone waiting to be played by sdl_callback().
  */
-static double sdl_Hz = 0;
+struct sdl_note {
+    Uint32 phase_step;          /* Phase added per sample, 0 for a rest */
+    long samples;               /* Samples left to play */
+};
 
 /**
- * Compute a discrete sine wave to send to the speakers.
+ * The queue of tones shared with sdl_callback().  Only touched with the
+ * audio locked.
+ */
+#define SDL_NOTE_QUEUE_SIZE     256
+static struct sdl_note sdl_notes[SDL_NOTE_QUEUE_SIZE];
+static int sdl_notes_start = 0;
+static int sdl_notes_n = 0;
+
+/**
+ * Phase of the wave in the currently-playing note.  The full 32 bits are
+ * one period.
+ */
+static Uint32 sdl_phase = 0;
+
+/**
+ * Play the queued tones.  Once the queue runs dry this sends silence.
  *
  * @param userdata SDL optional user data, ignored
  * @param output the audio output buffer
@@ -102,16 +139,82 @@ static double sdl_Hz = 0;
  * speakers
  */
 static void sdl_callback(void * userdata, Uint8 * output, int output_max) {
-    double pi = 3.1415926535;           /* Obviously pi */
-    double A = 20;                      /* Amplitude */
-    double SR = output_frequency;       /* Frequency at the speakers */
-    double F = 2 * pi * sdl_Hz / SR;    /* Ultimate output frequency */
-    int i;
+    struct sdl_note * note;
+    Uint32 phase = sdl_phase;
+    Uint32 phase_step;
+    int i = 0;
+    int n;
+
+    while ((i < output_max) && (sdl_notes_n > 0)) {
+        note = &sdl_notes[sdl_notes_start];
+        n = output_max - i;
+        if (note->samples < n) {
+            n = (int) note->samples;
+        }
+        note->samples -= n;
+
+        phase_step = note->phase_step;
+        if (phase_step == 0) {
+            memset(output + i, SDL_SILENCE, n);
+            i += n;
+        } else {
+            for (; n > 0; n--) {
+                output[i++] =
+                    sdl_sine_table[phase >> (32 - SDL_SINE_TABLE_BITS)];
+                phase += phase_step;
+            }
+        }
+
+        if (note->samples == 0) {
+            /*
+             * On to the next note, which starts its wave at x = 0.
+             */
+            sdl_notes_start = (sdl_notes_start + 1) % SDL_NOTE_QUEUE_SIZE;
+            sdl_notes_n--;
+            phase = 0;
+        }
+    }
+    sdl_phase = phase;
+
+    if (i < output_max) {
+        memset(output + i, SDL_SILENCE, output_max - i);
+    }
+}
+
+/**
+ * Add a list of tones to the queue played by sdl_callback().  Tones that
+ * do not fit in the queue are dropped.
+ *
+ * @param music the tones to play
+ */
+static void sdl_queue_music(const struct q_music_struct * music) {
+    struct sdl_note * note;
+    int hertz;
 
-    for (i = 0; i < output_max; i++) {
-        output[i] = (Uint8) (A * sin(F * sdl_sine_wave_x) + 128) & 0xFF;
-        sdl_sine_wave_x++;
+    SDL_LockAudio();
+    for (; music != NULL; music = music->next) {
+        if (sdl_notes_n == SDL_NOTE_QUEUE_SIZE) {
+            break;
+        }
+        DLOG(("sdl_queue_music(): hertz = %d hz duration = %d millis\n",
+              music->hertz, music->duration));
+
+        assert(music->duration >= 0);
+        hertz = music->hertz;
+        if ((hertz < 0) || (hertz >= output_frequency / 2)) {
+            hertz = 0;
+        }
+        note = &sdl_notes[(sdl_notes_start + sdl_notes_n) %
+                          SDL_NOTE_QUEUE_SIZE];
+        note->phase_step = (Uint32) (4294967296.0 * hertz / output_frequency);
+        note->samples = (long) music->duration * output_frequency / 1000;
+        if (note->samples > 0) {
+            sdl_notes_n++;
+        }
     }
+    SDL_UnlockAudio();
+
+    SDL_PauseAudio(0);
 }
 
 #endif /* Q_SOUND_SDL */
@@ -164,6 +267,14 @@ void music_init() {
     /*
      * Initialize the SDL system.
      */
+    for (i = 0; i < (1 << SDL_SINE_TABLE_BITS); i++) {
+        /*
+         * Amplitude 20 around the silence level.
+         */
+        sdl_sine_table[i] = (Uint8) (20 * sin(2 * 3.1415926535 * i /
+                (1 << SDL_SINE_TABLE_BITS)) + SDL_SILENCE) & 0xFF;
+    }
+
     if (SDL_Init(SDL_INIT_AUDIO) == 0) {
         SDL_AudioSpec spec;
         sdl_ok = Q_TRUE;
@@ -171,7 +282,7 @@ void music_init() {
         spec.format = AUDIO_U8;
         spec.channels = 1;
         spec.silence = 0;
-        spec.samples = 4 * output_frequency;
+        spec.samples = SDL_BUFFER_SAMPLES;
         spec.padding = 0;
         spec.size = 0;
         spec.userdata = 0;
@@ -197,6 +308,14 @@ void music_teardown() {
     DLOG(("music_teardown()\n"));
 
 #ifdef Q_SOUND_SDL
+    if (sdl_ok == Q_TRUE) {
+        /*
+         * Don't hold up the exit for whatever is still queued.
+         */
+        SDL_LockAudio();
+        sdl_notes_n = 0;
+        SDL_UnlockAudio();
+    }
     SDL_PauseAudio(1);
 
     if (sdl_ok == Q_TRUE) {
@@ -208,11 +327,83 @@ void music_teardown() {
 }
 
 /**
- * Play a list of tones.
+ * Wait until the tones queued by play_music() have finished playing.
+ */
+void music_wait() {
+#ifdef Q_SOUND_SDL
+    Q_BOOL waited = Q_FALSE;
+    int notes_n;
+
+    if (sdl_ok == Q_FALSE) {
+        return;
+    }
+
+    for (;;) {
+        SDL_LockAudio();
+        notes_n = sdl_notes_n;
+        SDL_UnlockAudio();
+        if (notes_n == 0) {
+            break;
+        }
+        waited = Q_TRUE;
+        SDL_Delay(10);
+    }
+
+    if (waited == Q_TRUE) {
+        /*
+         * The last tones are still in SDL's buffer, let them out.
+         */
+        SDL_Delay(1000 * SDL_BUFFER_SAMPLES / output_frequency);
+    }
+#endif
+}
+
+/**
+ * See if tones queued by play_music() are still playing.
+ *
+ * @return true if music is playing in the background
+ */
+Q_BOOL music_playing() {
+#ifdef Q_SOUND_SDL
+    int notes_n;
+
+    if (sdl_ok == Q_TRUE) {
+        SDL_LockAudio();
+        notes_n = sdl_notes_n;
+        SDL_UnlockAudio();
+        if (notes_n > 0) {
+            return Q_TRUE;
+        }
+    }
+#endif
+    return Q_FALSE;
+}
+
+/**
+ * Stop the tones queued by play_music() and ban all music for five
+ * seconds, as backtick or ESC does while a tune plays in the foreground.
+ */
+void music_stop() {
+    DLOG(("music_stop()\n"));
+
+#ifdef Q_SOUND_SDL
+    if (sdl_ok == Q_TRUE) {
+        SDL_LockAudio();
+        sdl_notes_n = 0;
+        SDL_UnlockAudio();
+    }
+#endif
+    time(&ban_time);
+}
+
+/**
+ * Play a list of tones.  With SDL the tones are queued and this returns
+ * immediately; otherwise it returns when the tones are done.
  *
  * @param music the tones to play
  * @param interruptible if true, the user can press a key to stop the
- * sequence
+ * sequence.  When the tones are queued to SDL, music_stop() does this
+ * instead.
  */
 void play_music(const struct q_music_struct * music,
                 const Q_BOOL interruptible) {
@@ -222,7 +413,6 @@ void play_music(const struct q_music_struct * music,
     static Q_BOOL on_linux = Q_FALSE;
 #endif
 
-    static time_t ban_time = 0;
     time_t now;
 
     if (q_status.sound == Q_FALSE) {
@@ -237,24 +427,20 @@ void play_music(const struct q_music_struct * music,
         return;
     }
 
-    while (music != NULL) {
-        DLOG(("play_music(): hertz = %d hz duration = %d millis\n",
-              music->hertz, music->duration));
-
 #ifdef Q_SOUND_SDL
-
-        sdl_Hz = music->hertz;
-        sdl_sine_wave_x = 0;
-
+    if (sdl_ok == Q_TRUE) {
         /*
-         * Begin sound
+         * The callback plays the tones while we get back to work.
          */
-        if (sdl_ok == Q_TRUE) {
-            SDL_PauseAudio(0);
-        }
-
+        sdl_queue_music(music);
+        return;
+    }
 #endif
 
+    while (music != NULL) {
+        DLOG(("play_music(): hertz = %d hz duration = %d millis\n",
+              music->hertz, music->duration));
+
 #ifdef Q_PDCURSES_WIN32
 
         /*
@@ -347,14 +533,6 @@ void play_music(const struct q_music_struct * music,
      */
     timeout(0);
 
-#ifdef Q_SOUND_SDL
-    /*
-     * Cease sound
-     */
-    if (sdl_ok == Q_TRUE)
-        SDL_PauseAudio(1);
-#endif
-
 #ifndef Q_PDCURSES_WIN32
 #ifdef Q_SOUND_SDL
     if ((on_linux == Q_TRUE) && (sdl_ok == Q_FALSE)) {
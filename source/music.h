@@ -83,11 +83,31 @@ extern void play_ansi_music(const unsigned char * buffer, const int buffer_n,
 extern void play_sequence(const Q_MUSIC_SEQUENCE sequence);
 
 /**
- * Play a list of tones.
+ * Wait until the tones queued by play_music() have finished playing.
+ */
+extern void music_wait();
+
+/**
+ * See if tones queued by play_music() are still playing.
+ *
+ * @return true if music is playing in the background
+ */
+extern Q_BOOL music_playing();
+
+/**
+ * Stop the tones queued by play_music() and ban all music for five
+ * seconds, as backtick or ESC does while a tune plays in the foreground.
+ */
+extern void music_stop();
+
+/**
+ * Play a list of tones.  With SDL the tones are queued and this returns
+ * immediately; otherwise it returns when the tones are done.
  *
  * @param music the tones to play
  * @param interruptible if true, the user can press a key to stop the
- * sequence
+ * sequence.  When the tones are queued to SDL, music_stop() does this
+ * instead.
  */
 extern void play_music(const struct q_music_struct * music,
                        const Q_BOOL interruptible);
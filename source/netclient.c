@@ -132,6 +132,7 @@
 #include "console.h"
 #include "forms.h"
 #include "states.h"
+#include "session.h"
 
 #ifdef Q_UPNP
 #if defined(HAVE_MINIUPNPC_MINIUPNPC_H) && defined(Q_USE_SYSTEM_UPNP)
@@ -5080,3 +5081,87 @@ crypt_error:
 }
 
 #endif /* Q_SSH_CRYPTLIB */
+
+/* Sessions ----------------------------------------------------------------- */
+
+/**
+ * The client connection state that is saved with a session.  The listening
+ * socket belongs to host mode and is not part of a session.
+ */
+struct net_session {
+    STATE state;
+    Q_BOOL connected;
+    Q_BOOL pending;
+    char remote_host[NI_MAXHOST];
+    char remote_port[NI_MAXSERV];
+    const char * connect_host;
+    const char * connect_port;
+    unsigned char read_buffer[Q_BUFFER_SIZE];
+    int read_buffer_n;
+    unsigned char write_buffer[Q_BUFFER_SIZE];
+    unsigned int write_buffer_n;
+    unsigned char subneg_buffer[SUBNEG_BUFFER_MAX];
+    int subneg_buffer_n;
+    struct telnet_state nvt;
+#ifdef Q_SSH_CRYPTLIB
+    CRYPT_SESSION cryptSession;
+    Q_BOOL maybe_readable;
+#endif
+};
+
+/**
+ * Save or restore the network connection state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t net_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct net_session * saved = (struct net_session *) buffer;
+
+    switch (op) {
+    case Q_SESSION_SAVE:
+    case Q_SESSION_RESTORE:
+        Q_SESSION_COPY(op, saved->state, state);
+        Q_SESSION_COPY(op, saved->connected, connected);
+        Q_SESSION_COPY(op, saved->pending, pending);
+        Q_SESSION_COPY(op, saved->remote_host, remote_host);
+        Q_SESSION_COPY(op, saved->remote_port, remote_port);
+        Q_SESSION_COPY(op, saved->connect_host, connect_host);
+        Q_SESSION_COPY(op, saved->connect_port, connect_port);
+        Q_SESSION_COPY(op, saved->read_buffer, read_buffer);
+        Q_SESSION_COPY(op, saved->read_buffer_n, read_buffer_n);
+        Q_SESSION_COPY(op, saved->write_buffer, write_buffer);
+        Q_SESSION_COPY(op, saved->write_buffer_n, write_buffer_n);
+        Q_SESSION_COPY(op, saved->subneg_buffer, subneg_buffer);
+        Q_SESSION_COPY(op, saved->subneg_buffer_n, subneg_buffer_n);
+        Q_SESSION_COPY(op, saved->nvt, nvt);
+#ifdef Q_SSH_CRYPTLIB
+        Q_SESSION_COPY(op, saved->cryptSession, cryptSession);
+        Q_SESSION_COPY(op, saved->maybe_readable, maybe_readable);
+#endif
+        break;
+    case Q_SESSION_DETACH:
+    case Q_SESSION_FREE:
+        /*
+         * The socket itself is closed through close_connection(), so all
+         * that is left is to forget about it.
+         */
+        state = INIT;
+        connected = Q_FALSE;
+        pending = Q_FALSE;
+        connect_host = NULL;
+        connect_port = NULL;
+        read_buffer_n = 0;
+        write_buffer_n = 0;
+        subneg_buffer_n = 0;
+        memset(&nvt, 0, sizeof(nvt));
+#ifdef Q_SSH_CRYPTLIB
+        maybe_readable = Q_FALSE;
+#endif
+        break;
+    case Q_SESSION_SIZE:
+        break;
+    }
+    return sizeof(struct net_session);
+}
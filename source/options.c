@@ -80,6 +80,11 @@ static struct option_struct options[] = {
 "### The password to require for host mode logins.  Maximum length is 64\n"
 "### bytes."},
 
+        {Q_OPTION_HOST_MAX_CALLERS, NULL, "host_max_callers", "4", ""
+"### The number of callers that may be connected to a socket, telnetd, or\n"
+"### sshd host at the same time.  Modem and serial port hosts always take\n"
+"### one caller.  Maximum value is 16."},
+
 /* Directories */
 
 #ifdef Q_PDCURSES_WIN32
@@ -267,6 +272,12 @@ static struct option_struct options[] = {
 "### emulations will only use bracketed paste mode if this value is\n"
 "### 'true'."},
 
+        {Q_OPTION_SCREEN_FRAME_RATE, NULL, "screen_frame_rate", "30", ""
+"### The most times per second to redraw the terminal screen while data is\n"
+"### arriving.  Data is still read and emulated at full speed in between\n"
+"### frames; only the drawing is skipped.  Script and host modes draw at\n"
+"### most 8 times per second.  Maximum value is 1000."},
+
 /* Capture file */
 
         {Q_OPTION_CAPTURE, NULL, "capture_enabled", "false", ""
@@ -281,8 +292,11 @@ static struct option_struct options[] = {
 "### is stored in the working directory if a relative path is specified."},
 
         {Q_OPTION_CAPTURE_TYPE, NULL, "capture_type", "normal", ""
-"### The default capture format.  Value is 'normal', 'raw', 'html', or\n"
-"### 'ask'."},
+"### The default capture format.  Value is 'normal', 'raw', 'html',\n"
+"### 'timed', or 'ask'.\n"
+"###\n"
+"### 'timed' records the raw bytes received with their arrival times in\n"
+"### compressed blocks.  It can be played back with 'qodem --replay'."},
 
 /* Screen dump */
 
@@ -2151,6 +2165,9 @@ void reset_capture_type() {
     if (strcasecmp(get_option(Q_OPTION_CAPTURE_TYPE), "html") == 0) {
         q_status.capture_type = Q_CAPTURE_TYPE_HTML;
     }
+    if (strcasecmp(get_option(Q_OPTION_CAPTURE_TYPE), "timed") == 0) {
+        q_status.capture_type = Q_CAPTURE_TYPE_TIMED;
+    }
     if (strcasecmp(get_option(Q_OPTION_CAPTURE_TYPE), "ask") == 0) {
         q_status.capture_type = Q_CAPTURE_TYPE_ASK;
     }
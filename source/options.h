@@ -42,6 +42,7 @@ typedef enum Q_OPTIONS {
 
     Q_OPTION_HOST_USERNAME,
     Q_OPTION_HOST_PASSWORD,
+    Q_OPTION_HOST_MAX_CALLERS,
     Q_OPTION_WORKING_DIR,
     Q_OPTION_HOST_DIR,
     Q_OPTION_DOWNLOAD_DIR,
@@ -65,6 +66,7 @@ typedef enum Q_OPTIONS {
     Q_OPTION_EXIT_ON_DISCONNECT,
     Q_OPTION_IDLE_TIMEOUT,
     Q_OPTION_BRACKETED_PASTE,
+    Q_OPTION_SCREEN_FRAME_RATE,
     Q_OPTION_CAPTURE,
     Q_OPTION_CAPTURE_FILE,
     Q_OPTION_CAPTURE_TYPE,
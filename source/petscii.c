@@ -25,6 +25,7 @@
 #include "scrollback.h"
 #include "options.h"
 #include "ansi.h"
+#include "session.h"
 #include "petscii.h"
 
 /* Set this to a not-NULL value to enable debug log. */
@@ -341,6 +342,37 @@ void petscii_reset() {
     state.reverse = Q_FALSE;
 }
 
+/**
+ * The PETSCII emulator state that is saved with a session.
+ */
+struct petscii_session {
+    SCAN_STATE scan_state;
+    struct commodore_state state;
+    unsigned char ansi_buffer[sizeof(q_emul_buffer)];
+    int ansi_buffer_n;
+    int ansi_buffer_i;
+};
+
+/**
+ * Save or restore the PETSCII emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t petscii_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct petscii_session * saved = (struct petscii_session *) buffer;
+
+    if ((op == Q_SESSION_SAVE) || (op == Q_SESSION_RESTORE)) {
+        Q_SESSION_COPY(op, saved->scan_state, scan_state);
+        Q_SESSION_COPY(op, saved->state, state);
+        Q_SESSION_COPY(op, saved->ansi_buffer, ansi_buffer);
+        Q_SESSION_COPY(op, saved->ansi_buffer_n, ansi_buffer_n);
+        Q_SESSION_COPY(op, saved->ansi_buffer_i, ansi_buffer_i);
+    }
+    return sizeof(struct petscii_session);
+}
+
 /**
  * Reset the scan state for a new sequence.
  *
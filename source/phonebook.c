@@ -21,6 +21,7 @@
 #include <ctype.h>
 #ifdef Q_PDCURSES_WIN32
 #  include <stdio.h>
+#  include <windows.h>          /* MoveFileExA() */
 #else
 #  include <wctype.h>
 #  include <unistd.h>
@@ -65,6 +66,12 @@ static const char * DLOGNAME = NULL;
 
 #define VIEW_MODE_MAX 5
 
+/**
+ * The number of records the journal can hold before the next one rewrites
+ * the whole phonebook instead.
+ */
+#define PHONEBOOK_JOURNAL_MAX 64
+
 typedef enum {
     DIAL_MODEM_INIT,
     DIAL_MODEM_SENT_AT,
@@ -124,6 +131,25 @@ typedef enum {
     SORT_METHOD_MAX
 } SORT_METHOD;
 
+/**
+ * The sort order last picked by the user, which new and revised entries
+ * are kept in.  This is saved in the phonebook file.  SORT_METHOD_MAX
+ * means the entries are in the user's own order.
+ */
+static SORT_METHOD phonebook_sort_method = SORT_METHOD_MAX;
+
+/**
+ * The names of the sort orders in the phonebook file, indexed by
+ * SORT_METHOD.
+ */
+static const char * sort_method_names[] = {
+    "name",
+    "address",
+    "total_calls",
+    "method",
+    "last_call"
+};
+
 /* If the phonebook is printed to this "file", run it through cat instead */
 #define LPR_FILE_NAME "|lpr"
 
@@ -167,6 +193,106 @@ static void close_dial_entry() {
     }
 }
 
+/**
+ * The phonebook entries in order, so that paging can jump straight to any
+ * entry.  Rebuilt on first use after the list changes.
+ */
+static struct q_phone_struct ** phonebook_index = NULL;
+
+/**
+ * The number of entries in phonebook_index, or -1 if it must be rebuilt.
+ */
+static int phonebook_index_n = -1;
+
+/**
+ * When true, the phonebook has changes that only a full save can record.
+ * Dial statistics and tag state go to the journal instead, see
+ * save_phonebook_entry().
+ */
+static Q_BOOL phonebook_dirty = Q_FALSE;
+
+/**
+ * The number of records in the journal file.
+ */
+static int phonebook_journal_n = 0;
+
+/**
+ * Note that entries were added, removed, or reordered, so that
+ * phonebook_index is rebuilt the next time it is needed.
+ */
+static void phonebook_list_changed() {
+    phonebook_index_n = -1;
+    phonebook_dirty = Q_TRUE;
+}
+
+/**
+ * Rebuild phonebook_index from the list if it is out of date.  This also
+ * renumbers the entries and brings q_phonebook.entry_count up to date.
+ */
+static void build_phonebook_index() {
+    struct q_phone_struct * entry;
+    int n;
+
+    if (phonebook_index_n != -1) {
+        return;
+    }
+
+    n = 0;
+    for (entry = q_phonebook.entries; entry != NULL; entry = entry->next) {
+        n++;
+    }
+    phonebook_index =
+        (struct q_phone_struct **) Xrealloc(phonebook_index,
+            sizeof(struct q_phone_struct *) * (n + 1), __FILE__, __LINE__);
+    n = 0;
+    for (entry = q_phonebook.entries; entry != NULL; entry = entry->next) {
+        entry->position = n;
+        phonebook_index[n] = entry;
+        n++;
+    }
+    phonebook_index[n] = NULL;
+    phonebook_index_n = n;
+    q_phonebook.entry_count = n;
+}
+
+/**
+ * Get a phonebook entry by its position in the list.
+ *
+ * @param i the position, starting at 0
+ * @return the entry, or NULL if i is past either end of the phonebook
+ */
+struct q_phone_struct * phonebook_entry_at(const int i) {
+    build_phonebook_index();
+    if ((i < 0) || (i >= phonebook_index_n)) {
+        return NULL;
+    }
+    return phonebook_index[i];
+}
+
+/**
+ * Select the entry at a position and make it visible.
+ *
+ * @param i the position, clamped to the size of the phonebook
+ */
+static void phonebook_select(int i) {
+    int visible_entries_n = HEIGHT - 1 - 14;
+
+    build_phonebook_index();
+    if (phonebook_index_n == 0) {
+        phonebook_reset();
+        return;
+    }
+    if (i >= phonebook_index_n) {
+        i = phonebook_index_n - 1;
+    }
+    if (i < 0) {
+        i = 0;
+    }
+    q_phonebook.selected_entry = phonebook_index[i];
+    phonebook_entry_i = i;
+    phonebook_page = i / visible_entries_n;
+}
+
 /**
  * Reset the phonebook selection display.  This is called when the screen is
  * resized.
@@ -182,9 +308,6 @@ void phonebook_reset() {
  * is visible in the phonebook display screen.
  */
 void phonebook_normalize() {
-    int visible_entries_n = HEIGHT - 1 - 14;
-    struct q_phone_struct *p;
-
     phonebook_entry_i = 0;
     phonebook_page = 0;
 
@@ -192,17 +315,8 @@ void phonebook_normalize() {
         return;
     }
 
-    p = q_phonebook.entries;
-    while (p != NULL) {
-        if (p == q_phonebook.selected_entry) {
-            return;
-        }
-        phonebook_entry_i++;
-        if (phonebook_entry_i % visible_entries_n == 0) {
-            phonebook_page++;
-        }
-        p = p->next;
-    }
+    build_phonebook_index();
+    phonebook_select(q_phonebook.selected_entry->position);
 }
 
 /**
@@ -868,19 +982,313 @@ static char * toggles_to_string(int toggles) {
 }
 
 /**
- * Load the phonebook from file.
+ * Discard the search text of an entry, so that the next search rebuilds
+ * it.  Called whenever the name, address, script, or notes change.
+ *
+ * @param entry the phonebook entry
+ */
+static void clear_search_text(struct q_phone_struct * entry) {
+    if (entry->search_text != NULL) {
+        Xfree(entry->search_text, __FILE__, __LINE__);
+        entry->search_text = NULL;
+    }
+}
+
+/**
+ * Read an entire file into memory.
+ *
+ * @param file the file to read, opened for reading
+ * @param data_n the number of bytes read
+ * @return a newly-allocated buffer with data_n bytes followed by a null
+ * terminator, or NULL on a read error
+ */
+static char * read_phonebook_file(FILE * file, size_t * data_n) {
+    struct stat fstats;
+    size_t data_max = 4096;
+    size_t n;
+    char * data;
+
+    if ((fstat(fileno(file), &fstats) == 0) && (fstats.st_size > 0)) {
+        data_max = (size_t) fstats.st_size + 1;
+    }
+    data = (char *) Xmalloc(data_max, __FILE__, __LINE__);
+    *data_n = 0;
+    for (;;) {
+        if (*data_n + 1 == data_max) {
+            data_max *= 2;
+            data = (char *) Xrealloc(data, data_max, __FILE__, __LINE__);
+        }
+        n = fread(data + *data_n, 1, data_max - *data_n - 1, file);
+        if (n == 0) {
+            break;
+        }
+        *data_n += n;
+    }
+    if (ferror(file)) {
+        Xfree(data, __FILE__, __LINE__);
+        return NULL;
+    }
+    data[*data_n] = 0;
+    return data;
+}
+
+/**
+ * Split the next line out of the buffer returned by read_phonebook_file().
+ * The line is null-terminated in place and has its trailing whitespace
+ * removed.
+ *
+ * @param position the current position in the buffer, advanced past the
+ * line
+ * @param end the end of the buffer
+ * @return the line, or NULL if there are no more lines
+ */
+static char * next_phonebook_line(char ** position, char * end) {
+    char * line = *position;
+    char * line_end;
+
+    if (line >= end) {
+        return NULL;
+    }
+    line_end = memchr(line, '\n', end - line);
+    if (line_end == NULL) {
+        line_end = end;
+        *position = end;
+    } else {
+        *position = line_end + 1;
+    }
+    while ((line_end > line) && q_isspace(line_end[-1])) {
+        line_end--;
+    }
+    *line_end = 0;
+    return line;
+}
+
+/**
+ * Convert a phonebook value to a newly-allocated wide string.  Most values
+ * are plain ASCII, which is widened directly rather than going through the
+ * locale.
+ *
+ * @param value the multibyte string
+ * @return the wide string
+ */
+static wchar_t * phonebook_wcsdup(const char * value) {
+    const unsigned char * ch;
+    const char * end;
+    wchar_t * result;
+    mbstate_t mb_state;
+    size_t mb_n;
+    size_t n;
+    size_t i;
+
+    for (ch = (const unsigned char *) value; *ch != 0; ch++) {
+        if (*ch >= 0x80) {
+            break;
+        }
+    }
+    if (*ch == 0) {
+        n = ch - (const unsigned char *) value;
+        result = (wchar_t *) Xmalloc(sizeof(wchar_t) * (n + 1),
+                                     __FILE__, __LINE__);
+        for (ch = (const unsigned char *) value; *ch != 0; ch++) {
+            result[ch - (const unsigned char *) value] = *ch;
+        }
+        result[n] = 0;
+        return result;
+    }
+
+    /*
+     * Convert one character at a time.  A byte that is invalid for this
+     * locale (e.g. a Latin-1 phonebook under a UTF-8 locale) comes through
+     * as its own value rather than ending the string.
+     */
+    n = strlen(value);
+    end = value + n;
+    result = (wchar_t *) Xmalloc(sizeof(wchar_t) * (n + 1), __FILE__,
+                                 __LINE__);
+    memset(&mb_state, 0, sizeof(mb_state));
+    i = 0;
+    while (value < end) {
+        mb_n = mbrtowc(&result[i], value, end - value, &mb_state);
+        if ((mb_n == (size_t) -1) || (mb_n == (size_t) -2) || (mb_n == 0)) {
+            result[i] = (unsigned char) *value;
+            memset(&mb_state, 0, sizeof(mb_state));
+            mb_n = 1;
+        }
+        value += mb_n;
+        i++;
+    }
+    result[i] = 0;
+    return result;
+}
+
+/**
+ * Fill in any fields that were missing from a phonebook entry in the file.
+ *
+ * @param entry the entry that was just read
+ */
+static void finish_phonebook_entry(struct q_phone_struct * entry) {
+    if (entry->script_filename == NULL) {
+        entry->script_filename = Xstrdup("", __FILE__, __LINE__);
+    }
+    if (entry->keybindings_filename == NULL) {
+        entry->keybindings_filename = Xstrdup("", __FILE__, __LINE__);
+    }
+    if (entry->capture_filename == NULL) {
+        entry->capture_filename = Xstrdup("", __FILE__, __LINE__);
+    }
+    if (entry->translate_8bit_filename == NULL) {
+        entry->translate_8bit_filename = Xstrdup("", __FILE__, __LINE__);
+    }
+    if (entry->translate_unicode_filename == NULL) {
+        entry->translate_unicode_filename = Xstrdup("", __FILE__, __LINE__);
+    }
+    if (entry->username == NULL) {
+        entry->username = Xwcsdup(L"", __FILE__, __LINE__);
+    }
+    if (entry->password == NULL) {
+        entry->password = Xwcsdup(L"", __FILE__, __LINE__);
+    }
+    if (entry->name == NULL) {
+        entry->name = Xwcsdup(L"", __FILE__, __LINE__);
+    }
+    if (entry->address == NULL) {
+        entry->address = Xstrdup("", __FILE__, __LINE__);
+    }
+    if (entry->port == NULL) {
+        entry->port = Xstrdup("", __FILE__, __LINE__);
+    }
+}
+
+/**
+ * Flush a phonebook or journal file all the way to disk and close it.
+ *
+ * @param file the file to close
+ * @return true if everything written to file made it to disk
+ */
+static Q_BOOL close_phonebook_file(FILE * file) {
+    Q_BOOL rc = Q_TRUE;
+
+    if ((fflush(file) != 0) || (ferror(file) != 0)) {
+        rc = Q_FALSE;
+    }
+#ifndef Q_PDCURSES_WIN32
+    if ((rc == Q_TRUE) && (fsync(fileno(file)) != 0)) {
+        rc = Q_FALSE;
+    }
+#endif
+    if (fclose(file) != 0) {
+        rc = Q_FALSE;
+    }
+    return rc;
+}
+
+/**
+ * Get the name of the phonebook journal, which is the phonebook filename
+ * with ".jnl" appended.
+ *
+ * @return the filename.  This is a newly-allocated string that the caller
+ * must free.
+ */
+static char * phonebook_journal_filename() {
+    char * filename;
+
+    filename =
+        (char *) Xmalloc(sizeof(char) * (strlen(q_phonebook.filename) + 5),
+                         __FILE__, __LINE__);
+    snprintf(filename, strlen(q_phonebook.filename) + 5, "%s.jnl",
+             q_phonebook.filename);
+    return filename;
+}
+
+/**
+ * Apply the journal written by save_phonebook_entry() to the phonebook just
+ * loaded.  A journal only describes the phonebook file it was started
+ * against, so it is thrown away if that file has been rewritten since.
+ */
+static void replay_phonebook_journal() {
+    FILE * file;
+    char * filename;
+    char line[PHONEBOOK_LINE_SIZE];
+    unsigned long save_time;
+    int file_position;
+    int tagged;
+    int quicklearn;
+    unsigned int times_on;
+    unsigned long last_call;
+    struct q_phone_struct * entry;
+
+    phonebook_journal_n = 0;
+    filename = phonebook_journal_filename();
+    file = fopen(filename, "r");
+    if (file == NULL) {
+        Xfree(filename, __FILE__, __LINE__);
+        return;
+    }
+
+    if ((fgets(line, sizeof(line), file) == NULL) ||
+        (sscanf(line, "phonebook=%lu", &save_time) != 1) ||
+        (save_time != (unsigned long) q_phonebook.last_save_time)
+    ) {
+        fclose(file);
+        if (q_status.read_only == Q_FALSE) {
+            remove(filename);
+        }
+        Xfree(filename, __FILE__, __LINE__);
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if ((strchr(line, '\n') == NULL) ||
+            (sscanf(line, "entry=%d %d %d %u %lu", &file_position, &tagged,
+                    &quicklearn, &times_on, &last_call) != 5)
+        ) {
+            /*
+             * A record cut short by a crash.  Nothing after it can be
+             * trusted, so have the next record rewrite the phonebook
+             * instead of appending to this journal.
+             */
+            phonebook_journal_n = PHONEBOOK_JOURNAL_MAX;
+            break;
+        }
+        phonebook_journal_n++;
+
+        entry = phonebook_entry_at(file_position);
+        if ((entry == NULL) || (entry->file_position != file_position)) {
+            continue;
+        }
+        if ((tagged != 0) && (entry->tagged == Q_FALSE)) {
+            q_phonebook.tagged++;
+        } else if ((tagged == 0) && (entry->tagged == Q_TRUE)) {
+            q_phonebook.tagged--;
+        }
+        entry->tagged = (tagged != 0) ? Q_TRUE : Q_FALSE;
+        entry->quicklearn = (quicklearn != 0) ? Q_TRUE : Q_FALSE;
+        entry->times_on = times_on;
+        entry->last_call = (time_t) last_call;
+    }
+    fclose(file);
+    Xfree(filename, __FILE__, __LINE__);
+}
+
+/**
+ * Load the phonebook from file.  The whole file is read at once and parsed
+ * in place in a single pass.
  *
  * @param backup_version if true, load from the backup copy
  */
 void load_phonebook(const Q_BOOL backup_version) {
     FILE * file;
+    char * data;
+    char * data_end;
+    char * position;
+    char * line;
     char * begin;
     char * end;
+    char * key;
     char * filename;
+    size_t data_n;
     int i;
-    char line[PHONEBOOK_LINE_SIZE];
-    char buffer[PHONEBOOK_LINE_SIZE];
-    wchar_t value_wchar[PHONEBOOK_LINE_SIZE];
+    char message[PHONEBOOK_LINE_SIZE];
     struct q_phone_struct * old_entry;
     struct q_phone_struct * new_entry;
 
@@ -892,6 +1300,7 @@ void load_phonebook(const Q_BOOL backup_version) {
 
     int scan_state;
     int notes_length = 0;
+    int notes_max = 0;
     struct stat fstats;
 
     DLOG(("load_phonebook()\n"));
@@ -907,11 +1316,17 @@ void load_phonebook(const Q_BOOL backup_version) {
     }
 
     file = fopen(filename, "r");
-    if (file == NULL) {
-        snprintf(line, sizeof(line),
+    if (file != NULL) {
+        data = read_phonebook_file(file, &data_n);
+        fclose(file);
+    } else {
+        data = NULL;
+    }
+    if (data == NULL) {
+        snprintf(message, sizeof(message),
                  _("Error opening file \"%s\" for reading: %s"), filename,
                  strerror(errno));
-        notify_form(line, 0);
+        notify_form(message, 0);
         if (backup_version == Q_TRUE) {
             Xfree(filename, __FILE__, __LINE__);
         }
@@ -939,6 +1354,7 @@ void load_phonebook(const Q_BOOL backup_version) {
         Xfree(old_entry->translate_8bit_filename, __FILE__, __LINE__);
         Xfree(old_entry->translate_unicode_filename, __FILE__, __LINE__);
         Xfree(old_entry->keybindings_filename, __FILE__, __LINE__);
+        clear_search_text(old_entry);
         new_entry = old_entry;
         old_entry = old_entry->next;
         Xfree(new_entry, __FILE__, __LINE__);
@@ -953,46 +1369,53 @@ void load_phonebook(const Q_BOOL backup_version) {
     q_phonebook.entries = 0;
     q_phonebook.entry_count = 0;
     q_phonebook.selected_entry = NULL;
+    phonebook_sort_method = SORT_METHOD_MAX;
 
     old_entry = NULL;
     new_entry = NULL;
     scan_state = SCAN_STATE_NONE;
-    while (!feof(file)) {
-
-        if (fgets(line, sizeof(line), file) == NULL) {
-            /*
-             * This will cause the outer while's feof() check to fail and
-             * smoothly exit the while loop.
-             */
-            continue;
-        }
-        begin = line;
+    position = data;
+    data_end = data + data_n;
+    while ((line = next_phonebook_line(&position, data_end)) != NULL) {
 
-        DLOG(("  scan_state = %d\n", scan_state));
+        if (scan_state == SCAN_STATE_NOTES) {
+            if ((line[0] != 0) &&
+                (strncmp(line, "END", strlen(line)) == 0)) {
 
-        if (scan_state == SCAN_STATE_NONE) {
-            while ((strlen(line) > 0) && q_isspace(line[strlen(line) - 1])) {
                 /*
-                 * Trim trailing whitespace
+                 * Done, back to entry scanning
                  */
-                line[strlen(line) - 1] = '\0';
+                scan_state = SCAN_STATE_ENTRY;
+                continue;
             }
-            while (q_isspace(*begin)) {
-                /*
-                 * Trim leading whitespace
-                 */
-                begin++;
+            if (notes_length + 1 == notes_max) {
+                notes_max *= 2;
+                new_entry->notes =
+                    (wchar_t **) Xrealloc(new_entry->notes,
+                                          notes_max * sizeof(wchar_t *),
+                                          __FILE__, __LINE__);
             }
-            DLOG(("    line = '%s'\n", line));
-            DLOG(("    begin = '%s'\n", begin));
+            new_entry->notes[notes_length] = phonebook_wcsdup(line);
+            notes_length++;
+            new_entry->notes[notes_length] = NULL;
+            continue;
+        }
 
-            if ((strlen(begin) == 0) || (*begin == '#')) {
-                /*
-                 * Ignore blank lines and commented lines between entries
-                 */
-                continue;
-            }
+        begin = line;
+        while (q_isspace(*begin)) {
+            /*
+             * Trim leading whitespace
+             */
+            begin++;
+        }
+        if ((*begin == 0) || (*begin == '#')) {
+            /*
+             * Ignore blank lines and commented lines
+             */
+            continue;
+        }
 
+        if (scan_state == SCAN_STATE_NONE) {
             if (strncmp(begin, "[entry]", strlen("[entry]")) == 0) {
                 /*
                  * Beginning of an entry found
@@ -1008,50 +1431,10 @@ void load_phonebook(const Q_BOOL backup_version) {
                 } else {
                     old_entry->next = new_entry;
                     new_entry->prev = old_entry;
-
-                    /*
-                     * Fixup any missing fields
-                     */
-                    if (old_entry->script_filename == NULL) {
-                        old_entry->script_filename =
-                            Xstrdup("", __FILE__, __LINE__);
-                    }
-                    if (old_entry->keybindings_filename == NULL) {
-                        old_entry->keybindings_filename =
-                            Xstrdup("", __FILE__, __LINE__);
-                    }
-                    if (old_entry->capture_filename == NULL) {
-                        old_entry->capture_filename =
-                            Xstrdup("", __FILE__, __LINE__);
-                    }
-                    if (old_entry->translate_8bit_filename == NULL) {
-                        old_entry->translate_8bit_filename =
-                            Xstrdup("", __FILE__, __LINE__);
-                    }
-                    if (old_entry->translate_unicode_filename == NULL) {
-                        old_entry->translate_unicode_filename =
-                            Xstrdup("", __FILE__, __LINE__);
-                    }
-                    if (old_entry->username == NULL) {
-                        old_entry->username = Xwcsdup(L"", __FILE__, __LINE__);
-                    }
-                    if (old_entry->password == NULL) {
-                        old_entry->password = Xwcsdup(L"", __FILE__, __LINE__);
-                    }
-                    if (old_entry->name == NULL) {
-                        old_entry->name = Xwcsdup(L"", __FILE__, __LINE__);
-                    }
-                    if (old_entry->address == NULL) {
-                        old_entry->address = Xstrdup("", __FILE__, __LINE__);
-                    }
-                    if (old_entry->port == NULL) {
-                        old_entry->port = Xstrdup("", __FILE__, __LINE__);
-                    }
+                    finish_phonebook_entry(old_entry);
                 }
 
                 q_phonebook.entry_count++;
-                new_entry->port = NULL;
-                new_entry->notes = NULL;
                 new_entry->tagged = Q_FALSE;
                 new_entry->doorway = Q_DOORWAY_CONFIG;
                 new_entry->emulation = Q_EMUL_XTERM_UTF8;
@@ -1068,370 +1451,299 @@ void load_phonebook(const Q_BOOL backup_version) {
                 new_entry->lock_dte_baud = Q_TRUE;
 #endif
 
-                new_entry->name = NULL;
-                new_entry->address = NULL;
-                new_entry->port = NULL;
-                new_entry->username = NULL;
-                new_entry->password = NULL;
-                new_entry->script_filename = NULL;
-                new_entry->capture_filename = NULL;
-                new_entry->translate_8bit_filename = NULL;
-                new_entry->translate_unicode_filename = NULL;
-                new_entry->keybindings_filename = NULL;
                 new_entry->use_default_toggles = Q_TRUE;
                 new_entry->toggles = 0;
                 new_entry->quicklearn = Q_FALSE;
-
                 new_entry->next = NULL;
 
                 /*
                  * Save entry
                  */
                 old_entry = new_entry;
-                continue;
-            }
-        }
-
-        if (scan_state == SCAN_STATE_ENTRY) {
-            while ((strlen(line) > 0) && q_isspace(line[strlen(line) - 1])) {
+            } else if (strncmp(begin, "sort=", strlen("sort=")) == 0) {
                 /*
-                 * Trim trailing whitespace
+                 * The sort order to keep entries in
                  */
-                line[strlen(line) - 1] = '\0';
-            }
-            while (q_isspace(*begin)) {
-                /*
-                 * Trim leading whitespace
-                 */
-                begin++;
+                for (i = 0; i < SORT_METHOD_REVERSE; i++) {
+                    if (strcmp(begin + strlen("sort="),
+                            sort_method_names[i]) == 0) {
+                        phonebook_sort_method = i;
+                    }
+                }
             }
+            continue;
+        }
 
-            if ((strlen(begin) == 0) || (*begin == '#')) {
-                /*
-                 * Ignore blank lines and commented lines between entries
-                 */
-                continue;
-            }
+        /*
+         * SCAN_STATE_ENTRY: split "key=value".
+         */
+        end = strchr(begin, '=');
+        if (end == NULL) {
+            /*
+             * Ignore this line.
+             */
+            continue;
+        }
+        key = begin;
+        begin = end + 1;
+        while ((end > key) && q_isspace(end[-1])) {
+            end--;
+        }
+        *end = 0;
 
-            end = strchr(begin, '=');
-            if (end == NULL) {
-                /*
-                 * Ignore this line.
-                 */
-                continue;
+        if (strcmp(key, "name") == 0) {
+            /*
+             * NAME
+             */
+            new_entry->name = phonebook_wcsdup(begin);
+        } else if (strcmp(key, "address") == 0) {
+            /*
+             * ADDRESS
+             */
+            new_entry->address = Xstrdup(begin, __FILE__, __LINE__);
+        } else if (strcmp(key, "port") == 0) {
+            /*
+             * PORT
+             */
+            new_entry->port = Xstrdup(begin, __FILE__, __LINE__);
+        } else if (strcmp(key, "username") == 0) {
+            /*
+             * USERNAME
+             */
+            new_entry->username = phonebook_wcsdup(begin);
+        } else if (strcmp(key, "password") == 0) {
+            /*
+             * PASSWORD
+             */
+            new_entry->password = phonebook_wcsdup(begin);
+        } else if (strcmp(key, "tagged") == 0) {
+            /*
+             * TAGGED
+             */
+            if (strncasecmp(begin, "true", strlen("true")) == 0) {
+                new_entry->tagged = Q_TRUE;
+                q_phonebook.tagged++;
             }
-            memset(buffer, 0, sizeof(buffer));
-            strncpy(buffer, begin, end - begin);
-            begin = end + 1;
-
-            mbstowcs(value_wchar, begin, strlen(begin) + 1);
-
-            if (strncmp(buffer, "name", strlen("name")) == 0) {
-                /*
-                 * NAME
-                 */
-                new_entry->name = Xwcsdup(value_wchar, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "address", strlen("address")) == 0) {
-                /*
-                 * ADDRESS
-                 */
-                new_entry->address = Xstrdup(begin, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "port", strlen("port")) == 0) {
-                /*
-                 * PORT
-                 */
-                new_entry->port = Xstrdup(begin, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "username", strlen("password")) == 0) {
-                /*
-                 * USERNAME
-                 */
-                new_entry->username = Xwcsdup(value_wchar, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "password", strlen("password")) == 0) {
-                /*
-                 * PASSWORD
-                 */
-                new_entry->password = Xwcsdup(value_wchar, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "tagged", strlen("tagged")) == 0) {
-                /*
-                 * TAGGED
-                 */
-                if (strncasecmp(begin, "true", strlen("true")) == 0) {
-                    new_entry->tagged = Q_TRUE;
-                    q_phonebook.tagged++;
-                }
-            } else if (strncmp(buffer, "doorway", strlen("doorway")) == 0) {
-                /*
-                 * DOORWAY
-                 */
-                if (strncasecmp(begin, "doorway", strlen("doorway")) == 0) {
-                    new_entry->doorway = Q_DOORWAY_ALWAYS_DOORWAY;
-                } else if (strncasecmp(begin, "always",
-                        strlen("always")) == 0) {
-                    /*
-                     * Allow "always" to mean always doorway too, for upgrading
-                     */
-                    new_entry->doorway = Q_DOORWAY_ALWAYS_DOORWAY;
-                } else if (strncasecmp(begin, "mixed", strlen("mixed")) == 0) {
-                    new_entry->doorway = Q_DOORWAY_ALWAYS_MIXED;
-                } else if (strncasecmp(begin, "never", strlen("never")) == 0) {
-                    new_entry->doorway = Q_DOORWAY_NEVER;
-                } else {
-                    new_entry->doorway = Q_DOORWAY_CONFIG;
-                }
-            } else if (strncmp(buffer, "method", strlen("method")) == 0) {
-                /*
-                 * METHOD
-                 */
-                new_entry->method = method_from_string(begin);
-                if (new_entry->port == NULL) {
-                    new_entry->port = default_port(new_entry->method);
-                }
-            } else if (strncmp(buffer, "emulation", strlen("emulation")) == 0) {
-                /*
-                 * EMULATION
-                 */
-                new_entry->emulation = emulation_from_string(begin);
-                /*
-                 * Set codepage right now in case it's not declared in the
-                 * file (upgrade case).
-                 */
-                new_entry->codepage = default_codepage(new_entry->emulation);
-            } else if (strncmp(buffer, "codepage", strlen("codepage")) == 0) {
-                /*
-                 * CODEPAGE
-                 */
-                new_entry->codepage = codepage_from_string(begin);
-            } else if (strncmp(buffer, "quicklearn",
-                    strlen("quicklearn")) == 0) {
+        } else if (strcmp(key, "doorway") == 0) {
+            /*
+             * DOORWAY
+             */
+            if (strncasecmp(begin, "doorway", strlen("doorway")) == 0) {
+                new_entry->doorway = Q_DOORWAY_ALWAYS_DOORWAY;
+            } else if (strncasecmp(begin, "always", strlen("always")) == 0) {
                 /*
-                 * QUICKLEARN
+                 * Allow "always" to mean always doorway too, for upgrading
                  */
-                if (strncmp(begin, "true", strlen("true")) == 0) {
-                    new_entry->quicklearn = Q_TRUE;
-                }
+                new_entry->doorway = Q_DOORWAY_ALWAYS_DOORWAY;
+            } else if (strncasecmp(begin, "mixed", strlen("mixed")) == 0) {
+                new_entry->doorway = Q_DOORWAY_ALWAYS_MIXED;
+            } else if (strncasecmp(begin, "never", strlen("never")) == 0) {
+                new_entry->doorway = Q_DOORWAY_NEVER;
+            } else {
+                new_entry->doorway = Q_DOORWAY_CONFIG;
+            }
+        } else if (strcmp(key, "method") == 0) {
+            /*
+             * METHOD
+             */
+            new_entry->method = method_from_string(begin);
+            if (new_entry->port == NULL) {
+                new_entry->port = default_port(new_entry->method);
+            }
+        } else if (strcmp(key, "emulation") == 0) {
+            /*
+             * EMULATION
+             */
+            new_entry->emulation = emulation_from_string(begin);
+            /*
+             * Set codepage right now in case it's not declared in the file
+             * (upgrade case).
+             */
+            new_entry->codepage = default_codepage(new_entry->emulation);
+        } else if (strcmp(key, "codepage") == 0) {
+            /*
+             * CODEPAGE
+             */
+            new_entry->codepage = codepage_from_string(begin);
+        } else if (strcmp(key, "quicklearn") == 0) {
+            /*
+             * QUICKLEARN
+             */
+            if (strncmp(begin, "true", strlen("true")) == 0) {
+                new_entry->quicklearn = Q_TRUE;
+            }
 #ifndef Q_NO_SERIAL
-            } else if (strncmp(buffer, "use_modem_cfg",
-                    strlen("use_modem_cfg")) == 0) {
-                /*
-                 * USE_MODEM_CFG
-                 */
-                if (strncmp(begin, "false", strlen("false")) == 0) {
-                    new_entry->use_modem_cfg = Q_FALSE;
-                }
+        } else if (strcmp(key, "use_modem_cfg") == 0) {
+            /*
+             * USE_MODEM_CFG
+             */
+            if (strncmp(begin, "false", strlen("false")) == 0) {
+                new_entry->use_modem_cfg = Q_FALSE;
+            }
 #endif
-            } else if (strncmp(buffer, "use_default_toggles",
-                    strlen("use_default_toggles")) == 0) {
-                /*
-                 * USE_DEFAULT_TOGGLES
-                 */
-                if (strncmp(begin, "false", strlen("false")) == 0) {
-                    new_entry->use_default_toggles = Q_FALSE;
-                }
-            } else if (strncmp(buffer, "toggles", strlen("toggles")) == 0) {
-                /*
-                 * TOGGLES
-                 */
-                new_entry->toggles = atoi(begin);
+        } else if (strcmp(key, "use_default_toggles") == 0) {
+            /*
+             * USE_DEFAULT_TOGGLES
+             */
+            if (strncmp(begin, "false", strlen("false")) == 0) {
+                new_entry->use_default_toggles = Q_FALSE;
+            }
+        } else if (strcmp(key, "toggles") == 0) {
+            /*
+             * TOGGLES
+             */
+            new_entry->toggles = atoi(begin);
 #ifndef Q_NO_SERIAL
-            } else if (strncmp(buffer, "xonxoff", strlen("xonxoff")) == 0) {
-                /*
-                 * XONXOFF
-                 */
-                if (strncmp(begin, "true", strlen("true")) == 0) {
-                    new_entry->xonxoff = Q_TRUE;
-                }
-            } else if (strncmp(buffer, "rtscts", strlen("rtscts")) == 0) {
-                /*
-                 * RTSCTS
-                 */
-                if (strncmp(begin, "false", strlen("false")) == 0) {
-                    new_entry->rtscts = Q_FALSE;
-                }
-            } else if (strncmp(buffer, "baud", strlen("baud")) == 0) {
-                /*
-                 * BAUD
-                 */
-                if (strcmp(begin, "300") == 0) {
-                    new_entry->baud = Q_BAUD_300;
-                } else if (strcmp(begin, "1200") == 0) {
-                    new_entry->baud = Q_BAUD_1200;
-                } else if (strcmp(begin, "2400") == 0) {
-                    new_entry->baud = Q_BAUD_2400;
-                } else if (strcmp(begin, "4800") == 0) {
-                    new_entry->baud = Q_BAUD_4800;
-                } else if (strcmp(begin, "9600") == 0) {
-                    new_entry->baud = Q_BAUD_9600;
-                } else if (strcmp(begin, "19200") == 0) {
-                    new_entry->baud = Q_BAUD_19200;
-                } else if (strcmp(begin, "38400") == 0) {
-                    new_entry->baud = Q_BAUD_38400;
-                } else if (strcmp(begin, "57600") == 0) {
-                    new_entry->baud = Q_BAUD_57600;
-                } else if (strcmp(begin, "115200") == 0) {
-                    new_entry->baud = Q_BAUD_115200;
-                } else if (strcmp(begin, "230400") == 0) {
-                    new_entry->baud = Q_BAUD_230400;
-                }
-
-            } else if (strncmp(buffer, "data_bits", strlen("data_bits")) == 0) {
-                if (strcmp(begin, "8") == 0) {
-                    new_entry->data_bits = Q_DATA_BITS_8;
-                } else if (strcmp(begin, "7") == 0) {
-                    new_entry->data_bits = Q_DATA_BITS_7;
-                } else if (strcmp(begin, "6") == 0) {
-                    new_entry->data_bits = Q_DATA_BITS_6;
-                } else if (strcmp(begin, "5") == 0) {
-                    new_entry->data_bits = Q_DATA_BITS_5;
-                }
-            } else if (strncmp(buffer, "parity", strlen("parity")) == 0) {
-                if (strcmp(begin, "none") == 0) {
-                    new_entry->parity = Q_PARITY_NONE;
-                } else if (strcmp(begin, "even") == 0) {
-                    new_entry->parity = Q_PARITY_EVEN;
-                } else if (strcmp(begin, "odd") == 0) {
-                    new_entry->parity = Q_PARITY_ODD;
-                } else if (strcmp(begin, "mark") == 0) {
-                    new_entry->parity = Q_PARITY_MARK;
-                } else if (strcmp(begin, "space") == 0) {
-                    new_entry->parity = Q_PARITY_SPACE;
-                }
-            } else if (strncmp(buffer, "stop_bits", strlen("stop_bits")) == 0) {
-                if (strcmp(begin, "1") == 0) {
-                    new_entry->stop_bits = Q_STOP_BITS_1;
-                } else if (strcmp(begin, "2") == 0) {
-                    new_entry->stop_bits = Q_STOP_BITS_2;
-                }
-            } else if (strncmp(buffer, "lock_dte_baud", strlen("lock_dte_baud"))
-                       == 0) {
-                if (strcmp(begin, "true") == 0) {
-                    new_entry->lock_dte_baud = Q_TRUE;
-                } else if (strcmp(begin, "false") == 0) {
-                    new_entry->lock_dte_baud = Q_FALSE;
-                }
-#endif /* Q_NO_SERIAL */
-
-            } else if (strncmp(buffer, "times_on", strlen("times_on")) == 0) {
-                /*
-                 * TIMES ON
-                 */
-                new_entry->times_on = atol(begin);
-            } else if (strncmp(buffer, "last_call", strlen("last_call")) == 0) {
-                /*
-                 * LAST CALL
-                 */
-                new_entry->last_call = atol(begin);
-            } else if (strncmp(buffer, "notes", strlen("notes")) == 0) {
-                /*
-                 * Switch state to reading Notes
-                 */
-                new_entry->notes =
-                    (wchar_t **) Xmalloc(sizeof(wchar_t *), __FILE__, __LINE__);
-                notes_length = 0;
-                new_entry->notes[notes_length] = NULL;
-                scan_state = SCAN_STATE_NOTES;
-                continue;
-            } else if (strncmp(buffer, "script_filename",
-                    strlen("script_filename")) == 0) {
-                /*
-                 * SCRIPT FILENAME
-                 */
-                new_entry->script_filename = Xstrdup(begin, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "capture_filename",
-                    strlen("capture_filename")) == 0) {
-                /*
-                 * CAPTURE FILENAME
-                 */
-                new_entry->capture_filename =
-                    Xstrdup(begin, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "translate_8bit_filename",
-                    strlen("translate_8bit_filename")) == 0) {
-                /*
-                 * 8-BIT TRANSLATE FILENAME
-                 */
-                new_entry->translate_8bit_filename =
-                    Xstrdup(begin, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "translate_unicode_filename",
-                    strlen("translate_unicode_filename")) == 0) {
-                /*
-                 * UNICODE TRANSLATE FILENAME
-                 */
-                new_entry->translate_unicode_filename =
-                    Xstrdup(begin, __FILE__, __LINE__);
-            } else if (strncmp(buffer, "keybindings_filename",
-                    strlen("keybindings_filename")) == 0) {
-                /*
-                 * KEY BINDINGS
-                 */
-                new_entry->keybindings_filename =
-                    Xstrdup(begin, __FILE__, __LINE__);
-
-                /*
-                 * -------------------
-                 * ---- LAST ITEM ----
-                 * -------------------
-                 *
-                 * There are no more supported options, switch state.
-                 */
-                scan_state = SCAN_STATE_NONE;
+        } else if (strcmp(key, "xonxoff") == 0) {
+            /*
+             * XONXOFF
+             */
+            if (strncmp(begin, "true", strlen("true")) == 0) {
+                new_entry->xonxoff = Q_TRUE;
             }
-        } /* (scan_state == SCAN_STATE_ENTRY) */
-
-        if (scan_state == SCAN_STATE_NOTES) {
-            while ((strlen(line) > 0) && q_isspace(line[strlen(line) - 1])) {
-                /*
-                 * Trim trailing whitespace
-                 */
-                line[strlen(line) - 1] = '\0';
+        } else if (strcmp(key, "rtscts") == 0) {
+            /*
+             * RTSCTS
+             */
+            if (strncmp(begin, "false", strlen("false")) == 0) {
+                new_entry->rtscts = Q_FALSE;
             }
-            if ((strlen(line) > 0) &&
-                (strncmp(line, "END", strlen(line)) == 0)) {
-
-                /*
-                 * Done, back to entry scanning
-                 */
-                scan_state = SCAN_STATE_ENTRY;
-                continue;
+        } else if (strcmp(key, "baud") == 0) {
+            /*
+             * BAUD
+             */
+            if (strcmp(begin, "300") == 0) {
+                new_entry->baud = Q_BAUD_300;
+            } else if (strcmp(begin, "1200") == 0) {
+                new_entry->baud = Q_BAUD_1200;
+            } else if (strcmp(begin, "2400") == 0) {
+                new_entry->baud = Q_BAUD_2400;
+            } else if (strcmp(begin, "4800") == 0) {
+                new_entry->baud = Q_BAUD_4800;
+            } else if (strcmp(begin, "9600") == 0) {
+                new_entry->baud = Q_BAUD_9600;
+            } else if (strcmp(begin, "19200") == 0) {
+                new_entry->baud = Q_BAUD_19200;
+            } else if (strcmp(begin, "38400") == 0) {
+                new_entry->baud = Q_BAUD_38400;
+            } else if (strcmp(begin, "57600") == 0) {
+                new_entry->baud = Q_BAUD_57600;
+            } else if (strcmp(begin, "115200") == 0) {
+                new_entry->baud = Q_BAUD_115200;
+            } else if (strcmp(begin, "230400") == 0) {
+                new_entry->baud = Q_BAUD_230400;
             }
-            notes_length++;
-            new_entry->notes =
-                (wchar_t **) Xrealloc(new_entry->notes,
-                                      (notes_length + 1) * sizeof(wchar_t *),
-                                      __FILE__, __LINE__);
+        } else if (strcmp(key, "data_bits") == 0) {
+            if (strcmp(begin, "8") == 0) {
+                new_entry->data_bits = Q_DATA_BITS_8;
+            } else if (strcmp(begin, "7") == 0) {
+                new_entry->data_bits = Q_DATA_BITS_7;
+            } else if (strcmp(begin, "6") == 0) {
+                new_entry->data_bits = Q_DATA_BITS_6;
+            } else if (strcmp(begin, "5") == 0) {
+                new_entry->data_bits = Q_DATA_BITS_5;
+            }
+        } else if (strcmp(key, "parity") == 0) {
+            if (strcmp(begin, "none") == 0) {
+                new_entry->parity = Q_PARITY_NONE;
+            } else if (strcmp(begin, "even") == 0) {
+                new_entry->parity = Q_PARITY_EVEN;
+            } else if (strcmp(begin, "odd") == 0) {
+                new_entry->parity = Q_PARITY_ODD;
+            } else if (strcmp(begin, "mark") == 0) {
+                new_entry->parity = Q_PARITY_MARK;
+            } else if (strcmp(begin, "space") == 0) {
+                new_entry->parity = Q_PARITY_SPACE;
+            }
+        } else if (strcmp(key, "stop_bits") == 0) {
+            if (strcmp(begin, "1") == 0) {
+                new_entry->stop_bits = Q_STOP_BITS_1;
+            } else if (strcmp(begin, "2") == 0) {
+                new_entry->stop_bits = Q_STOP_BITS_2;
+            }
+        } else if (strcmp(key, "lock_dte_baud") == 0) {
+            if (strcmp(begin, "true") == 0) {
+                new_entry->lock_dte_baud = Q_TRUE;
+            } else if (strcmp(begin, "false") == 0) {
+                new_entry->lock_dte_baud = Q_FALSE;
+            }
+#endif /* Q_NO_SERIAL */
+
+        } else if (strcmp(key, "times_on") == 0) {
             /*
-             * Ensure line is terminated
+             * TIMES ON
              */
-            line[sizeof(line) - 1] = 0;
-            mbstowcs(value_wchar, line, strlen(line) + 1);
-            new_entry->notes[notes_length - 1] =
-                Xwcsdup(value_wchar, __FILE__, __LINE__);
+            new_entry->times_on = atol(begin);
+        } else if (strcmp(key, "last_call") == 0) {
+            /*
+             * LAST CALL
+             */
+            new_entry->last_call = atol(begin);
+        } else if (strcmp(key, "notes") == 0) {
+            /*
+             * Switch state to reading Notes
+             */
+            notes_max = 8;
+            new_entry->notes =
+                (wchar_t **) Xmalloc(notes_max * sizeof(wchar_t *),
+                                     __FILE__, __LINE__);
+            notes_length = 0;
             new_entry->notes[notes_length] = NULL;
+            scan_state = SCAN_STATE_NOTES;
+        } else if (strcmp(key, "script_filename") == 0) {
+            /*
+             * SCRIPT FILENAME
+             */
+            new_entry->script_filename = Xstrdup(begin, __FILE__, __LINE__);
+        } else if (strcmp(key, "capture_filename") == 0) {
+            /*
+             * CAPTURE FILENAME
+             */
+            new_entry->capture_filename = Xstrdup(begin, __FILE__, __LINE__);
+        } else if (strcmp(key, "translate_8bit_filename") == 0) {
+            /*
+             * 8-BIT TRANSLATE FILENAME
+             */
+            new_entry->translate_8bit_filename =
+                Xstrdup(begin, __FILE__, __LINE__);
+        } else if (strcmp(key, "translate_unicode_filename") == 0) {
+            /*
+             * UNICODE TRANSLATE FILENAME
+             */
+            new_entry->translate_unicode_filename =
+                Xstrdup(begin, __FILE__, __LINE__);
+        } else if (strcmp(key, "keybindings_filename") == 0) {
+            /*
+             * KEY BINDINGS
+             */
+            new_entry->keybindings_filename =
+                Xstrdup(begin, __FILE__, __LINE__);
+
+            /*
+             * -------------------
+             * ---- LAST ITEM ----
+             * -------------------
+             *
+             * There are no more supported options, switch state.
+             */
+            scan_state = SCAN_STATE_NONE;
         }
 
-    } /* while (!feof(file)) */
+    } /* while ((line = next_phonebook_line(...)) != NULL) */
+
+    Xfree(data, __FILE__, __LINE__);
 
     /*
      * Fixup any missing fields
      */
-    if (new_entry->script_filename == NULL) {
-        new_entry->script_filename = Xstrdup("", __FILE__, __LINE__);
-    }
-    if (new_entry->capture_filename == NULL) {
-        new_entry->capture_filename = Xstrdup("", __FILE__, __LINE__);
-    }
-    if (new_entry->translate_8bit_filename == NULL) {
-        new_entry->translate_8bit_filename = Xstrdup("", __FILE__, __LINE__);
-    }
-    if (new_entry->translate_unicode_filename == NULL) {
-        new_entry->translate_unicode_filename = Xstrdup("", __FILE__, __LINE__);
-    }
-    if (new_entry->keybindings_filename == NULL) {
-        new_entry->keybindings_filename = Xstrdup("", __FILE__, __LINE__);
+    if (new_entry != NULL) {
+        finish_phonebook_entry(new_entry);
     }
 
     q_phonebook.selected_entry = q_phonebook.entries;
-    fclose(file);
     phonebook_page = 0;
     phonebook_entry_i = 0;
+    phonebook_list_changed();
 
     /*
      * Save the last modified time, so that we can decide if someone else has
@@ -1441,20 +1753,49 @@ void load_phonebook(const Q_BOOL backup_version) {
         q_phonebook.last_save_time = fstats.st_mtime;
     }
 
+    /*
+     * Journal records refer to entries by their place in the file.  The
+     * backup copy has no journal, and its entries are only in the main
+     * phonebook file once it is saved in full.
+     */
+    i = 0;
+    for (new_entry = q_phonebook.entries; new_entry != NULL;
+         new_entry = new_entry->next) {
+        if (backup_version == Q_FALSE) {
+            new_entry->file_position = i;
+        } else {
+            new_entry->file_position = -1;
+        }
+        new_entry->journal_pending = Q_FALSE;
+        i++;
+    }
+    if (backup_version == Q_FALSE) {
+        replay_phonebook_journal();
+        phonebook_dirty = Q_FALSE;
+    }
+
+    if (backup_version == Q_TRUE) {
+        Xfree(filename, __FILE__, __LINE__);
+    }
 }
 
 /**
- * Save the phonebook to file.
+ * Save the phonebook to file.  The phonebook is written to a temporary file
+ * that replaces the old one only once it is safely on disk, so a crash or
+ * full disk never leaves a truncated phonebook behind.
  *
  * @param backup_version if true, save to the backup copy
  */
 static void save_phonebook(const Q_BOOL backup_version) {
     FILE * file;
     char * filename;
+    char * tmp_filename;
+    char * journal_filename;
     struct q_phone_struct * entry;
     char notify_message[DIALOG_MESSAGE_SIZE];
     wchar_t * notes_line;
     int current_notes_idx;
+    int file_position;
     struct stat fstats;
 
     if (q_status.read_only == Q_TRUE) {
@@ -1471,12 +1812,18 @@ static void save_phonebook(const Q_BOOL backup_version) {
                  q_phonebook.filename);
     }
 
-    file = fopen(filename, "w");
+    tmp_filename =
+        (char *) Xmalloc(sizeof(char) * (strlen(filename) + 5),
+                         __FILE__, __LINE__);
+    snprintf(tmp_filename, strlen(filename) + 5, "%s.tmp", filename);
+
+    file = fopen(tmp_filename, "w");
     if (file == NULL) {
         snprintf(notify_message, sizeof(notify_message),
-                 _("Error opening file \"%s\" for writing: %s"), filename,
+                 _("Error opening file \"%s\" for writing: %s"), tmp_filename,
                  strerror(errno));
         notify_form(notify_message, 0);
+        Xfree(tmp_filename, __FILE__, __LINE__);
         if (backup_version == Q_TRUE) {
             Xfree(filename, __FILE__, __LINE__);
         }
@@ -1485,6 +1832,9 @@ static void save_phonebook(const Q_BOOL backup_version) {
 
     fprintf(file, "# Qodem Phonebook\n");
     fprintf(file, "#\n");
+    if (phonebook_sort_method != SORT_METHOD_MAX) {
+        fprintf(file, "sort=%s\n", sort_method_names[phonebook_sort_method]);
+    }
 
     for (entry = q_phonebook.entries; entry != NULL; entry = entry->next) {
         fprintf(file, "[entry]\n");
@@ -1544,28 +1894,200 @@ static void save_phonebook(const Q_BOOL backup_version) {
             }
             fprintf(file, "END\n");
         }
-        fprintf(file, "script_filename=%s\n", entry->script_filename);
-        fprintf(file, "capture_filename=%s\n", entry->capture_filename);
-        fprintf(file, "translate_8bit_filename=%s\n",
-            entry->translate_8bit_filename);
-        fprintf(file, "translate_unicode_filename=%s\n",
-            entry->translate_unicode_filename);
-        fprintf(file, "keybindings_filename=%s\n", entry->keybindings_filename);
-        fprintf(file, "\n");
+        fprintf(file, "script_filename=%s\n", entry->script_filename);
+        fprintf(file, "capture_filename=%s\n", entry->capture_filename);
+        fprintf(file, "translate_8bit_filename=%s\n",
+            entry->translate_8bit_filename);
+        fprintf(file, "translate_unicode_filename=%s\n",
+            entry->translate_unicode_filename);
+        fprintf(file, "keybindings_filename=%s\n", entry->keybindings_filename);
+        fprintf(file, "\n");
+    }
+
+    if (close_phonebook_file(file) == Q_FALSE) {
+        snprintf(notify_message, sizeof(notify_message),
+                 _("Error writing to file \"%s\": %s"), tmp_filename,
+                 strerror(errno));
+        notify_form(notify_message, 0);
+        remove(tmp_filename);
+        Xfree(tmp_filename, __FILE__, __LINE__);
+        if (backup_version == Q_TRUE) {
+            Xfree(filename, __FILE__, __LINE__);
+        }
+        return;
+    }
+
+#ifdef Q_PDCURSES_WIN32
+    /*
+     * rename() will not replace an existing file on Windows, but
+     * MoveFileExA() can do it without a window where neither exists.
+     */
+    if (MoveFileExA(tmp_filename, filename,
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == 0
+    ) {
+        snprintf(notify_message, sizeof(notify_message),
+                 _("Error writing to file \"%s\": %s"), filename,
+                 strerror(GetLastError()));
+#else
+    if (rename(tmp_filename, filename) != 0) {
+        snprintf(notify_message, sizeof(notify_message),
+                 _("Error writing to file \"%s\": %s"), filename,
+                 strerror(errno));
+#endif
+        notify_form(notify_message, 0);
+        remove(tmp_filename);
+        Xfree(tmp_filename, __FILE__, __LINE__);
+        if (backup_version == Q_TRUE) {
+            Xfree(filename, __FILE__, __LINE__);
+        }
+        return;
+    }
+    Xfree(tmp_filename, __FILE__, __LINE__);
+
+    if (backup_version == Q_TRUE) {
+        Xfree(filename, __FILE__, __LINE__);
+        return;
+    }
+
+    /*
+     * Save the last modified time, so that we can decide if someone else has
+     * modified it.
+     */
+    if (stat(filename, &fstats) == 0) {
+        q_phonebook.last_save_time = fstats.st_mtime;
+    }
+
+    /*
+     * Everything the journal held is in the file now.
+     */
+    file_position = 0;
+    for (entry = q_phonebook.entries; entry != NULL; entry = entry->next) {
+        entry->file_position = file_position;
+        entry->journal_pending = Q_FALSE;
+        file_position++;
+    }
+    journal_filename = phonebook_journal_filename();
+    remove(journal_filename);
+    Xfree(journal_filename, __FILE__, __LINE__);
+    phonebook_journal_n = 0;
+    phonebook_dirty = Q_FALSE;
+}
+
+/**
+ * Mark an entry as needing a journal record.
+ *
+ * @param entry the phonebook entry that changed
+ * @return true if the entry can be journaled
+ */
+static Q_BOOL journal_phonebook_entry(struct q_phone_struct * entry) {
+    if (q_status.read_only == Q_TRUE) {
+        return Q_FALSE;
+    }
+
+    build_phonebook_index();
+    if (phonebook_entry_at(entry->position) != entry) {
+        /*
+         * A manual call, not part of the phonebook.
+         */
+        return Q_FALSE;
+    }
+
+    if (entry->file_position == -1) {
+        /*
+         * This entry is not in the file yet, the next full save will pick
+         * it up.
+         */
+        phonebook_dirty = Q_TRUE;
+        return Q_FALSE;
+    }
+
+    entry->journal_pending = Q_TRUE;
+    return Q_TRUE;
+}
+
+/**
+ * Record an entry's tag, quicklearn flag, and dial statistics.  These change
+ * on nearly every call, so rather than rewrite the whole phonebook they are
+ * appended to a journal that load_phonebook() replays.  Once the journal is
+ * full the phonebook is saved in full, which starts a new journal.
+ *
+ * @param entry the phonebook entry that changed
+ */
+void save_phonebook_entry(struct q_phone_struct * entry) {
+    if (journal_phonebook_entry(entry) == Q_TRUE) {
+        flush_phonebook_journal();
+    }
+}
+
+/**
+ * Write the journal records for tag changes made in the phonebook screen.
+ * Tagging only marks the entry, so that running the space bar down a long
+ * list costs one append and one sync here rather than one per entry.
+ */
+void flush_phonebook_journal() {
+    FILE * file;
+    char * filename;
+    char notify_message[DIALOG_MESSAGE_SIZE];
+    struct q_phone_struct * entry;
+    int pending_n = 0;
+
+    for (entry = q_phonebook.entries; entry != NULL; entry = entry->next) {
+        if (entry->journal_pending == Q_TRUE) {
+            pending_n++;
+        }
+    }
+    if (pending_n == 0) {
+        return;
     }
-    fclose(file);
 
-    /*
-     * Save the last modified time, so that we can decide if someone else has
-     * modified it.
-     */
-    if ((stat(filename, &fstats) == 0) && (backup_version == Q_FALSE)) {
-        q_phonebook.last_save_time = fstats.st_mtime;
+    if (phonebook_journal_n + pending_n > PHONEBOOK_JOURNAL_MAX) {
+        if (phonebook_is_mine(Q_FALSE) == Q_TRUE) {
+            save_phonebook(Q_FALSE);
+        }
+        for (entry = q_phonebook.entries; entry != NULL;
+             entry = entry->next) {
+            entry->journal_pending = Q_FALSE;
+        }
+        return;
     }
 
-    if (backup_version == Q_TRUE) {
+    filename = phonebook_journal_filename();
+    if (phonebook_journal_n == 0) {
+        file = fopen(filename, "w");
+    } else {
+        file = fopen(filename, "a");
+    }
+    if (file == NULL) {
+        snprintf(notify_message, sizeof(notify_message),
+                 _("Error opening file \"%s\" for writing: %s"), filename,
+                 strerror(errno));
+        notify_form(notify_message, 0);
         Xfree(filename, __FILE__, __LINE__);
+        phonebook_dirty = Q_TRUE;
+        return;
+    }
+
+    if (phonebook_journal_n == 0) {
+        fprintf(file, "phonebook=%lu\n",
+                (unsigned long) q_phonebook.last_save_time);
+    }
+    for (entry = q_phonebook.entries; entry != NULL; entry = entry->next) {
+        if (entry->journal_pending == Q_FALSE) {
+            continue;
+        }
+        fprintf(file, "entry=%d %d %d %u %lu\n", entry->file_position,
+                (entry->tagged == Q_TRUE) ? 1 : 0,
+                (entry->quicklearn == Q_TRUE) ? 1 : 0,
+                entry->times_on, (unsigned long) entry->last_call);
+        entry->journal_pending = Q_FALSE;
+    }
+
+    if (close_phonebook_file(file) == Q_TRUE) {
+        phonebook_journal_n += pending_n;
+    } else {
+        phonebook_dirty = Q_TRUE;
     }
+    Xfree(filename, __FILE__, __LINE__);
 }
 
 /**
@@ -1609,6 +2131,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_XTERM_UTF8;
@@ -1658,6 +2181,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_ANSI;
@@ -1706,6 +2230,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"new", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_XTERM_UTF8;
@@ -1755,6 +2280,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_VT102;
@@ -1803,6 +2329,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_XTERM_UTF8;
@@ -1852,6 +2379,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"bbs", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"bbs", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_XTERM_UTF8;
@@ -1900,6 +2428,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_XTERM_UTF8;
@@ -1949,6 +2478,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_ANSI;
@@ -1998,6 +2528,7 @@ void create_phonebook() {
     new_entry->username         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->password         = Xwcsdup(L"", __FILE__, __LINE__);
     new_entry->notes            = NULL;
+    new_entry->search_text      = NULL;
     new_entry->tagged           = Q_FALSE;
     new_entry->doorway          = Q_DOORWAY_CONFIG;
     new_entry->emulation        = Q_EMUL_ANSI;
@@ -2024,6 +2555,8 @@ void create_phonebook() {
     q_phonebook.entry_count++;
 #endif /* Q_NO_SERIAL */
 
+    phonebook_list_changed();
+
     /*
      * Now save it.  Note that we don't care if anyone else might have
      * modified it.
@@ -2176,7 +2709,9 @@ void do_dialer() {
      * Save phonebook - in case someone JUST added an entry and will be
      * dialing.
      */
-    if (phonebook_is_mine(Q_FALSE) == Q_TRUE) {
+    if ((phonebook_dirty == Q_TRUE) &&
+        (phonebook_is_mine(Q_FALSE) == Q_TRUE)
+    ) {
         save_phonebook(Q_FALSE);
     }
 
@@ -2245,32 +2780,122 @@ void do_dialer() {
          * We just dialed out, don't quicklearn again
          */
         q_current_dial_entry->quicklearn = Q_FALSE;
+        save_phonebook_entry(q_current_dial_entry);
     }
 
     /*
      * Save phonebook
      */
-    if (phonebook_is_mine(Q_FALSE) == Q_TRUE) {
+    if ((phonebook_dirty == Q_TRUE) &&
+        (phonebook_is_mine(Q_FALSE) == Q_TRUE)
+    ) {
         save_phonebook(Q_FALSE);
     }
 }
 
 /**
- * Sort the phonebook.
+ * Compare two phonebook entries for sorting.
  *
- * @param method one of the available sorting methods
+ * @param a the first entry
+ * @param b the second entry
+ * @param method one of the available sorting methods except
+ * SORT_METHOD_REVERSE
+ * @return less than zero if a sorts before b, zero if they are equal, and
+ * greater than zero if a sorts after b
  */
-static void sort_phonebook(const SORT_METHOD method) {
+static int compare_phonebook_entries(const struct q_phone_struct * a,
+                                     const struct q_phone_struct * b,
+                                     const SORT_METHOD method) {
+
+    switch (method) {
+    case SORT_METHOD_NAME_ASC:
+        return wcscmp(a->name, b->name);
+    case SORT_METHOD_ADDRESS_ASC:
+        return strcasecmp(a->address, b->address);
+    case SORT_METHOD_TOTAL_CALLS_DESC:
+        if (a->times_on == b->times_on) {
+            return 0;
+        }
+        return (a->times_on > b->times_on ? -1 : 1);
+    case SORT_METHOD_METHOD_ASC:
+        return (int) a->method - (int) b->method;
+    case SORT_METHOD_LAST_CALL_DESC:
+        if (a->last_call == b->last_call) {
+            return 0;
+        }
+        return (a->last_call > b->last_call ? -1 : 1);
+    case SORT_METHOD_REVERSE:
+    case SORT_METHOD_MAX:
+        break;
+    }
+    return 0;
+}
+
+/**
+ * Merge sort a list of phonebook entries linked by their next pointers.
+ * The sort is stable, so entries that compare equal keep their order.
+ * The prev pointers are not touched.
+ *
+ * @param list the first entry in the list
+ * @param method one of the available sorting methods except
+ * SORT_METHOD_REVERSE
+ * @return the first entry in the sorted list
+ */
+static struct q_phone_struct * merge_sort_phonebook(
+    struct q_phone_struct * list, const SORT_METHOD method) {
+
+    struct q_phone_struct * slow;
+    struct q_phone_struct * fast;
+    struct q_phone_struct * second;
+    struct q_phone_struct * head = NULL;
+    struct q_phone_struct ** tail = &head;
+
+    if ((list == NULL) || (list->next == NULL)) {
+        return list;
+    }
+
     /*
-     * This is a hideously inefficient method.  Basically I just keep looping
-     * through the phonebook swapping adjacent entries until the whole thing
-     * is sorted.
+     * Split in half
      */
+    slow = list;
+    fast = list->next;
+    while ((fast != NULL) && (fast->next != NULL)) {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    second = slow->next;
+    slow->next = NULL;
+
+    list = merge_sort_phonebook(list, method);
+    second = merge_sort_phonebook(second, method);
+
+    /*
+     * Merge, taking from the first half on ties
+     */
+    while ((list != NULL) && (second != NULL)) {
+        if (compare_phonebook_entries(second, list, method) < 0) {
+            *tail = second;
+            second = second->next;
+        } else {
+            *tail = list;
+            list = list->next;
+        }
+        tail = &((*tail)->next);
+    }
+    *tail = (list != NULL ? list : second);
+    return head;
+}
 
+/**
+ * Sort the phonebook.  Every method except SORT_METHOD_REVERSE is
+ * remembered, and entries added or revised later are kept in that order.
+ *
+ * @param method one of the available sorting methods
+ */
+static void sort_phonebook(const SORT_METHOD method) {
     struct q_phone_struct * current_entry;
     struct q_phone_struct * swap;
     struct q_phone_struct * tail;
-    Q_BOOL sorted = Q_FALSE;
 
     if (q_phonebook.entries == NULL) {
         return;
@@ -2296,94 +2921,31 @@ static void sort_phonebook(const SORT_METHOD method) {
         }
 
         /*
-         * Point back to the top
+         * Point back to the top.  The entries are no longer in a sorted
+         * order.
          */
         q_phonebook.entries = tail;
         q_phonebook.selected_entry = q_phonebook.entries;
         phonebook_page = 0;
         phonebook_entry_i = 0;
+        phonebook_sort_method = SORT_METHOD_MAX;
+        phonebook_list_changed();
         return;
     }
 
-    while (sorted == Q_FALSE) {
-
-        sorted = Q_TRUE;
-
-        for (current_entry = q_phonebook.entries; current_entry->next != NULL;
-             current_entry = current_entry->next) {
-
-            if (method == SORT_METHOD_NAME_ASC) {
-                if (wcscmp(current_entry->name,
-                        current_entry->next->name) <= 0) {
-                    continue;
-                }
-
-            } else if (method == SORT_METHOD_ADDRESS_ASC) {
-                if (strcasecmp(current_entry->address,
-                        current_entry->next->address) <= 0) {
-                    continue;
-                }
-
-            } else if (method == SORT_METHOD_TOTAL_CALLS_DESC) {
-                if (current_entry->times_on >= current_entry->next->times_on) {
-                    continue;
-                }
-
-            } else if (method == SORT_METHOD_METHOD_ASC) {
-                if (current_entry->method <= current_entry->next->method) {
-                    continue;
-                }
-
-            } else if (method == SORT_METHOD_LAST_CALL_DESC) {
-                if (current_entry->last_call >= current_entry->next->last_call) {
-                    continue;
-                }
-
-            }
-
-            /*
-             * Swap current_entry and current_entry->next
-             */
-            if (current_entry == q_phonebook.entries) {
-                /*
-                 * Swapping the head
-                 */
-                q_phonebook.entries = current_entry->next;
-                swap = current_entry->next->next;
-
-                q_phonebook.entries->next = current_entry;
-                q_phonebook.entries->prev = NULL;
-                current_entry->prev = current_entry->next;
-                current_entry->next = swap;
-                if (swap != NULL) {
-                    swap->prev = current_entry;
-                }
-            } else {
-                /*
-                 * Swapping in the middle
-                 */
-                swap = current_entry->next->next;
-
-                current_entry->prev->next = current_entry->next;
-                current_entry->next->prev = current_entry->prev;
-                current_entry->prev = current_entry->next;
-                current_entry->next->next = current_entry;
-                current_entry->next = swap;
-                if (swap != NULL) {
-                    swap->prev = current_entry;
-                }
-            }
-
-            sorted = Q_FALSE;
+    q_phonebook.entries = merge_sort_phonebook(q_phonebook.entries, method);
 
-            /*
-             * Search again from the top
-             */
-            break;
-
-        } /* for (...) */
-
-    } /* while (sorted == Q_FALSE) */
+    /*
+     * Relink prev
+     */
+    tail = NULL;
+    for (current_entry = q_phonebook.entries; current_entry != NULL;
+         current_entry = current_entry->next) {
+        current_entry->prev = tail;
+        tail = current_entry;
+    }
+    phonebook_sort_method = method;
+    phonebook_list_changed();
 
     /*
      * Point back to the top
@@ -2394,89 +2956,197 @@ static void sort_phonebook(const SORT_METHOD method) {
 }
 
 /**
- * See if a phonebook entry matches the search string.  Note that the search
- * string is destructively switched to lowercase.
+ * See if an entry still sorts between its neighbors in the remembered sort
+ * order.
  *
- * @param search_string text to search for
- * @param entry the entry to search in
- * @return true if a match is found
+ * @param entry the entry to check
+ * @return true if the entry does not need to move
+ */
+static Q_BOOL phonebook_entry_in_order(const struct q_phone_struct * entry) {
+    if ((entry->prev != NULL) &&
+        (compare_phonebook_entries(entry->prev, entry,
+                phonebook_sort_method) > 0)
+    ) {
+        return Q_FALSE;
+    }
+    if ((entry->next != NULL) &&
+        (compare_phonebook_entries(entry, entry->next,
+                phonebook_sort_method) > 0)
+    ) {
+        return Q_FALSE;
+    }
+    return Q_TRUE;
+}
+
+/**
+ * Move one entry to its place in the remembered sort order, after any
+ * entries it compares equal to.  Does nothing if no order is remembered or
+ * the entry is already in order, for example when an edit was cancelled or
+ * did not touch the sort key.
+ *
+ * @param entry the entry that was added or revised
  */
-static Q_BOOL match_phonebook_entry(wchar_t * search_string,
-                                    const struct q_phone_struct * entry) {
+static void keep_phonebook_sorted(struct q_phone_struct * entry) {
+    struct q_phone_struct * current_entry;
+    struct q_phone_struct * tail;
 
-    wchar_t * field_string;
-    unsigned int i, j;
+    if ((phonebook_sort_method == SORT_METHOD_MAX) || (entry == NULL)) {
+        return;
+    }
+    if (phonebook_entry_in_order(entry) == Q_TRUE) {
+        return;
+    }
 
     /*
-     * Force the search string to lowercase
+     * Unlink
      */
-    for (i = 0; i < wcslen(search_string); i++) {
-        search_string[i] = towlower(search_string[i]);
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        q_phonebook.entries = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
     }
 
     /*
-     * Check name
+     * Find the first entry that sorts after this one
      */
-    if (wcslen(entry->name) > 0) {
-        field_string = Xwcsdup(entry->name, __FILE__, __LINE__);
-        for (i = 0; i < wcslen(field_string); i++) {
-            field_string[i] = towlower(field_string[i]);
-        }
-
-        if (wcsstr(field_string, search_string) != NULL) {
-            Xfree(field_string, __FILE__, __LINE__);
-            return Q_TRUE;
+    tail = NULL;
+    for (current_entry = q_phonebook.entries; current_entry != NULL;
+         current_entry = current_entry->next) {
+        if (compare_phonebook_entries(entry, current_entry,
+                phonebook_sort_method) < 0) {
+            break;
         }
-        Xfree(field_string, __FILE__, __LINE__);
+        tail = current_entry;
     }
 
     /*
-     * Check address
+     * Link back in after tail
      */
-    if (strlen(entry->address) > 0) {
-        field_string = Xstring_to_wcsdup(entry->address, __FILE__, __LINE__);
-        for (i = 0; i < wcslen(field_string); i++) {
-            field_string[i] = towlower(field_string[i]);
+    entry->prev = tail;
+    entry->next = current_entry;
+    if (tail != NULL) {
+        tail->next = entry;
+    } else {
+        q_phonebook.entries = entry;
+    }
+    if (current_entry != NULL) {
+        current_entry->prev = entry;
+    }
+    phonebook_list_changed();
+}
+
+/**
+ * Append a lowercased copy of a multibyte string to a search text buffer.
+ *
+ * @param text the search text, with room for the string
+ * @param string the string to copy
+ * @param max the space left in text
+ * @return the number of wide characters written
+ */
+static size_t append_search_text(wchar_t * text, const char * string,
+                                 const size_t max) {
+    size_t n;
+    size_t i;
+
+    n = mbstowcs(text, string, max);
+    if (n == (size_t) -1) {
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        text[i] = towlower(text[i]);
+    }
+    return n;
+}
+
+/**
+ * Build the search text of an entry: the name, address, script filename,
+ * and notes, lowercased and separated by newlines.  Notes come last so
+ * that match_phonebook_entry() can tell when only the notes matched.
+ *
+ * @param entry the phonebook entry
+ */
+static void build_search_text(struct q_phone_struct * entry) {
+    wchar_t * text;
+    size_t text_max;
+    size_t n;
+    size_t i;
+    int j;
+
+    text_max = wcslen(entry->name) + strlen(entry->address) +
+        strlen(entry->script_filename) + 4;
+    if (entry->notes != NULL) {
+        for (j = 0; entry->notes[j] != NULL; j++) {
+            text_max += wcslen(entry->notes[j]) + 1;
         }
+    }
+    text = (wchar_t *) Xmalloc(sizeof(wchar_t) * text_max, __FILE__,
+                               __LINE__);
 
-        if (wcsstr(field_string, search_string) != NULL) {
-            Xfree(field_string, __FILE__, __LINE__);
-            return Q_TRUE;
+    for (n = 0; entry->name[n] != 0; n++) {
+        text[n] = towlower(entry->name[n]);
+    }
+    text[n++] = '\n';
+    n += append_search_text(text + n, entry->address, text_max - n);
+    text[n++] = '\n';
+    n += append_search_text(text + n, entry->script_filename, text_max - n);
+    text[n++] = '\n';
+    entry->search_notes_i = n;
+    if (entry->notes != NULL) {
+        for (j = 0; entry->notes[j] != NULL; j++) {
+            for (i = 0; entry->notes[j][i] != 0; i++) {
+                text[n++] = towlower(entry->notes[j][i]);
+            }
+            text[n++] = '\n';
         }
-        Xfree(field_string, __FILE__, __LINE__);
     }
+    text[n] = 0;
+    entry->search_text = text;
+}
 
-    /*
-     * Last of all, check the notes
-     */
-    if (entry->notes == NULL) {
-        /*
-         * Can't match anymore without notes
-         */
-        return Q_FALSE;
+/**
+ * Lowercase a search string for match_phonebook_entry().
+ *
+ * @param search_string text to search for, changed in place
+ */
+static void lowercase_search_string(wchar_t * search_string) {
+    for (; *search_string != 0; search_string++) {
+        *search_string = towlower(*search_string);
     }
+}
 
-    /*
-     * Notes is a list of strings
-     */
-    for (j = 0; entry->notes[j] != NULL; j++) {
-        field_string = Xwcsdup(entry->notes[j], __FILE__, __LINE__);
-        for (i = 0; i < wcslen(field_string); i++) {
-            field_string[i] = towlower(field_string[i]);
-        }
+/**
+ * See if a phonebook entry matches the search string.  The entry's search
+ * text is built on first use and kept until the entry changes, so repeated
+ * searches only do one wcsstr() per entry.
+ *
+ * @param search_string text to search for, already lowercased by
+ * lowercase_search_string()
+ * @param entry the entry to search in
+ * @return true if a match is found
+ */
+static Q_BOOL match_phonebook_entry(const wchar_t * search_string,
+                                    struct q_phone_struct * entry) {
 
-        if (wcsstr(field_string, search_string) != NULL) {
-            Xfree(field_string, __FILE__, __LINE__);
-            found_note_flag = Q_TRUE;
-            return Q_TRUE;
-        }
-        Xfree(field_string, __FILE__, __LINE__);
+    wchar_t * match;
+
+    if (entry->search_text == NULL) {
+        build_search_text(entry);
     }
 
-    /*
-     * Nothing matched
-     */
-    return Q_FALSE;
+    match = wcsstr(entry->search_text, search_string);
+    if (match == NULL) {
+        /*
+         * Nothing matched
+         */
+        return Q_FALSE;
+    }
+    if ((size_t) (match - entry->search_text) >= entry->search_notes_i) {
+        found_note_flag = Q_TRUE;
+    }
+    return Q_TRUE;
 }
 
 /**
@@ -2488,8 +3158,8 @@ static void tag_multiple(const char * tag_string) {
     int i;
     int current_entry_i;
     char ** search_tokens;
-    char * search_string;
-    wchar_t * wcs_search_string;
+    wchar_t ** wcs_search_strings;
+    int search_tokens_n;
 
     struct q_phone_struct * current_entry;
     if (q_phonebook.entries == NULL) {
@@ -2497,32 +3167,43 @@ static void tag_multiple(const char * tag_string) {
     }
     search_tokens = tokenize_command(tag_string);
 
+    /*
+     * Convert the text searches once rather than for every entry
+     */
+    for (search_tokens_n = 0; search_tokens[search_tokens_n] != NULL;
+         search_tokens_n++);
+    wcs_search_strings =
+        (wchar_t **) Xmalloc(sizeof(wchar_t *) * (search_tokens_n + 1),
+                             __FILE__, __LINE__);
+    for (i = 0; i < search_tokens_n; i++) {
+        wcs_search_strings[i] = NULL;
+        if (tolower(search_tokens[i][0]) == 't') {
+            wcs_search_strings[i] = Xstring_to_wcsdup(&search_tokens[i][1],
+                                                      __FILE__, __LINE__);
+            lowercase_search_string(wcs_search_strings[i]);
+        }
+    }
+
     current_entry_i = 0;
     for (current_entry = q_phonebook.entries; current_entry != NULL;
          current_entry = current_entry->next) {
         current_entry_i++;
 
-        for (i = 0; search_tokens[i] != NULL; i++) {
+        for (i = 0; i < search_tokens_n; i++) {
 
-            if (tolower(search_tokens[i][0]) == 't') {
+            if (current_entry->tagged == Q_TRUE) {
+                break;
+            }
 
+            if (wcs_search_strings[i] != NULL) {
                 /*
                  * Text search
                  */
-                search_string = &search_tokens[i][1];
-                wcs_search_string =
-                    Xstring_to_wcsdup(search_string, __FILE__, __LINE__);
-
-                if (match_phonebook_entry(wcs_search_string, current_entry) ==
-                    Q_TRUE) {
+                if (match_phonebook_entry(wcs_search_strings[i],
+                        current_entry) == Q_TRUE) {
                     current_entry->tagged = Q_TRUE;
                     q_phonebook.tagged++;
                 }
-                /*
-                 * No leak
-                 */
-                Xfree(wcs_search_string, __FILE__, __LINE__);
-
             }
 
             if (q_isdigit(search_tokens[i][0])) {
@@ -2530,16 +3211,24 @@ static void tag_multiple(const char * tag_string) {
                  * Entry number selection
                  */
                 if (atoi(search_tokens[i]) == current_entry_i) {
-                    if (current_entry->tagged == Q_FALSE) {
-                        current_entry->tagged = Q_TRUE;
-                        q_phonebook.tagged++;
-                    }
+                    current_entry->tagged = Q_TRUE;
+                    q_phonebook.tagged++;
                 }
             }
-        } /* for (i = 0; search_tokens[i] != NULL; i++) */
+        } /* for (i = 0; i < search_tokens_n; i++) */
 
     } /* for (...) */
 
+    /*
+     * No leak
+     */
+    for (i = 0; i < search_tokens_n; i++) {
+        if (wcs_search_strings[i] != NULL) {
+            Xfree(wcs_search_strings[i], __FILE__, __LINE__);
+        }
+    }
+    Xfree(wcs_search_strings, __FILE__, __LINE__);
+
     /*
      * Free up the array of token pointers
      */
@@ -2644,6 +3333,8 @@ static void edit_attached_note(struct q_phone_struct * entry) {
             Xwcsdup(line_wchar, __FILE__, __LINE__);
         entry->notes[notes_length] = NULL;
     }
+    clear_search_text(entry);
+    phonebook_dirty = Q_TRUE;
 
     fclose(file);
     unlink(filename);
@@ -2691,8 +3382,10 @@ static void delete_phonebook_entry(struct q_phone_struct * entry) {
     Xfree(entry->translate_8bit_filename, __FILE__, __LINE__);
     Xfree(entry->translate_unicode_filename, __FILE__, __LINE__);
     Xfree(entry->keybindings_filename, __FILE__, __LINE__);
+    clear_search_text(entry);
     Xfree(entry, __FILE__, __LINE__);
     q_phonebook.entry_count--;
+    phonebook_list_changed();
 }
 
 /**
@@ -3650,11 +4343,8 @@ void phonebook_refresh() {
     /*
      * Determine the first entry that should be visible on this page.
      */
-    entry = q_phonebook.entries;
-    for (i = 0; i < (phonebook_entry_i / visible_entries_n) * visible_entries_n;
-         i++) {
-        entry = entry->next;
-    }
+    entry = phonebook_entry_at((phonebook_entry_i / visible_entries_n) *
+                               visible_entries_n);
 
     /*
      * Now draw the phonebook entries.
@@ -7012,6 +7702,8 @@ static void edit_phone_entry_form(struct q_phone_struct * entry) {
 #endif
             entry->use_default_toggles = use_default_toggles;
             entry->toggles = toggles;
+            clear_search_text(entry);
+            phonebook_dirty = Q_TRUE;
 
             /*
              * Save settings -----------------------------------
@@ -7159,7 +7851,9 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
         /*
          * Save phonebook
          */
-        if (phonebook_is_mine(Q_FALSE) == Q_TRUE) {
+        if ((phonebook_dirty == Q_TRUE) &&
+            (phonebook_is_mine(Q_FALSE) == Q_TRUE)
+        ) {
             save_phonebook(Q_FALSE);
         }
         return;
@@ -7188,6 +7882,9 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
         entry->use_default_toggles = Q_TRUE;
         entry->toggles          = 0;
         entry->notes            = NULL;
+        entry->search_text      = NULL;
+        entry->file_position    = -1;
+        entry->journal_pending  = Q_FALSE;
         entry->last_call        = 0;
         entry->times_on         = 0;
         entry->tagged           = Q_FALSE;
@@ -7222,6 +7919,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
         }
         q_phonebook.selected_entry = entry;
         q_phonebook.entry_count++;
+        phonebook_list_changed();
 
         /*
          * Fall through ...
@@ -7240,6 +7938,10 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
         q_cursor_on();
         edit_phone_entry_form(q_phonebook.selected_entry);
         q_cursor_off();
+        if (phonebook_sort_method != SORT_METHOD_MAX) {
+            keep_phonebook_sorted(q_phonebook.selected_entry);
+            phonebook_normalize();
+        }
         break;
 
     case 'd':
@@ -7286,6 +7988,8 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
                 }
                 Xfree(entry->notes, __FILE__, __LINE__);
                 entry->notes = NULL;
+                clear_search_text(entry);
+                phonebook_dirty = Q_TRUE;
             }
             break;
         }
@@ -7330,6 +8034,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
         if (search_string == NULL) {
             break;
         }
+        lowercase_search_string(search_string);
         /*
          * Search for the first matching entry
          */
@@ -7390,6 +8095,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
             if (search_string == NULL) {
                 break;
             }
+            lowercase_search_string(search_string);
         }
 
         new_phonebook_entry_i = phonebook_entry_i;
@@ -7471,6 +8177,10 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
             entry->emulation = Q_EMUL_ANSI;
             entry->codepage = default_codepage(entry->emulation);
             entry->notes = NULL;
+            entry->search_text = NULL;
+            entry->position = -1;
+            entry->file_position = -1;
+            entry->journal_pending = Q_FALSE;
             entry->script_filename = "";
             entry->capture_filename = "";
             entry->translate_8bit_filename = "";
@@ -7512,7 +8222,10 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
         /*
          * Save a copy of this one
          */
-        if (phonebook_is_mine(Q_FALSE) == Q_TRUE) {
+        flush_phonebook_journal();
+        if ((phonebook_dirty == Q_TRUE) &&
+            (phonebook_is_mine(Q_FALSE) == Q_TRUE)
+        ) {
             save_phonebook(Q_FALSE);
         }
         phonebook_file_info = view_directory(q_home_directory, "*.txt");
@@ -7622,6 +8335,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
                 }
             }
         }
+        journal_phonebook_entry(q_phonebook.selected_entry);
         /*
          * Advance to the next entry
          */
@@ -7657,6 +8371,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
         if (pick_string != NULL) {
             tag_multiple(pick_string);
             Xfree(pick_string, __FILE__, __LINE__);
+            phonebook_dirty = Q_TRUE;
         }
         break;
 
@@ -7671,6 +8386,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
             }
         }
         q_phonebook.tagged = 0;
+        phonebook_dirty = Q_TRUE;
         break;
 
     case 'v':
@@ -7716,6 +8432,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
                     }
                 }
             }
+            journal_phonebook_entry(q_phonebook.selected_entry);
             /*
              * Advance to the next entry
              */
@@ -7767,6 +8484,8 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
                         }
                         Xfree(entry->notes, __FILE__, __LINE__);
                         entry->notes = NULL;
+                        clear_search_text(entry);
+                        phonebook_dirty = Q_TRUE;
                     }
                 }
 
@@ -7814,6 +8533,23 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
                 q_cursor_off();
             }
         }
+        if (phonebook_sort_method != SORT_METHOD_MAX) {
+            for (entry = q_phonebook.entries; entry != NULL;
+                 entry = entry->next) {
+                if (phonebook_entry_in_order(entry) == Q_FALSE) {
+                    break;
+                }
+            }
+        }
+        if ((phonebook_sort_method != SORT_METHOD_MAX) && (entry != NULL)) {
+            /*
+             * Put the revised entries back in order
+             */
+            entry = q_phonebook.selected_entry;
+            sort_phonebook(phonebook_sort_method);
+            q_phonebook.selected_entry = entry;
+            phonebook_normalize();
+        }
         break;
 
     case 0x15:
@@ -7862,12 +8598,9 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
              */
             break;
         }
-        entry = q_phonebook.selected_entry;
-        for (i = 0; (i < visible_entries_n) && (entry->prev != NULL); i++) {
-            entry = entry->prev;
-        }
-        q_phonebook.selected_entry = entry;
-        phonebook_normalize();
+        build_phonebook_index();
+        phonebook_select(q_phonebook.selected_entry->position -
+                         visible_entries_n);
         break;
 
     case Q_KEY_NPAGE:
@@ -7880,12 +8613,9 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
              */
             break;
         }
-        entry = q_phonebook.selected_entry;
-        for (i = 0; (i < visible_entries_n) && (entry->next != NULL); i++) {
-            entry = entry->next;
-        }
-        q_phonebook.selected_entry = entry;
-        phonebook_normalize();
+        build_phonebook_index();
+        phonebook_select(q_phonebook.selected_entry->position +
+                         visible_entries_n);
         break;
 
     case Q_KEY_HOME:
@@ -7913,12 +8643,8 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
              */
             break;
         }
-        entry = q_phonebook.selected_entry;
-        while (entry->next != NULL) {
-            entry = entry->next;
-        }
-        q_phonebook.selected_entry = entry;
-        phonebook_normalize();
+        build_phonebook_index();
+        phonebook_select(q_phonebook.entry_count - 1);
         break;
 
     case Q_KEY_ENTER:
@@ -7976,6 +8702,7 @@ void phonebook_keyboard_handler(const int keystroke, const int flags) {
                  * Automatically QuickLearn on new scripts
                  */
                 q_phonebook.selected_entry->quicklearn = Q_TRUE;
+                save_phonebook_entry(q_phonebook.selected_entry);
             }
         }
 
@@ -70,6 +70,8 @@ struct q_phone_struct {
     wchar_t * username;
     wchar_t * password;
     wchar_t ** notes;
+    wchar_t * search_text;      /* Lowercase name, address, etc. */
+    size_t search_notes_i;      /* Where the notes start in search_text */
     char * script_filename;
     char * capture_filename;
     char * translate_8bit_filename;
@@ -97,6 +99,10 @@ struct q_phone_struct {
 
     Q_BOOL quicklearn;
 
+    int position;               /* Index in the list, see phonebook_entry_at() */
+    int file_position;          /* Index in the file, or -1 if not saved */
+    Q_BOOL journal_pending;     /* Needs a journal record, see
+                                 * flush_phonebook_journal() */
     struct q_phone_struct * next;
     struct q_phone_struct * prev;
 };
@@ -215,6 +221,27 @@ extern void set_dial_out_toggles(int toggles);
  */
 extern void phonebook_normalize();
 
+/**
+ * Get a phonebook entry by its position in the list.
+ *
+ * @param i the position, starting at 0
+ * @return the entry, or NULL if i is past either end of the phonebook
+ */
+extern struct q_phone_struct * phonebook_entry_at(const int i);
+
+/**
+ * Record an entry's tag, quicklearn flag, and dial statistics in the
+ * phonebook journal.
+ *
+ * @param entry the phonebook entry that changed
+ */
+extern void save_phonebook_entry(struct q_phone_struct * entry);
+
+/**
+ * Write the journal records for tag changes made in the phonebook screen.
+ */
+extern void flush_phonebook_journal();
+
 /**
  * This is the top-level call to "dial" the selected phonebook entry.  It
  * prompts for password if needed, sets up capture, quicklearn, etc, and
@@ -72,6 +72,9 @@ extern "C" {
 #include "script.h"
 #include "help.h"
 #include "netclient.h"
+#include "session.h"
+#include "replay.h"
+#include "batch.h"
 #include "getopt.h"
 
 /* Set this to a not-NULL value to enable debug log. */
@@ -245,6 +248,15 @@ static int dial_phonebook_entry_n;
 static unsigned char * play_music_string = NULL;
 static Q_BOOL play_music_exit = Q_FALSE;
 
+/* For the --replay and --replay-speed arguments */
+static char * replay_filename = NULL;
+static int replay_speed_arg = 1;
+
+/* For the --render and --render-jobs arguments */
+static Q_BOOL render_mode = Q_FALSE;
+static Q_CAPTURE_TYPE render_type = Q_CAPTURE_TYPE_NORMAL;
+static int render_jobs_arg = 0;
+
 /**
  * The geometry as requested by the command line arguments.
  */
@@ -330,6 +342,10 @@ static struct option q_getopt_long_options[] = {
     {"username",            1,      0,      0},
     {"play",                1,      0,      0},
     {"play-exit",           0,      0,      0},
+    {"replay",              1,      0,      0},
+    {"replay-speed",        1,      0,      0},
+    {"render",              1,      0,      0},
+    {"render-jobs",         1,      0,      0},
     {"version",             0,      0,      0},
     {"xterm",               0,      0,      0},
     {"exit-on-completion",  0,      0,      0},
@@ -421,6 +437,11 @@ static void handle_sigchld(int sig) {
              */
             q_child_exited = Q_TRUE;
             DLOG(("SIGCHLD: CONNECTION CLOSED\n"));
+        } else {
+            /*
+             * This might be the connection for a background session.
+             */
+            session_child_exited(pid);
         }
         if (pid == q_running_script.script_pid) {
             /*
@@ -1057,6 +1078,12 @@ static char * usage_string() {
 "                                  status line.\n"
 "      --play MUSIC                Play MUSIC as ANSI Music\n"
 "      --play-exit                 Immediately exit after playing MUSIC\n"
+"      --replay FILENAME           Play back a timed capture in the console\n"
+"      --replay-speed N            Start the replay at N times real speed\n"
+"      --render { text | html }    Render the FILEs given on the command line\n"
+"                                  to FILE.txt or FILE.html and exit\n"
+"      --render-jobs N             Render N files at once (default: one per\n"
+"                                  CPU)\n"
 "      --geometry COLSxROWS        Request text window size COLS x ROWS\n"
 "      --xterm                     Enable X11 terminal mode\n"
 "      --version                   Display program version\n"
@@ -1311,6 +1338,33 @@ static void process_command_line_option(const char * option,
         play_music_exit = Q_TRUE;
     }
 
+    if (strcmp(option, "replay") == 0) {
+        replay_filename = (char *) value;
+    }
+
+    if (strcmp(option, "replay-speed") == 0) {
+        replay_speed_arg = atoi(value);
+    }
+
+    if (strcmp(option, "render") == 0) {
+        render_mode = Q_TRUE;
+        if (strcasecmp(value, "html") == 0) {
+            render_type = Q_CAPTURE_TYPE_HTML;
+        } else if (strcasecmp(value, "text") == 0) {
+            render_type = Q_CAPTURE_TYPE_NORMAL;
+        } else {
+            fprintf(stderr, _("Error: --render must be \"text\" or "
+                    "\"html\", not \"%s\".\n\n"), value);
+            fprintf(stderr, "%s", usage_string());
+            q_exitrc = EXIT_ERROR_COMMANDLINE;
+            q_program_state = Q_STATE_EXIT;
+        }
+    }
+
+    if (strcmp(option, "render-jobs") == 0) {
+        render_jobs_arg = atoi(value);
+    }
+
     if (strcmp(option, "connect") == 0) {
         initial_call.address = (char *)value;
         memset(value_wchar, 0, sizeof(value_wchar));
@@ -1583,6 +1637,7 @@ static void cleanup_connection() {
         if (q_current_dial_entry != NULL) {
             q_current_dial_entry->times_on++;
             time(&q_current_dial_entry->last_call);
+            save_phonebook_entry(q_current_dial_entry);
         }
     }
 
@@ -1914,11 +1969,13 @@ static void process_incoming_data() {
                 cleanup_connection();
 #endif /* Q_NO_SERIAL */
 
-                /* Kill quicklearn script */
-                stop_quicklearn();
+                if (session_in_background() == Q_FALSE) {
+                    /* Kill quicklearn script */
+                    stop_quicklearn();
 
-                /* Kill running script */
-                script_stop();
+                    /* Kill running script */
+                    script_stop();
+                }
 
                 /* Compute time */
                 /* time_string needs to be hours/minutes/seconds CONNECTED */
@@ -2398,6 +2455,160 @@ static Q_BOOL child_is_dead() {
 
 }
 
+/**
+ * The qodem.c connection state that is saved with a session.
+ */
+struct qodem_session {
+    struct q_status_struct status;
+    char * child_ttyname;
+    int child_tty_fd;
+    pid_t child_pid;
+#ifdef Q_PDCURSES_WIN32
+    HANDLE child_stdin;
+    HANDLE child_stdout;
+    HANDLE child_process;
+    HANDLE child_thread;
+#else
+    Q_BOOL child_exited;
+#endif
+    unsigned char buffer_raw[Q_BUFFER_SIZE];
+    int buffer_raw_n;
+    unsigned char transfer_buffer_raw[Q_BUFFER_SIZE];
+    unsigned int transfer_buffer_raw_n;
+    char * buffered_write_buffer;
+    int buffered_write_buffer_i;
+    int buffered_write_buffer_n;
+    time_t data_time;
+    time_t data_sent_time;
+    void (*close_function)();
+};
+
+/**
+ * Save or restore the connection state: the child process or socket, the
+ * raw data buffers, and q_status.  DETACH leaves an offline q_status that
+ * keeps the current settings but owns no files or strings.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t qodem_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct qodem_session * saved = (struct qodem_session *) buffer;
+
+    switch (op) {
+    case Q_SESSION_SAVE:
+    case Q_SESSION_RESTORE:
+        Q_SESSION_COPY(op, saved->status, q_status);
+        Q_SESSION_COPY(op, saved->child_ttyname, q_child_ttyname);
+        Q_SESSION_COPY(op, saved->child_tty_fd, q_child_tty_fd);
+        Q_SESSION_COPY(op, saved->child_pid, q_child_pid);
+#ifdef Q_PDCURSES_WIN32
+        Q_SESSION_COPY(op, saved->child_stdin, q_child_stdin);
+        Q_SESSION_COPY(op, saved->child_stdout, q_child_stdout);
+        Q_SESSION_COPY(op, saved->child_process, q_child_process);
+        Q_SESSION_COPY(op, saved->child_thread, q_child_thread);
+#else
+        Q_SESSION_COPY(op, saved->child_exited, q_child_exited);
+#endif
+        Q_SESSION_COPY(op, saved->buffer_raw, q_buffer_raw);
+        Q_SESSION_COPY(op, saved->buffer_raw_n, q_buffer_raw_n);
+        Q_SESSION_COPY(op, saved->transfer_buffer_raw, q_transfer_buffer_raw);
+        Q_SESSION_COPY(op, saved->transfer_buffer_raw_n,
+                       q_transfer_buffer_raw_n);
+        Q_SESSION_COPY(op, saved->buffered_write_buffer,
+                       buffered_write_buffer);
+        Q_SESSION_COPY(op, saved->buffered_write_buffer_i,
+                       buffered_write_buffer_i);
+        Q_SESSION_COPY(op, saved->buffered_write_buffer_n,
+                       buffered_write_buffer_n);
+        Q_SESSION_COPY(op, saved->data_time, data_time);
+        Q_SESSION_COPY(op, saved->data_sent_time, q_data_sent_time);
+        Q_SESSION_COPY(op, saved->close_function, close_function);
+        break;
+    case Q_SESSION_FREE:
+        /*
+         * The caller has already stopped capture and logging.
+         */
+        if (q_child_ttyname != NULL) {
+            Xfree(q_child_ttyname, __FILE__, __LINE__);
+        }
+        if (buffered_write_buffer != NULL) {
+            Xfree(buffered_write_buffer, __FILE__, __LINE__);
+        }
+        if (q_status.current_username != NULL) {
+            Xfree(q_status.current_username, __FILE__, __LINE__);
+        }
+        if (q_status.current_password != NULL) {
+            Xfree(q_status.current_password, __FILE__, __LINE__);
+        }
+        if (q_status.remote_address != NULL) {
+            Xfree(q_status.remote_address, __FILE__, __LINE__);
+        }
+        if (q_status.remote_port != NULL) {
+            Xfree(q_status.remote_port, __FILE__, __LINE__);
+        }
+        if (q_status.remote_phonebook_name != NULL) {
+            Xfree(q_status.remote_phonebook_name, __FILE__, __LINE__);
+        }
+        /* Fall through... */
+    case Q_SESSION_DETACH:
+        q_child_ttyname = NULL;
+        q_child_tty_fd = -1;
+        q_child_pid = -1;
+#ifdef Q_PDCURSES_WIN32
+        q_child_stdin = NULL;
+        q_child_stdout = NULL;
+        q_child_process = NULL;
+        q_child_thread = NULL;
+#else
+        q_child_exited = Q_FALSE;
+#endif
+        q_buffer_raw_n = 0;
+        q_transfer_buffer_raw_n = 0;
+        buffered_write_buffer = NULL;
+        buffered_write_buffer_i = 0;
+        buffered_write_buffer_n = 0;
+        close_function = NULL;
+
+        q_status.online                 = Q_FALSE;
+        q_status.hanging_up             = Q_FALSE;
+        q_status.serial_open            = Q_FALSE;
+        q_status.split_screen           = Q_FALSE;
+        q_status.capture                = Q_FALSE;
+        q_status.capture_file           = NULL;
+        q_status.logging                = Q_FALSE;
+        q_status.logging_file           = NULL;
+        q_status.quicklearn             = Q_FALSE;
+        q_status.scrollback_lines       = 0;
+        q_status.cursor_x               = 0;
+        q_status.cursor_y               = 0;
+        q_status.current_username       = NULL;
+        q_status.current_password       = NULL;
+        q_status.remote_address         = NULL;
+        q_status.remote_port            = NULL;
+        q_status.remote_phonebook_name  = NULL;
+        break;
+    case Q_SESSION_SIZE:
+        break;
+    }
+    return sizeof(struct qodem_session);
+}
+
+/**
+ * Read and dispatch data for a background session.  session.c has swapped
+ * the session into the live globals and set q_program_state to
+ * Q_STATE_CONSOLE before calling this.
+ */
+static void process_background_data() {
+    if (child_is_dead() == Q_TRUE) {
+        qlog(_("Child process has exited, closing...\n"));
+        close_connection();
+        cleanup_connection();
+        return;
+    }
+    process_incoming_data();
+}
+
 /**
  * Check various data sources and sinks for data, and dispatch to appropriate
  * handlers.
@@ -2648,6 +2859,12 @@ static void data_handler() {
 #endif
     }
 
+    /* Add the background sessions */
+    session_add_background_fds(&readfds, &select_fd_max);
+
+    /* Add the other host mode callers */
+    host_add_fds(&readfds, &select_fd_max);
+
     /* select() needs 1 + MAX */
     select_fd_max++;
 
@@ -2801,6 +3018,22 @@ static void data_handler() {
     DLOG(("q_program_state = %d select() returned %d\n", q_program_state, rc));
     */
 
+    /*
+     * Flush the capture file about once a second, busy or idle
+     */
+    if ((q_status.capture == Q_TRUE) &&
+        (q_status.capture_flush_time < time(NULL))
+    ) {
+        flush_capture();
+    }
+
+    /*
+     * Feed a running capture replay
+     */
+    if (replay_active() == Q_TRUE) {
+        replay_process();
+    }
+
     switch (rc) {
 
     case -1:
@@ -2829,14 +3062,6 @@ static void data_handler() {
          * during this idle period.
          */
 
-        /* Flush capture file if necessary */
-        if (q_status.capture == Q_TRUE) {
-            if (q_status.capture_flush_time < time(NULL)) {
-                fflush(q_status.capture_file);
-                q_status.capture_flush_time = time(NULL);
-            }
-        }
-
 #ifndef Q_NO_SERIAL
 
         /*
@@ -3058,6 +3283,20 @@ static void data_handler() {
         break;
     }
 
+    /*
+     * Let the background sessions catch up on their data too.
+     */
+    if (rc >= 0) {
+        session_process_background(&readfds, process_background_data);
+    }
+
+    /*
+     * Host mode callers that are not on the screen.
+     */
+    if (rc >= 0) {
+        host_process_callers(&readfds, qodem_read);
+    }
+
 }
 
 /**
@@ -3516,7 +3755,7 @@ int qodem_main(int argc, char * const argv[]) {
          * --help or --version or somesting similar was on the command
          * line.  Bail out now.
          */
-        exit(0);
+        exit(q_exitrc);
     }
 
     /*
@@ -3540,17 +3779,51 @@ int qodem_main(int argc, char * const argv[]) {
     }
 
 #if !defined(Q_PDCURSES) && !defined(Q_PDCURSES_WIN32)
-    /*
-     * Xterm: send the private sequence to select metaSendsEscape and
-     * bracketed paste mode.
-     */
-    fprintf(stdout, "\033[?1036;2004h");
-    fflush(stdout);
+    if (render_mode == Q_FALSE) {
+        /*
+         * Xterm: send the private sequence to select metaSendsEscape and
+         * bracketed paste mode.
+         */
+        fprintf(stdout, "\033[?1036;2004h");
+        fflush(stdout);
+    }
 #endif
 
     /* Load the options. */
     load_options();
 
+    if (render_mode == Q_TRUE) {
+        /*
+         * --render: convert the files on the command line and exit,
+         * without ever starting curses.
+         */
+        WIDTH = q_cols_arg;
+        HEIGHT = q_rows_arg;
+        STATUS_HEIGHT = 0;
+        q_setup_colors();
+        q_current_color = scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
+        q_status.xterm_mode = Q_FALSE;
+        q_capfile_option = NULL;
+        resolve_command_line_options();
+        initialize_translate_tables();
+        if (q_xl8file != NULL) {
+            use_translate_table_8bit(q_xl8file);
+        }
+        if (q_xlufile != NULL) {
+            use_translate_table_unicode(q_xlufile);
+        }
+        q_program_state = Q_STATE_CONSOLE;
+
+        if ((optind < argc) && (strcmp(argv[optind], "--") == 0)) {
+            optind++;
+        }
+        if (batch_render(argv + optind, argc - optind, render_type,
+                         render_jobs_arg) != 0) {
+            exit(EXIT_ERROR_RENDER);
+        }
+        exit(EXIT_OK);
+    }
+
     /* Initialize curses. */
     screen_setup(q_rows_arg, q_cols_arg);
 
@@ -3594,11 +3867,6 @@ int qodem_main(int argc, char * const argv[]) {
     load_modem_config();
 #endif
 
-    /*
-     * Setup the help system
-     */
-    setup_help();
-
     /*
      * See if the user wants automatic capture/logging enabled.
      */
@@ -3716,6 +3984,10 @@ no_initial_call:
         Xfree(play_music_string, __FILE__, __LINE__);
         play_music_string = NULL;
         if (play_music_exit == Q_TRUE) {
+            /*
+             * Let the tune finish before exiting.
+             */
+            music_wait();
             q_program_state = Q_STATE_EXIT;
         }
     }
@@ -3779,14 +4051,12 @@ no_initial_call:
         /* Reset all emulations */
         reset_emulation();
 
-        if (dial_phonebook_entry_n != -1) {
-            q_current_dial_entry = q_phonebook.entries;
-            while ((dial_phonebook_entry_n > 1) &&
-                (q_current_dial_entry != NULL)
-            ) {
-                q_current_dial_entry = q_current_dial_entry->next;
-                dial_phonebook_entry_n--;
-            }
+        if (replay_filename != NULL) {
+            replay_start(replay_filename, replay_speed_arg);
+            switch_state(Q_STATE_CONSOLE);
+        } else if (dial_phonebook_entry_n != -1) {
+            q_current_dial_entry = phonebook_entry_at(
+                (dial_phonebook_entry_n > 1 ? dial_phonebook_entry_n - 1 : 0));
             if (q_current_dial_entry != NULL) {
                 q_phonebook.selected_entry = q_current_dial_entry;
                 phonebook_normalize();
@@ -3839,7 +4109,7 @@ no_initial_call:
         /* Enter main loop */
         for (;;) {
             /* Window size checks, refresh, etc. */
-            refresh_handler();
+            paced_refresh_handler();
 
             /* Grab data */
             data_handler();
@@ -3852,7 +4122,11 @@ no_initial_call:
 
     } /* if (q_program_state != Q_STATE_EXIT) */
 
+    /* Hang up any background sessions */
+    session_close_all();
+
     /* Close any open files */
+    flush_phonebook_journal();
     stop_capture();
     stop_quicklearn();
     script_stop();
@@ -44,6 +44,7 @@ typedef enum Q_CAPTURE_TYPES {
     Q_CAPTURE_TYPE_NORMAL,      /* normal */
     Q_CAPTURE_TYPE_RAW,         /* raw */
     Q_CAPTURE_TYPE_HTML,        /* html */
+    Q_CAPTURE_TYPE_TIMED,       /* timed - compressed, for --replay */
     Q_CAPTURE_TYPE_ASK          /* ask - prompt every time */
 } Q_CAPTURE_TYPE;
 
@@ -0,0 +1,860 @@
+/*
+ * replay.c
+ *
+ * qodem - Qodem Terminal Emulator
+ *
+ * Written 2003-2017 by Kevin Lamonte
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to the
+ * public domain worldwide. This software is distributed without any
+ * warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see
+ * <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+/*
+ * A timed capture records the raw bytes received from the remote side
+ * together with when they arrived, so that the session can be played back
+ * later through the emulator exactly as it was seen.
+ *
+ * The file is an 8-byte header followed by a sequence of blocks.  Each
+ * block has a fixed 28-byte header, all integers little-endian:
+ *
+ *     0  "QTCB"
+ *     4  flags: 0x01 = payload is zlib-compressed
+ *     5  3 bytes reserved
+ *     8  start time of the first record, seconds since the epoch
+ *    12  milliseconds part of the start time
+ *    16  time from the first record to the last, in milliseconds
+ *    20  payload length once decompressed
+ *    24  payload length as stored in the file
+ *
+ * The payload is a series of records: a variable-length milliseconds
+ * delta from the previous record, a variable-length byte count, and the
+ * bytes themselves.  Blocks are independent, so a replay can index the
+ * file by reading only the block headers and decode blocks one at a time
+ * as it plays.  Appending to an existing capture adds another file header,
+ * which the reader skips.
+ *
+ * Compression needs zlib (Q_ZLIB); without it blocks are stored as-is and
+ * compressed captures cannot be replayed.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef Q_PDCURSES_WIN32
+#include <sys/time.h>
+#endif
+#ifdef Q_ZLIB
+#include <zlib.h>
+#endif
+#include "qodem.h"
+#include "screen.h"
+#include "forms.h"
+#include "input.h"
+#include "states.h"
+#include "console.h"
+#include "emulation.h"
+#include "scrollback.h"
+#include "translate.h"
+#include "replay.h"
+
+/* Set this to a not-NULL value to enable debug log. */
+/* static const char * DLOGNAME = "replay"; */
+static const char * DLOGNAME = NULL;
+
+/**
+ * The timed capture file header.
+ */
+#define TIMED_CAPTURE_MAGIC "QODEMTC1"
+#define TIMED_CAPTURE_MAGIC_SIZE 8
+
+/**
+ * The block header.
+ */
+#define TIMED_BLOCK_MAGIC "QTCB"
+#define TIMED_BLOCK_HEADER_SIZE 28
+#define TIMED_BLOCK_DEFLATE 0x01
+
+/**
+ * The most decompressed bytes in one block.
+ */
+#define TIMED_BLOCK_SIZE 65536
+
+/**
+ * A block is written once it has been open this many seconds, even if it
+ * is not full.  This bounds how much is lost if qodem dies.
+ */
+#define TIMED_BLOCK_SECONDS 10
+
+/**
+ * The most bytes a record header can take: two 5-byte varints.
+ */
+#define TIMED_RECORD_OVERHEAD 10
+
+/**
+ * The fastest replay speed.
+ */
+#define REPLAY_MAX_SPEED 64
+
+/**
+ * The most bytes replay_process() feeds to the emulator in one pass, so
+ * that the keyboard stays responsive at high speeds.
+ */
+#define REPLAY_BYTES_PER_PASS 8192
+
+/**
+ * How far the arrow keys and PgUp/PgDn seek, in milliseconds.
+ */
+#define REPLAY_SEEK_SHORT 10000L
+#define REPLAY_SEEK_LONG 300000L
+
+/* Timed capture ---------------------------------------------------------- */
+
+/**
+ * The block being collected.
+ */
+static unsigned char timed_block[TIMED_BLOCK_SIZE];
+static size_t timed_block_n = 0;
+
+/**
+ * When the first and most recent records in timed_block arrived.
+ */
+static struct timeval timed_block_start;
+static struct timeval timed_block_last;
+
+/**
+ * The milliseconds from one time to another, clamped to zero.
+ *
+ * @param from the earlier time
+ * @param to the later time
+ * @return the milliseconds between them
+ */
+static long timeval_ms(const struct timeval * from,
+                       const struct timeval * to) {
+    long ms;
+
+    ms = (long) (to->tv_sec - from->tv_sec) * 1000 +
+         (long) (to->tv_usec - from->tv_usec) / 1000;
+    if (ms < 0) {
+        return 0;
+    }
+    return ms;
+}
+
+/**
+ * Store a 32-bit value little-endian.
+ *
+ * @param buffer the place to store it
+ * @param value the value
+ */
+static void put_uint32(unsigned char * buffer, const uint32_t value) {
+    buffer[0] = (unsigned char) (value & 0xFF);
+    buffer[1] = (unsigned char) ((value >> 8) & 0xFF);
+    buffer[2] = (unsigned char) ((value >> 16) & 0xFF);
+    buffer[3] = (unsigned char) ((value >> 24) & 0xFF);
+}
+
+/**
+ * Load a 32-bit little-endian value.
+ *
+ * @param buffer the place to load from
+ * @return the value
+ */
+static uint32_t get_uint32(const unsigned char * buffer) {
+    return (uint32_t) buffer[0] |
+           ((uint32_t) buffer[1] << 8) |
+           ((uint32_t) buffer[2] << 16) |
+           ((uint32_t) buffer[3] << 24);
+}
+
+/**
+ * Store a variable-length value, 7 bits per byte with the high bit set on
+ * all but the last byte.
+ *
+ * @param buffer the place to store it
+ * @param value the value
+ * @return the number of bytes used
+ */
+static size_t put_varint(unsigned char * buffer, uint32_t value) {
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        buffer[n++] = (unsigned char) ((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer[n++] = (unsigned char) value;
+    return n;
+}
+
+/**
+ * Load a variable-length value.
+ *
+ * @param buffer the buffer to load from
+ * @param buffer_n the number of bytes in buffer
+ * @param pos the position to load from, advanced past the value
+ * @param value the value
+ * @return false if the buffer ended first
+ */
+static Q_BOOL get_varint(const unsigned char * buffer, const size_t buffer_n,
+                         size_t * pos, uint32_t * value) {
+    int shift = 0;
+
+    *value = 0;
+    while (*pos < buffer_n) {
+        *value |= (uint32_t) (buffer[*pos] & 0x7F) << shift;
+        if ((buffer[(*pos)++] & 0x80) == 0) {
+            return Q_TRUE;
+        }
+        shift += 7;
+        if (shift > 28) {
+            return Q_FALSE;
+        }
+    }
+    return Q_FALSE;
+}
+
+/**
+ * Compress and write timed_block to the capture file.
+ */
+static void write_timed_block() {
+    unsigned char header[TIMED_BLOCK_HEADER_SIZE];
+    unsigned char * payload = timed_block;
+    size_t payload_n = timed_block_n;
+#ifdef Q_ZLIB
+    static unsigned char compressed[TIMED_BLOCK_SIZE + TIMED_BLOCK_SIZE / 8 +
+                                    64];
+    uLongf compressed_n = sizeof(compressed);
+#endif
+
+    if (timed_block_n == 0) {
+        return;
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, TIMED_BLOCK_MAGIC, 4);
+
+#ifdef Q_ZLIB
+    if ((compress2(compressed, &compressed_n, timed_block, timed_block_n,
+                   Z_DEFAULT_COMPRESSION) == Z_OK) &&
+        (compressed_n < timed_block_n)
+    ) {
+        header[4] = TIMED_BLOCK_DEFLATE;
+        payload = compressed;
+        payload_n = compressed_n;
+    }
+#endif
+
+    put_uint32(header + 8, (uint32_t) timed_block_start.tv_sec);
+    put_uint32(header + 12, (uint32_t) (timed_block_start.tv_usec / 1000));
+    put_uint32(header + 16, (uint32_t) timeval_ms(&timed_block_start,
+                                                  &timed_block_last));
+    put_uint32(header + 20, (uint32_t) timed_block_n);
+    put_uint32(header + 24, (uint32_t) payload_n);
+
+    fwrite(header, 1, sizeof(header), q_status.capture_file);
+    fwrite(payload, 1, payload_n, q_status.capture_file);
+    timed_block_n = 0;
+}
+
+/**
+ * Write the timed capture file header to q_status.capture_file.  Called by
+ * start_capture() when the capture type is Q_CAPTURE_TYPE_TIMED.
+ */
+void start_timed_capture() {
+    timed_block_n = 0;
+    fwrite(TIMED_CAPTURE_MAGIC, 1, TIMED_CAPTURE_MAGIC_SIZE,
+           q_status.capture_file);
+}
+
+/**
+ * Append bytes received from the remote side to the timed capture,
+ * stamped with the current time.
+ *
+ * @param data the bytes to capture
+ * @param n the number of bytes in data
+ */
+void timed_capture(const unsigned char * data, const size_t n) {
+    struct timeval now;
+    size_t remaining = n;
+    size_t chunk;
+
+    gettimeofday(&now, NULL);
+
+    while (remaining > 0) {
+        if (timed_block_n + TIMED_RECORD_OVERHEAD >= sizeof(timed_block)) {
+            write_timed_block();
+        }
+        if (timed_block_n == 0) {
+            timed_block_start = now;
+            timed_block_last = now;
+        }
+
+        chunk = sizeof(timed_block) - timed_block_n - TIMED_RECORD_OVERHEAD;
+        if (chunk > remaining) {
+            chunk = remaining;
+        }
+        timed_block_n += put_varint(timed_block + timed_block_n,
+            (uint32_t) timeval_ms(&timed_block_last, &now));
+        timed_block_n += put_varint(timed_block + timed_block_n,
+                                    (uint32_t) chunk);
+        memcpy(timed_block + timed_block_n, data, chunk);
+        timed_block_n += chunk;
+        timed_block_last = now;
+
+        data += chunk;
+        remaining -= chunk;
+    }
+}
+
+/**
+ * Write the pending timed capture block to q_status.capture_file.
+ *
+ * @param force if false, only write the block if it has been open for
+ * long enough; if true, always write it
+ */
+void flush_timed_capture(const Q_BOOL force) {
+    struct timeval now;
+
+    if (timed_block_n == 0) {
+        return;
+    }
+    if (force == Q_FALSE) {
+        gettimeofday(&now, NULL);
+        if (timeval_ms(&timed_block_start, &now) <
+            TIMED_BLOCK_SECONDS * 1000L) {
+            return;
+        }
+    }
+    write_timed_block();
+}
+
+/* Replay ----------------------------------------------------------------- */
+
+/**
+ * One block of the file being replayed.
+ */
+struct replay_block {
+    long offset;                /* File offset of the payload */
+    long time;                  /* Replay time of the first record, ms */
+    unsigned char flags;        /* TIMED_BLOCK_DEFLATE */
+    size_t raw_n;               /* Decompressed size */
+    size_t stored_n;            /* Size in the file */
+};
+
+/**
+ * The file being replayed, or NULL if no replay is running.
+ */
+static FILE * replay_file = NULL;
+
+/**
+ * The block index, sorted by time.
+ */
+static struct replay_block * replay_blocks = NULL;
+static int replay_blocks_n = 0;
+
+/**
+ * The replay time at the end of the last record, in milliseconds.
+ */
+static long replay_length = 0;
+
+/**
+ * The decoded block, and the read position in it.
+ */
+static int replay_block = -1;
+static unsigned char replay_raw[TIMED_BLOCK_SIZE];
+static size_t replay_raw_n = 0;
+static size_t replay_raw_pos = 0;
+
+/**
+ * The next record to play, valid when replay_record_ready is true.
+ */
+static Q_BOOL replay_record_ready = Q_FALSE;
+static long replay_record_time = 0;
+static const unsigned char * replay_record = NULL;
+static size_t replay_record_n = 0;
+
+/**
+ * The current position in the replay, in milliseconds, and when it was
+ * last advanced.
+ */
+static long replay_clock = 0;
+static struct timeval replay_tick;
+
+/**
+ * The replay speed, 1 for real time.
+ */
+static int replay_speed = 1;
+static Q_BOOL replay_paused = Q_FALSE;
+
+/**
+ * Read the block headers of the replay file into replay_blocks.  A
+ * truncated final block, as left by a crash, is dropped.
+ *
+ * @return false if the file is not a timed capture
+ */
+static Q_BOOL index_replay_file() {
+    unsigned char header[TIMED_BLOCK_HEADER_SIZE];
+    struct replay_block * block;
+    int blocks_max = 0;
+    long offset = 0;
+    long last_end = 0;
+    long last_sec = 0;
+    long last_msec = 0;
+    long sec;
+    long msec;
+    long gap;
+    Q_BOOL new_capture = Q_TRUE;
+    size_t rc;
+
+    for (;;) {
+        rc = fread(header, 1, TIMED_CAPTURE_MAGIC_SIZE, replay_file);
+        if (rc == 0) {
+            break;
+        }
+        if ((rc == TIMED_CAPTURE_MAGIC_SIZE) &&
+            (memcmp(header, TIMED_CAPTURE_MAGIC,
+                    TIMED_CAPTURE_MAGIC_SIZE) == 0)
+        ) {
+            /*
+             * Start of another capture appended to this file
+             */
+            offset += TIMED_CAPTURE_MAGIC_SIZE;
+            new_capture = Q_TRUE;
+            continue;
+        }
+        if (offset == 0) {
+            return Q_FALSE;
+        }
+        if ((rc < TIMED_CAPTURE_MAGIC_SIZE) ||
+            (fread(header + TIMED_CAPTURE_MAGIC_SIZE, 1,
+                   TIMED_BLOCK_HEADER_SIZE - TIMED_CAPTURE_MAGIC_SIZE,
+                   replay_file) !=
+             TIMED_BLOCK_HEADER_SIZE - TIMED_CAPTURE_MAGIC_SIZE) ||
+            (memcmp(header, TIMED_BLOCK_MAGIC, 4) != 0)
+        ) {
+            break;
+        }
+        offset += TIMED_BLOCK_HEADER_SIZE;
+
+        if (replay_blocks_n == blocks_max) {
+            blocks_max = (blocks_max == 0) ? 256 : blocks_max * 2;
+            replay_blocks = (struct replay_block *) Xrealloc(replay_blocks,
+                blocks_max * sizeof(struct replay_block), __FILE__, __LINE__);
+        }
+        block = &replay_blocks[replay_blocks_n];
+        block->offset = offset;
+        block->flags = header[4];
+        block->raw_n = get_uint32(header + 20);
+        block->stored_n = get_uint32(header + 24);
+        if ((block->raw_n > TIMED_BLOCK_SIZE) ||
+            (block->stored_n > TIMED_BLOCK_SIZE + TIMED_BLOCK_SIZE / 8 + 64)
+        ) {
+            break;
+        }
+
+        /*
+         * Place the block on the replay timeline.  Gaps between separate
+         * captures in the same file are squeezed to one second.
+         */
+        sec = (long) get_uint32(header + 8);
+        msec = (long) get_uint32(header + 12);
+        if (replay_blocks_n == 0) {
+            block->time = 0;
+        } else {
+            gap = (sec - last_sec) * 1000 + (msec - last_msec);
+            if (gap < 0) {
+                gap = 0;
+            }
+            if ((new_capture == Q_TRUE) && (gap > 1000)) {
+                gap = 1000;
+            }
+            block->time = replay_blocks[replay_blocks_n - 1].time + gap;
+            if (block->time < last_end) {
+                block->time = last_end;
+            }
+        }
+        last_sec = sec;
+        last_msec = msec;
+        last_end = block->time + (long) get_uint32(header + 16);
+        new_capture = Q_FALSE;
+
+        if (fseek(replay_file, (long) block->stored_n, SEEK_CUR) != 0) {
+            break;
+        }
+        offset += (long) block->stored_n;
+        replay_blocks_n++;
+    }
+
+    /*
+     * Make sure the last block is all there.
+     */
+    if (replay_blocks_n > 0) {
+        block = &replay_blocks[replay_blocks_n - 1];
+        fseek(replay_file, 0, SEEK_END);
+        if (ftell(replay_file) < block->offset + (long) block->stored_n) {
+            replay_blocks_n--;
+        }
+    }
+    if (replay_blocks_n > 0) {
+        replay_length = last_end;
+    }
+    return (offset > 0) ? Q_TRUE : Q_FALSE;
+}
+
+/**
+ * Decode one block into replay_raw and position on its first record.
+ *
+ * @param block the block number
+ * @return false if the block could not be read
+ */
+static Q_BOOL load_replay_block(const int block) {
+    static unsigned char stored[TIMED_BLOCK_SIZE + TIMED_BLOCK_SIZE / 8 + 64];
+    struct replay_block * b = &replay_blocks[block];
+#ifdef Q_ZLIB
+    uLongf raw_n;
+#endif
+
+    replay_block = block;
+    replay_raw_n = 0;
+    replay_raw_pos = 0;
+    replay_record_ready = Q_FALSE;
+    replay_record_time = b->time;
+
+    if ((fseek(replay_file, b->offset, SEEK_SET) != 0) ||
+        (fread(stored, 1, b->stored_n, replay_file) != b->stored_n)
+    ) {
+        return Q_FALSE;
+    }
+
+    if (b->flags & TIMED_BLOCK_DEFLATE) {
+#ifdef Q_ZLIB
+        raw_n = sizeof(replay_raw);
+        if (uncompress(replay_raw, &raw_n, stored, b->stored_n) != Z_OK) {
+            return Q_FALSE;
+        }
+        replay_raw_n = raw_n;
+#else
+        return Q_FALSE;
+#endif
+    } else {
+        if (b->stored_n > sizeof(replay_raw)) {
+            return Q_FALSE;
+        }
+        memcpy(replay_raw, stored, b->stored_n);
+        replay_raw_n = b->stored_n;
+    }
+    return Q_TRUE;
+}
+
+/**
+ * Make the next record available, moving on to the next block if needed.
+ *
+ * @return false at the end of the replay
+ */
+static Q_BOOL next_replay_record() {
+    uint32_t delta;
+    uint32_t length;
+
+    if (replay_record_ready == Q_TRUE) {
+        return Q_TRUE;
+    }
+
+    while ((replay_block < 0) || (replay_raw_pos >= replay_raw_n)) {
+        if (replay_block + 1 >= replay_blocks_n) {
+            return Q_FALSE;
+        }
+        if (load_replay_block(replay_block + 1) == Q_FALSE) {
+            /*
+             * Skip damaged blocks
+             */
+            replay_raw_n = 0;
+        }
+    }
+
+    if ((get_varint(replay_raw, replay_raw_n, &replay_raw_pos,
+                    &delta) == Q_FALSE) ||
+        (get_varint(replay_raw, replay_raw_n, &replay_raw_pos,
+                    &length) == Q_FALSE) ||
+        (length > replay_raw_n - replay_raw_pos)
+    ) {
+        /*
+         * Damaged record, drop the rest of the block
+         */
+        replay_raw_pos = replay_raw_n;
+        return next_replay_record();
+    }
+
+    replay_record_time += (long) delta;
+    replay_record = replay_raw + replay_raw_pos;
+    replay_record_n = length;
+    replay_raw_pos += length;
+    replay_record_ready = Q_TRUE;
+    return Q_TRUE;
+}
+
+/**
+ * Feed records up to a replay time through the emulator.
+ *
+ * @param until the replay time to stop at
+ * @param budget the most bytes to feed, or 0 for no limit
+ * @return false if the end of the replay was reached
+ */
+static Q_BOOL feed_replay(const long until, const size_t budget) {
+    const unsigned char * inbound_map;
+    size_t fed = 0;
+    size_t i;
+
+    while ((budget == 0) || (fed < budget)) {
+        if (next_replay_record() == Q_FALSE) {
+            return Q_FALSE;
+        }
+        if (replay_record_time > until) {
+            break;
+        }
+        inbound_map = translate_8bit_in_map();
+        for (i = 0; i < replay_record_n; i++) {
+            console_emulate(inbound_map[replay_record[i]]);
+        }
+        fed += replay_record_n;
+        replay_record_ready = Q_FALSE;
+    }
+    q_screen_dirty = Q_TRUE;
+    return Q_TRUE;
+}
+
+/**
+ * Jump to a point in the replay.  A forward seek plays everything up to
+ * the target instantly.  The screen at any moment can depend on anything
+ * that came before it, so a backward seek resets the emulator and plays
+ * instantly from the beginning.  Nothing is drawn until the target is
+ * reached.
+ *
+ * @param target the replay time to seek to
+ */
+static void seek_replay(long target) {
+
+    if (target < 0) {
+        target = 0;
+    }
+    if (target > replay_length) {
+        target = replay_length;
+    }
+
+    if (target < replay_clock) {
+        reset_emulation();
+        cursor_formfeed();
+
+        replay_block = -1;
+        replay_raw_n = 0;
+        replay_raw_pos = 0;
+        replay_record_ready = Q_FALSE;
+    }
+    feed_replay(target, 0);
+
+    replay_clock = target;
+    gettimeofday(&replay_tick, NULL);
+}
+
+/**
+ * Begin replaying a timed capture file through the console.
+ *
+ * @param filename the capture file to replay
+ * @param speed the initial replay speed, 1 for real time
+ * @return true if the file was opened and indexed
+ */
+Q_BOOL replay_start(const char * filename, const int speed) {
+    char notify_message[DIALOG_MESSAGE_SIZE];
+
+    if (replay_file != NULL) {
+        replay_stop();
+    }
+
+    replay_file = fopen(filename, "rb");
+    if (replay_file == NULL) {
+        snprintf(notify_message, sizeof(notify_message),
+                 _("Error opening file \"%s\" for reading: %s"), filename,
+                 strerror(errno));
+        notify_form(notify_message, 0);
+        return Q_FALSE;
+    }
+
+    if ((index_replay_file() == Q_FALSE) || (replay_blocks_n == 0)) {
+        snprintf(notify_message, sizeof(notify_message),
+                 _("\"%s\" is not a timed capture file"), filename);
+        replay_stop();
+        notify_form(notify_message, 0);
+        return Q_FALSE;
+    }
+    DLOG(("replay_start() %s: %d blocks, %ld ms\n", filename, replay_blocks_n,
+            replay_length));
+
+    replay_speed = speed;
+    if (replay_speed < 1) {
+        replay_speed = 1;
+    }
+    if (replay_speed > REPLAY_MAX_SPEED) {
+        replay_speed = REPLAY_MAX_SPEED;
+    }
+    replay_paused = Q_FALSE;
+    replay_block = -1;
+    replay_raw_n = 0;
+    replay_raw_pos = 0;
+    replay_record_ready = Q_FALSE;
+    replay_clock = 0;
+    gettimeofday(&replay_tick, NULL);
+    return Q_TRUE;
+}
+
+/**
+ * Stop the running replay and close its file.
+ */
+void replay_stop() {
+    if (replay_file != NULL) {
+        fclose(replay_file);
+        replay_file = NULL;
+    }
+    if (replay_blocks != NULL) {
+        Xfree(replay_blocks, __FILE__, __LINE__);
+        replay_blocks = NULL;
+    }
+    replay_blocks_n = 0;
+    replay_length = 0;
+    replay_block = -1;
+    replay_record_ready = Q_FALSE;
+    q_screen_dirty = Q_TRUE;
+}
+
+/**
+ * See if a replay is running.
+ *
+ * @return true if a replay is running
+ */
+Q_BOOL replay_active() {
+    if (replay_file != NULL) {
+        return Q_TRUE;
+    }
+    return Q_FALSE;
+}
+
+/**
+ * Feed the replay data that has come due to the emulator.  Called from
+ * the main loop on every pass.
+ */
+void replay_process() {
+    struct timeval now;
+    long elapsed;
+
+    if (replay_file == NULL) {
+        return;
+    }
+    if (q_status.online == Q_TRUE) {
+        /*
+         * A real connection takes over the screen
+         */
+        replay_stop();
+        return;
+    }
+
+    gettimeofday(&now, NULL);
+    elapsed = timeval_ms(&replay_tick, &now);
+    replay_tick = now;
+    if ((q_program_state != Q_STATE_CONSOLE) || (replay_paused == Q_TRUE)) {
+        return;
+    }
+
+    replay_clock += elapsed * replay_speed;
+    if (feed_replay(replay_clock, REPLAY_BYTES_PER_PASS) == Q_FALSE) {
+        /*
+         * Hold on the last screen until the user stops or seeks
+         */
+        replay_clock = replay_length;
+        replay_paused = Q_TRUE;
+    }
+}
+
+/**
+ * Keyboard handler for a running replay.  Called by the console keyboard
+ * handler before it does anything else.
+ *
+ * @param keystroke the keystroke from the user.
+ * @param flags KEY_FLAG_ALT, KEY_FLAG_CTRL, etc.  See input.h.
+ * @return true if the keystroke was a replay control
+ */
+Q_BOOL replay_keyboard_handler(const int keystroke, const int flags) {
+    if ((flags & KEY_FLAG_ALT) != 0) {
+        /*
+         * Leave the Alt commands to the console
+         */
+        return Q_FALSE;
+    }
+
+    switch (keystroke) {
+
+    case ' ':
+        if ((replay_paused == Q_TRUE) && (replay_clock >= replay_length)) {
+            seek_replay(0);
+        }
+        replay_paused = (replay_paused == Q_TRUE) ? Q_FALSE : Q_TRUE;
+        break;
+
+    case '+':
+    case '=':
+        if (replay_speed < REPLAY_MAX_SPEED) {
+            replay_speed *= 2;
+        }
+        break;
+
+    case '-':
+        if (replay_speed > 1) {
+            replay_speed /= 2;
+        }
+        break;
+
+    case Q_KEY_RIGHT:
+        seek_replay(replay_clock + REPLAY_SEEK_SHORT);
+        break;
+
+    case Q_KEY_LEFT:
+        seek_replay(replay_clock - REPLAY_SEEK_SHORT);
+        break;
+
+    case Q_KEY_NPAGE:
+        seek_replay(replay_clock + REPLAY_SEEK_LONG);
+        break;
+
+    case Q_KEY_PPAGE:
+        seek_replay(replay_clock - REPLAY_SEEK_LONG);
+        break;
+
+    case Q_KEY_HOME:
+        seek_replay(0);
+        break;
+
+    case Q_KEY_END:
+        seek_replay(replay_length);
+        break;
+
+    case '`':
+        /*
+         * Backtick works too
+         */
+    case Q_KEY_ESCAPE:
+        replay_stop();
+        break;
+
+    default:
+        /*
+         * Nothing else is sent anywhere while replaying
+         */
+        break;
+    }
+    return Q_TRUE;
+}
@@ -0,0 +1,100 @@
+/*
+ * replay.h
+ *
+ * qodem - Qodem Terminal Emulator
+ *
+ * Written 2003-2017 by Kevin Lamonte
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to the
+ * public domain worldwide. This software is distributed without any
+ * warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see
+ * <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+/* Includes --------------------------------------------------------------- */
+
+#include <stddef.h>             /* size_t */
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defines ---------------------------------------------------------------- */
+
+/* Globals ---------------------------------------------------------------- */
+
+/* Functions -------------------------------------------------------------- */
+
+/**
+ * Write the timed capture file header to q_status.capture_file.  Called by
+ * start_capture() when the capture type is Q_CAPTURE_TYPE_TIMED.
+ */
+extern void start_timed_capture();
+
+/**
+ * Append bytes received from the remote side to the timed capture,
+ * stamped with the current time.
+ *
+ * @param data the bytes to capture
+ * @param n the number of bytes in data
+ */
+extern void timed_capture(const unsigned char * data, const size_t n);
+
+/**
+ * Write the pending timed capture block to q_status.capture_file.
+ *
+ * @param force if false, only write the block if it has been open for
+ * long enough; if true, always write it
+ */
+extern void flush_timed_capture(const Q_BOOL force);
+
+/**
+ * Begin replaying a timed capture file through the console.
+ *
+ * @param filename the capture file to replay
+ * @param speed the initial replay speed, 1 for real time
+ * @return true if the file was opened and indexed
+ */
+extern Q_BOOL replay_start(const char * filename, const int speed);
+
+/**
+ * Stop the running replay and close its file.
+ */
+extern void replay_stop();
+
+/**
+ * See if a replay is running.
+ *
+ * @return true if a replay is running
+ */
+extern Q_BOOL replay_active();
+
+/**
+ * Feed the replay data that has come due to the emulator.  Called from
+ * the main loop on every pass.
+ */
+extern void replay_process();
+
+/**
+ * Keyboard handler for a running replay.  Called by the console keyboard
+ * handler before it does anything else.
+ *
+ * @param keystroke the keystroke from the user.
+ * @param flags KEY_FLAG_ALT, KEY_FLAG_CTRL, etc.  See input.h.
+ * @return true if the keystroke was a replay control
+ */
+extern Q_BOOL replay_keyboard_handler(const int keystroke, const int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __REPLAY_H__ */
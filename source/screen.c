@@ -73,6 +73,42 @@ static Gpm_Connect gpm_connection;
 SCREEN * q_main_screen = NULL;
 #endif
 
+/*
+ * For each row of stdscr, true if something other than the scrollback
+ * renderer drew on it since render_scrollback() last painted it.  Rows past
+ * the end of the array count as damaged.
+ */
+static Q_BOOL * damaged_rows = NULL;
+static int damaged_rows_n = 0;
+
+/**
+ * Note that rows of the screen were drawn on.
+ *
+ * @param win the curses WINDOW that was drawn to
+ * @param y the first row drawn, relative to win
+ * @param n the number of rows drawn
+ */
+static void damage_rows(void * win, const int y, const int n) {
+    int top = getbegy((WINDOW *) win) + y;
+    int i;
+
+    for (i = (top < 0 ? 0 : top); (i < top + n) && (i < damaged_rows_n);
+         i++) {
+        damaged_rows[i] = Q_TRUE;
+    }
+}
+
+/**
+ * Note that every row of the screen was drawn on.
+ */
+static void damage_all_rows() {
+    int i;
+
+    for (i = 0; i < damaged_rows_n; i++) {
+        damaged_rows[i] = Q_TRUE;
+    }
+}
+
 /**
  * Get the to-screen color index for a logical attr that has COLOR_X and
  * A_BOLD set.
@@ -309,6 +345,8 @@ static void screen_win_put_char(void * win, const wchar_t ch, const attr_t attr,
         screen_setup(q_rows_arg, q_cols_arg);
     }
 
+    damage_rows(win, getcury((WINDOW *) win), 1);
+
     wch[0] = ch;
     wch[1] = 0;
     setcchar(&ncurses_ch, wch, physical_attr_from_attr(attr),
@@ -337,6 +375,8 @@ static void screen_win_put_char_yx(void * win, const int y, const int x,
         screen_setup(q_rows_arg, q_cols_arg);
     }
 
+    damage_rows(win, y, 1);
+
     wch[0] = ch;
     wch[1] = 0;
     setcchar(&ncurses_ch, wch, physical_attr_from_attr(attr),
@@ -474,6 +514,8 @@ static void screen_win_put_hline_yx(void * win, const int y, const int x,
         screen_setup(q_rows_arg, q_cols_arg);
     }
 
+    damage_rows(win, y, 1);
+
     wch[0] = ch;
     wch[1] = 0;
     setcchar(&ncurses_ch, wch, physical_attr_from_attr(attr),
@@ -502,6 +544,8 @@ static void screen_win_put_vline_yx(void * win, const int y, const int x,
         screen_setup(q_rows_arg, q_cols_arg);
     }
 
+    damage_rows(win, y, n);
+
     wch[0] = ch;
     wch[1] = 0;
     setcchar(&ncurses_ch, wch, physical_attr_from_attr(attr),
@@ -1049,6 +1093,7 @@ void screen_clear() {
     }
 
     werase(stdscr);
+    damage_all_rows();
 }
 
 /**
@@ -1086,6 +1131,7 @@ void screen_really_clear() {
     for (i = 0; i < HEIGHT; i++) {
         mvhline_set(i, 0, &ncurses_ch, WIDTH);
     }
+    damage_all_rows();
     refresh();
 }
 
@@ -1337,8 +1383,10 @@ void screen_teardown() {
  */
 void screen_clear_remaining_line(Q_BOOL double_width) {
     int x, y;
-    int i;
     int n = WIDTH;
+    cchar_t ncurses_ch;
+    wchar_t wch[2];
+    short color;
 
     if (curses_initted == Q_FALSE) {
         /* Handle lazy-loading curses. */
@@ -1350,14 +1398,95 @@ void screen_clear_remaining_line(Q_BOOL double_width) {
         n /= 2;
     }
     if (x < n - 1) {
-        for (i = x; i < n; i++) {
-            screen_put_char_yx(y, i, ' ', 0,
-                               screen_color(Q_COLOR_CONSOLE_BACKGROUND));
-        }
+        /*
+         * This is part of rendering the scrollback, so it does not damage
+         * the row.
+         */
+        color = screen_color(Q_COLOR_CONSOLE_BACKGROUND);
+        wch[0] = ' ';
+        wch[1] = 0;
+        setcchar(&ncurses_ch, wch, physical_attr_from_attr(0),
+                 physical_color_from_attr(0, color), NULL);
+        mvwhline_set(stdscr, y, x, &ncurses_ch, n - x);
     }
     move(y, x);
 }
 
+/**
+ * See if a row of the screen was drawn on by something other than the
+ * scrollback renderer since screen_row_repaired() was last called for it.
+ *
+ * @param y the row.  The top-most row is 0.
+ * @return true if the row needs to be painted again
+ */
+Q_BOOL screen_row_damaged(const int y) {
+    if ((y < 0) || (y >= damaged_rows_n)) {
+        return Q_TRUE;
+    }
+    return damaged_rows[y];
+}
+
+/**
+ * Note that the scrollback renderer just painted a row of the screen.
+ *
+ * @param y the row.  The top-most row is 0.
+ */
+void screen_row_repaired(const int y) {
+    int i;
+
+    if (y < 0) {
+        return;
+    }
+    if (y >= damaged_rows_n) {
+        damaged_rows = (Q_BOOL *) Xrealloc(damaged_rows,
+                                           sizeof(Q_BOOL) * (y + 1),
+                                           __FILE__, __LINE__);
+        for (i = damaged_rows_n; i <= y; i++) {
+            damaged_rows[i] = Q_TRUE;
+        }
+        damaged_rows_n = y + 1;
+    }
+    damaged_rows[y] = Q_FALSE;
+}
+
+/**
+ * Scroll rows of the screen up, using the curses scrolling region.  The
+ * rows that scroll in at the bottom are blank and damaged.
+ *
+ * @param top the first row of the region.  The top-most row is 0.
+ * @param bottom the last row of the region
+ * @param n the number of rows to scroll up by
+ */
+void screen_scroll_rows(const int top, const int bottom, const int n) {
+    int i;
+
+    if (curses_initted == Q_FALSE) {
+        /* Handle lazy-loading curses. */
+        screen_setup(q_rows_arg, q_cols_arg);
+    }
+
+    if ((n <= 0) || (top < 0) || (bottom <= top)) {
+        return;
+    }
+
+    wsetscrreg(stdscr, top, bottom);
+    scrollok(stdscr, TRUE);
+    wscrl(stdscr, n);
+    scrollok(stdscr, FALSE);
+    wsetscrreg(stdscr, 0, HEIGHT - 1);
+
+    /*
+     * The damage moves with the rows
+     */
+    for (i = top; (i <= bottom) && (i < damaged_rows_n); i++) {
+        if ((i + n <= bottom) && (i + n < damaged_rows_n)) {
+            damaged_rows[i] = damaged_rows[i + n];
+        } else {
+            damaged_rows[i] = Q_TRUE;
+        }
+    }
+}
+
 /**
  * Write the screen's current dimensions to height and width.
  *
@@ -66,6 +66,32 @@ extern void screen_beep();
  */
 extern void screen_clear_remaining_line(Q_BOOL double_width);
 
+/**
+ * See if a row of the screen was drawn on by something other than the
+ * scrollback renderer since screen_row_repaired() was last called for it.
+ *
+ * @param y the row.  The top-most row is 0.
+ * @return true if the row needs to be painted again
+ */
+extern Q_BOOL screen_row_damaged(const int y);
+
+/**
+ * Note that the scrollback renderer just painted a row of the screen.
+ *
+ * @param y the row.  The top-most row is 0.
+ */
+extern void screen_row_repaired(const int y);
+
+/**
+ * Scroll rows of the screen up, using the curses scrolling region.  The
+ * rows that scroll in at the bottom are blank and damaged.
+ *
+ * @param top the first row of the region.  The top-most row is 0.
+ * @param bottom the last row of the region
+ * @param n the number of rows to scroll up by
+ */
+extern void screen_scroll_rows(const int top, const int bottom, const int n);
+
 /**
  * Turn a Q_COLOR enum into a ncurses attr_t.  This is used to specify the
  * background (normal) terminal color for the emulations.  Note that even if
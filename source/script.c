@@ -69,11 +69,13 @@ static const char * DLOGNAME = NULL;
 Q_SCRIPT q_running_script;
 
 /*
- * Buffer of UTF-8 encoded printable characters to send to the script's
- * stdin.  This is space for at least 128 Unicode code points that could each
- * take up to 4 bytes to encode.
+ * Ring buffer of UTF-8 encoded printable characters to send to the script's
+ * stdin.  The remote side is only held off when this fills, so it is large
+ * enough to ride out a chatty host while the script catches up.  The size
+ * must be a power of two.
  */
-static char print_buffer[128 * 4];
+static char print_buffer[65536];
+static int print_buffer_start;
 static int print_buffer_n;
 
 #ifdef Q_PDCURSES_WIN32
@@ -147,7 +149,9 @@ static void update_print_buffer_flags() {
  * @param ch the character
  */
 void script_print_character(const wchar_t ch) {
+    char utf8[8];
     int rc;
+    int i;
 
     if (q_running_script.paused == Q_TRUE) {
         /*
@@ -160,6 +164,7 @@ void script_print_character(const wchar_t ch) {
         /*
          * Drop characters when the script is dead.
          */
+        print_buffer_start = 0;
         print_buffer_n = 0;
         update_print_buffer_flags();
         return;
@@ -173,10 +178,14 @@ void script_print_character(const wchar_t ch) {
     }
 
     /*
-     * Encode the character to UTF-8.
+     * Encode the character to UTF-8 and append it to the ring.
      */
-    rc = utf8_encode(ch, &print_buffer[print_buffer_n]);
-    print_buffer_n += rc;
+    rc = utf8_encode(ch, utf8);
+    for (i = 0; i < rc; i++) {
+        print_buffer[(print_buffer_start + print_buffer_n) &
+                     (sizeof(print_buffer) - 1)] = utf8[i];
+        print_buffer_n++;
+    }
 
     /*
      * Fix the full/empty flags
@@ -295,6 +304,7 @@ void script_process_data(unsigned char * input, const unsigned int input_n,
 
     char notify_message[DIALOG_MESSAGE_SIZE];
     int rc = 0;
+    int span_n;
     int n;
     int i;
     uint32_t utf8_char;
@@ -326,72 +336,85 @@ void script_process_data(unsigned char * input, const unsigned int input_n,
     if (q_running_script.stdin_writeable == Q_TRUE) {
 
         /*
-         * Write the data to q_running_script.script_tty_fd
+         * Write the data to q_running_script.script_tty_fd.  The ring is
+         * written one contiguous span at a time: a second write is only
+         * needed when the data wraps and the first span went out whole.
          */
+        for (;;) {
+            span_n = print_buffer_n;
+            if (print_buffer_start + span_n > sizeof(print_buffer)) {
+                span_n = sizeof(print_buffer) - print_buffer_start;
+            }
+
 #ifdef Q_PDCURSES_WIN32
-        if (print_buffer_n > 0) {
-            DWORD bytes_written = 0;
-            if (WriteFile(q_script_stdin, print_buffer,
-                          print_buffer_n, &bytes_written, NULL) == TRUE) {
-                rc = bytes_written;
+            if (span_n > 0) {
+                DWORD bytes_written = 0;
+                if (WriteFile(q_script_stdin,
+                              print_buffer + print_buffer_start,
+                              span_n, &bytes_written, NULL) == TRUE) {
+                    rc = bytes_written;
 
+                    /*
+                     * Force this sucker to flush
+                     */
+                    FlushFileBuffers(q_script_stdin);
+                } else {
+                    errno = GetLastError();
+                    rc = -1;
+                }
+            } else {
                 /*
-                 * Force this sucker to flush
+                 * NOP, pretend it's EAGAIN
                  */
-                FlushFileBuffers(q_script_stdin);
-            } else {
-                errno = GetLastError();
+                errno = EAGAIN;
                 rc = -1;
             }
-        } else {
-            /*
-             * NOP, pretend it's EAGAIN
-             */
-            errno = EAGAIN;
-            rc = -1;
-        }
 #else
-        rc = write(q_running_script.script_tty_fd, print_buffer,
-                   print_buffer_n);
+            rc = write(q_running_script.script_tty_fd,
+                       print_buffer + print_buffer_start, span_n);
 #endif
 
-        if (rc < 0) {
-            switch (errno) {
+            if (rc < 0) {
+                switch (errno) {
 
 #ifdef Q_PDCURSES_WIN32
-            case ERROR_NO_DATA:
-                /*
-                 * Other side is closing, give up here and the stdout read
-                 * should return EOF.
-                 */
-                break;
+                case ERROR_NO_DATA:
+                    /*
+                     * Other side is closing, give up here and the stdout
+                     * read should return EOF.
+                     */
+                    break;
 #endif
-            case EAGAIN:
-                /*
-                 * Outgoing buffer is full, wait for the next round.
-                 */
+                case EAGAIN:
+                    /*
+                     * Outgoing buffer is full, wait for the next round.
+                     */
+                    break;
+                default:
+                    /*
+                     * Uh-oh, error
+                     */
+                    snprintf(notify_message, sizeof(notify_message),
+                             _("Call to write() failed: %d %s"), errno,
+                             strerror(errno));
+                    notify_form(notify_message, 0);
+                    return;
+                }
                 break;
-            default:
-                /*
-                 * Uh-oh, error
-                 */
-                snprintf(notify_message, sizeof(notify_message),
-                         _("Call to write() failed: %d %s"), errno,
-                         strerror(errno));
-                notify_form(notify_message, 0);
-                return;
             }
-        } else {
+
             /*
              * Hang onto the difference for the next round.
              */
-            assert(rc <= print_buffer_n);
-
-            if (rc < print_buffer_n) {
-                memmove(print_buffer, print_buffer + rc, print_buffer_n - rc);
-            }
+            assert(rc <= span_n);
+            print_buffer_start = (print_buffer_start + rc) &
+                                 (sizeof(print_buffer) - 1);
             print_buffer_n -= rc;
             update_print_buffer_flags();
+
+            if ((rc < span_n) || (print_buffer_n == 0)) {
+                break;
+            }
         }
     }
 
@@ -826,6 +849,7 @@ void script_start(const char * script_filename) {
     q_running_script.stdout_readable = Q_FALSE;
 
     memset(print_buffer, 0, sizeof(print_buffer));
+    print_buffer_start = 0;
     print_buffer_n = 0;
     update_print_buffer_flags();
 
@@ -1401,6 +1425,7 @@ void script_stop() {
     /*
      * Throw away the remaining print buffer
      */
+    print_buffer_start = 0;
     print_buffer_n = 0;
     update_print_buffer_flags();
 
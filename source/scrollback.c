@@ -77,6 +77,7 @@
 #ifndef Q_PDCURSES_WIN32
 #include <wctype.h>
 #endif
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -89,7 +90,12 @@
 #include "script.h"
 #include "console.h"
 #include "translate.h"
+#include "session.h"
 #include "scrollback.h"
+#ifdef Q_ZLIB
+#include <unistd.h>
+#include <zlib.h>
+#endif
 
 /**
  * The scrollback buffer.
@@ -137,6 +143,19 @@ Q_BOOL q_scrollback_highlight_search_string = Q_FALSE;
  */
 static Q_BOOL vt100_wrap_line_flag = Q_FALSE;
 
+/*
+ * The line render_scrollback() last painted on each row of the screen, and
+ * the layout it painted them with.  A row is painted again only when its
+ * line changed, a different line lands on it, or something else drew over
+ * it.
+ */
+static struct q_scrolline_struct ** rendered_lines = NULL;
+static int rendered_rows = -1;
+static int rendered_width = -1;
+static Q_PROGRAM_STATE rendered_state;
+static Q_EMULATION rendered_emulation;
+static Q_CODEPAGE rendered_codepage;
+
 #ifndef Q_PDCURSES
 /**
  * If true, this console can display true double-width characters by
@@ -384,6 +403,59 @@ void new_scrollback_line() {
     }
 }
 
+/**
+ * The scrollback state that is saved with a session.
+ */
+struct scrollback_session {
+    struct q_scrolline_struct * buffer;
+    struct q_scrolline_struct * last;
+    struct q_scrolline_struct * current;
+    struct q_scrolline_struct * position;
+    Q_BOOL vt100_wrap_line_flag;
+};
+
+/**
+ * Save or restore the scrollback buffer.  DETACH leaves the scrollback
+ * empty; the caller is expected to call new_scrollback_line() before
+ * printing anything.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t scrollback_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct scrollback_session * saved = (struct scrollback_session *) buffer;
+    struct q_scrolline_struct * line;
+
+    switch (op) {
+    case Q_SESSION_SAVE:
+    case Q_SESSION_RESTORE:
+        Q_SESSION_COPY(op, saved->buffer, q_scrollback_buffer);
+        Q_SESSION_COPY(op, saved->last, q_scrollback_last);
+        Q_SESSION_COPY(op, saved->current, q_scrollback_current);
+        Q_SESSION_COPY(op, saved->position, q_scrollback_position);
+        Q_SESSION_COPY(op, saved->vt100_wrap_line_flag, vt100_wrap_line_flag);
+        break;
+    case Q_SESSION_FREE:
+        while (q_scrollback_buffer != NULL) {
+            line = q_scrollback_buffer;
+            q_scrollback_buffer = line->next;
+            Xfree(line, __FILE__, __LINE__);
+        }
+        /* Fall through... */
+    case Q_SESSION_DETACH:
+        q_scrollback_buffer = NULL;
+        q_scrollback_last = NULL;
+        q_scrollback_current = NULL;
+        q_scrollback_position = NULL;
+        vt100_wrap_line_flag = Q_FALSE;
+        break;
+    case Q_SESSION_SIZE:
+        break;
+    }
+    return sizeof(struct scrollback_session);
+}
+
 /**
  * The code to wrap a line.  It has two different places it might be called,
  * so now I've got to separate it into a function.
@@ -432,7 +504,7 @@ void print_character(const wchar_t character) {
     static attr_t old_color = 0xdeadbeef;
 #endif
     Q_BOOL color_changed = Q_FALSE;
-    int right_margin = WIDTH - 1;
+    int right_margin;
     Q_BOOL wrap_the_line = Q_FALSE;
     int i;
     /*
@@ -442,6 +514,7 @@ void print_character(const wchar_t character) {
     wchar_t character2 = character;
 
     if (q_scrollback_current->length < q_status.cursor_x) {
+        q_scrollback_current->dirty = Q_TRUE;
         for (i = q_scrollback_current->length; i < q_status.cursor_x; i++) {
             q_scrollback_current->chars[i] = ' ';
             q_scrollback_current->colors[i] =
@@ -492,65 +565,7 @@ void print_character(const wchar_t character) {
         quicklearn_print_character(character2);
     }
 
-    /*
-     * This isn't the prettiest logic, but whatever
-     */
-    switch (q_status.emulation) {
-    case Q_EMUL_ANSI:
-    case Q_EMUL_AVATAR:
-    case Q_EMUL_TTY:
-        /*
-         * BBS-ish emulations:  check the assume_80_columns flag
-         */
-        if (q_status.assume_80_columns == Q_TRUE) {
-            right_margin = 79;
-        }
-        break;
-    case Q_EMUL_ATASCII:
-        /*
-         * ATASCII is always 40 columns on screen.  But these might be
-         * double-width lines, so the visible right margin is 80 columns.
-         */
-        if (q_status.atascii_has_wide_font == Q_FALSE) {
-            /*
-             * We think we are running with a narrow font, so will need to
-             * use double-width characters.
-             */
-            right_margin = 79;
-        } else {
-            /*
-             * We already have a wide font, so restrict to 40 columns.
-             */
-            right_margin = 39;
-        }
-        break;
-    case Q_EMUL_PETSCII:
-        /*
-         * PETSCII is always 40 columns on screen.  But these might be
-         * double-width lines, so the visible right margin is 80 columns.
-         */
-        if (q_status.petscii_has_wide_font == Q_FALSE) {
-            /*
-             * We think we are running with a narrow font, so will need to
-             * use double-width characters.
-             */
-            right_margin = 79;
-        } else {
-            /*
-             * We already have a wide font, so restrict to 40 columns.
-             */
-            right_margin = 39;
-        }
-        break;
-    default:
-        /*
-         * VT100-ish emulations:  check the actual right margin value
-         */
-        if (q_emulation_right_margin > 0) {
-            right_margin = q_emulation_right_margin;
-        }
-        break;
-    }
+    right_margin = emulation_right_margin();
     if (q_scrollback_current->double_width == Q_TRUE) {
         right_margin = ((right_margin + 1) / 2) - 1;
     }
@@ -793,6 +808,92 @@ void print_character(const wchar_t character) {
     } /* if (wrap_the_line == Q_TRUE) */
 }
 
+/**
+ * Print the same character several times, as for ANSI REP or an Avatar
+ * repeat.  On a plain line the run is written straight into the scrollback
+ * up to the right margin.  Wrapping, insert mode, capture, and scripts all
+ * go through print_character(), as does the last character of the run so
+ * that its bookkeeping ends up exactly as if every character had been
+ * printed one at a time.
+ *
+ * @param character the character to print
+ * @param count the number of times to print it
+ */
+void print_character_repeat(const wchar_t character, int count) {
+    int right_margin;
+    int n;
+    int i;
+
+    while (count > 1) {
+        if ((character == 0x00) ||
+            (character == 0x07) ||
+            (q_status.insert_mode == Q_TRUE) ||
+            (q_status.capture == Q_TRUE) ||
+            (q_status.quicklearn == Q_TRUE) ||
+            (q_program_state == Q_STATE_SCRIPT_EXECUTE)
+        ) {
+            break;
+        }
+
+        right_margin = emulation_right_margin();
+        if (q_scrollback_current->double_width == Q_TRUE) {
+            right_margin = ((right_margin + 1) / 2) - 1;
+        }
+
+        /*
+         * Every cell left of the right margin is a "normal case" character
+         * for print_character(): no wrapping, and the cursor just moves
+         * right.
+         */
+        n = right_margin - q_status.cursor_x;
+        if (n > count - 1) {
+            n = count - 1;
+        }
+        if (n <= 0) {
+            /*
+             * Sitting on the margin (a deferred wrap, or wrapping turned
+             * off): one character through print_character() gets it onto
+             * the next line, then the bulk fill can pick up again.
+             */
+            print_character(character);
+            count--;
+            continue;
+        }
+
+        if (q_scrollback_current->length < q_status.cursor_x) {
+            for (i = q_scrollback_current->length; i < q_status.cursor_x;
+                 i++) {
+                q_scrollback_current->chars[i] = ' ';
+                q_scrollback_current->colors[i] =
+                    scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
+            }
+        }
+        for (i = q_status.cursor_x; i < q_status.cursor_x + n; i++) {
+            q_scrollback_current->chars[i] = character;
+            q_scrollback_current->colors[i] = q_current_color;
+        }
+        q_status.cursor_x += n;
+        if (q_scrollback_current->length < q_status.cursor_x) {
+            q_scrollback_current->length = q_status.cursor_x;
+        }
+        q_scrollback_current->dirty = Q_TRUE;
+        vt100_wrap_line_flag = Q_FALSE;
+        count -= n;
+
+        /*
+         * The rest of the run wraps, go one at a time until it is back on
+         * a fresh line.
+         */
+        print_character(character);
+        count--;
+    }
+
+    while (count > 0) {
+        print_character(character);
+        count--;
+    }
+}
+
 /**
  * Clear all the lines in the scrollback.
  */
@@ -820,280 +921,489 @@ static void clear_scrollback() {
 }
 
 /**
- * Save one line of the visible scrollback to file, including HTML or NORMAL
- * mode.
+ * Size of the buffer used when saving the scrollback or dumping the screen.
+ */
+#define EXPORT_BUFFER_SIZE 65536
+
+/**
+ * The file being written by save_scrollback() or screen_dump().  Output is
+ * collected in buffer and written in large blocks, and optionally gzipped.
+ */
+static struct {
+    FILE * file;
+#ifdef Q_ZLIB
+    gzFile gz;
+#endif
+    Q_CAPTURE_TYPE type;
+    int html_class;
+    Q_BOOL error;
+    int error_errno;
+    Q_BOOL batch;
+    size_t buffer_n;
+    char buffer[EXPORT_BUFFER_SIZE];
+} export_file;
+
+/**
+ * Report an error writing the export file.  In batch mode there is no
+ * screen, so the message goes to stderr.
  *
- * @param file the file to save to
- * @param line the line to save
- * @param save_type either HTML or NORMAL
- * @param last_color the last color written (cached for cleanliness)
+ * @param message the message to show
  */
-static void save_scrollback_line(FILE * file, struct q_scrolline_struct * line,
-                                 Q_CAPTURE_TYPE save_type,
-                                 attr_t * last_color) {
-    int i;
-    wchar_t ch;
-    Q_BOOL color_changed = Q_FALSE;
+static void export_error(const char * message) {
+    if (export_file.batch == Q_TRUE) {
+        fprintf(stderr, "%s\n", message);
+    } else {
+        notify_form(message, 0);
+    }
+}
 
-    assert(q_status.read_only == Q_FALSE);
+/**
+ * Note that a write to the export file failed.  Only the first failure is
+ * kept, and its errno is saved right away so that the report is not
+ * clobbered by the calls that follow.
+ */
+static void export_failed() {
+    if (export_file.error == Q_FALSE) {
+        export_file.error = Q_TRUE;
+        export_file.error_errno = (errno != 0 ? errno : EIO);
+    }
+}
+
+/**
+ * Write the export buffer to disk.
+ */
+static void export_flush() {
+    if ((export_file.buffer_n > 0) && (export_file.error == Q_FALSE)) {
+        errno = 0;
+#ifdef Q_ZLIB
+        if (export_file.gz != NULL) {
+            if (gzwrite(export_file.gz, export_file.buffer,
+                        (unsigned) export_file.buffer_n) == 0) {
+                export_failed();
+            }
+        } else
+#endif
+        if (fwrite(export_file.buffer, 1, export_file.buffer_n,
+                   export_file.file) != export_file.buffer_n) {
+            export_failed();
+        }
+    }
+    export_file.buffer_n = 0;
+}
+
+/**
+ * Append bytes to the export buffer.
+ *
+ * @param data the bytes to write
+ * @param data_n the number of bytes in data
+ */
+static void export_write(const char * data, size_t data_n) {
+    size_t n;
+
+    while (data_n > 0) {
+        if (export_file.buffer_n == sizeof(export_file.buffer)) {
+            export_flush();
+        }
+        n = sizeof(export_file.buffer) - export_file.buffer_n;
+        if (n > data_n) {
+            n = data_n;
+        }
+        memcpy(export_file.buffer + export_file.buffer_n, data, n);
+        export_file.buffer_n += n;
+        data += n;
+        data_n -= n;
+    }
+}
 
-    for (i = 0; i < WIDTH; i++) {
+/**
+ * Append a string to the export buffer.
+ *
+ * @param string the string to write
+ */
+static void export_puts(const char * string) {
+    export_write(string, strlen(string));
+}
+
+/**
+ * Append one byte to the export buffer.
+ *
+ * @param ch the byte to write
+ */
+static void export_putc(const char ch) {
+    if (export_file.buffer_n == sizeof(export_file.buffer)) {
+        export_flush();
+    }
+    export_file.buffer[export_file.buffer_n++] = ch;
+}
+
+/**
+ * Open a file for save_scrollback() or screen_dump().  If qodem was built
+ * with zlib and the filename ends in ".gz", the output is gzipped.
+ *
+ * @param filename the file to write to
+ * @param type either HTML or NORMAL
+ * @return true if the file was opened
+ */
+static Q_BOOL export_open(const char * filename, const Q_CAPTURE_TYPE type) {
+    char * new_filename = NULL;
+    char notify_message[DIALOG_MESSAGE_SIZE];
+#ifdef Q_ZLIB
+    size_t filename_n = strlen(filename);
+    int fd;
+#endif
+
+    if (export_file.batch == Q_TRUE) {
         /*
-         * Break out at the end of the screen
+         * Batch mode writes exactly where it was told to.
          */
-        if (line->double_width == Q_TRUE) {
-            if ((2 * i) >= WIDTH) {
-                break;
+        export_file.file = fopen(filename, "wb");
+        if (export_file.file == NULL) {
+            snprintf(notify_message, sizeof(notify_message),
+                     _("Error opening file \"%s\" for writing: %s"),
+                     filename, strerror(errno));
+            export_error(notify_message);
+            return Q_FALSE;
+        }
+    } else {
+        export_file.file = open_workingdir_file(filename, &new_filename);
+        if (export_file.file == NULL) {
+            snprintf(notify_message, sizeof(notify_message),
+                     _("Error opening file \"%s\" for writing: %s"),
+                     new_filename, strerror(errno));
+            export_error(notify_message);
+            if (new_filename != NULL) {
+                Xfree(new_filename, __FILE__, __LINE__);
             }
-        } else {
-            if (i >= WIDTH) {
-                break;
+            return Q_FALSE;
+        }
+        if (new_filename != filename) {
+            Xfree(new_filename, __FILE__, __LINE__);
+        }
+    }
+
+#ifdef Q_ZLIB
+    export_file.gz = NULL;
+    if ((filename_n > 3) &&
+        (strcmp(filename + filename_n - 3, ".gz") == 0)
+    ) {
+        fd = dup(fileno(export_file.file));
+        if (fd != -1) {
+            export_file.gz = gzdopen(fd, "wb");
+            if (export_file.gz == NULL) {
+                close(fd);
             }
         }
+    }
+#endif
+
+    export_file.type = type;
+    export_file.html_class = -1;
+    export_file.error = Q_FALSE;
+    export_file.buffer_n = 0;
+    return Q_TRUE;
+}
+
+/**
+ * Flush and close the file opened by export_open().
+ *
+ * @return true if everything was written successfully
+ */
+static Q_BOOL export_close() {
+    char notify_message[DIALOG_MESSAGE_SIZE];
+
+    export_flush();
+#ifdef Q_ZLIB
+    if (export_file.gz != NULL) {
+        errno = 0;
+        if (gzclose(export_file.gz) != Z_OK) {
+            export_failed();
+        }
+        export_file.gz = NULL;
+    }
+#endif
+    errno = 0;
+    if (fclose(export_file.file) != 0) {
+        export_failed();
+    }
+    export_file.file = NULL;
+
+    if (export_file.error == Q_TRUE) {
+        snprintf(notify_message, sizeof(notify_message),
+                 _("Error writing file: %s"),
+                 strerror(export_file.error_errno));
+        export_error(notify_message);
+        return Q_FALSE;
+    }
+    return Q_TRUE;
+}
+
+/**
+ * Save one line of the scrollback to the export file, including HTML or
+ * NORMAL mode.  Cells are written in runs of the same attribute; in HTML
+ * mode each run is one &lt;span&gt; referring to a class emitted by
+ * export_scrollback().
+ *
+ * @param line the line to save
+ */
+static void export_line(struct q_scrolline_struct * line) {
+    int i;
+    int columns;
+    int html_class;
+    wchar_t ch;
+    attr_t pad_color;
+    Q_BOOL double_pad = Q_FALSE;
+    char mb[MB_LEN_MAX];
+    mbstate_t mb_state;
+    size_t mb_n;
+    char entity[32];
+
+    assert(q_status.read_only == Q_FALSE);
+
+    columns = WIDTH;
+    if (line->double_width == Q_TRUE) {
+        columns = (WIDTH + 1) / 2;
+        if ((q_status.emulation != Q_EMUL_PETSCII) &&
+            (q_status.emulation != Q_EMUL_ATASCII)
+        ) {
+            double_pad = Q_TRUE;
+        }
+    }
+    pad_color = Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
+    memset(&mb_state, 0, sizeof(mb_state));
+
+    for (i = 0; i < columns; i++) {
         if (i >= line->length) {
             ch = ' ';
-            if (*last_color !=
-                (Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT))) {
-                *last_color =
-                    Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
-                color_changed = Q_TRUE;
-            }
         } else {
             ch = line->chars[i];
-            if (line->colors[i] != *last_color) {
-                *last_color = line->colors[i];
-                color_changed = Q_TRUE;
-            }
         }
 
-        if (save_type == Q_CAPTURE_TYPE_HTML) {
+        if (export_file.type == Q_CAPTURE_TYPE_HTML) {
             /*
              * HTML
              */
-            if (color_changed == Q_TRUE) {
-                fprintf(file, "</font><font %s>", color_to_html(*last_color));
-                color_changed = Q_FALSE;
+            if (i >= line->length) {
+                html_class = color_to_html_class(pad_color);
+            } else {
+                html_class = color_to_html_class(line->colors[i]);
             }
-            if (ch == ' ') {
-                fprintf(file, "&nbsp;");
-            } else if (ch == '<') {
-                fprintf(file, "&lt;");
+            if (html_class != export_file.html_class) {
+                if (export_file.html_class != -1) {
+                    export_puts("</span>");
+                }
+                snprintf(entity, sizeof(entity), "<span class=\"q%d\">",
+                         html_class);
+                export_puts(entity);
+                export_file.html_class = html_class;
+            }
+            if (ch == '<') {
+                export_puts("&lt;");
             } else if (ch == '>') {
-                fprintf(file, "&gt;");
+                export_puts("&gt;");
+            } else if (ch == '&') {
+                export_puts("&amp;");
             } else if (ch < 0x7F) {
-                fprintf(file, "%c", (int) ch);
+                export_putc((char) ch);
             } else {
-                fprintf(file, "&#%d;", (int) ch);
+                snprintf(entity, sizeof(entity), "&#%d;", (int) ch);
+                export_puts(entity);
             }
-        } else if (save_type == Q_CAPTURE_TYPE_NORMAL) {
+        } else if (export_file.type == Q_CAPTURE_TYPE_NORMAL) {
             /*
              * Normal
              */
-            fprintf(file, "%lc", (wint_t) ch);
-        }
-        if ((line->double_width == Q_TRUE) &&
-            (q_status.emulation != Q_EMUL_PETSCII) &&
-            (q_status.emulation != Q_EMUL_ATASCII)
-        ) {
-            if (save_type == Q_CAPTURE_TYPE_HTML) {
-                fprintf(file, "&nbsp;");
+            if (ch < 0x80) {
+                export_putc((char) ch);
             } else {
-                fprintf(file, " ");
+                mb_n = wcrtomb(mb, ch, &mb_state);
+                if (mb_n == (size_t) -1) {
+                    memset(&mb_state, 0, sizeof(mb_state));
+                    export_putc('?');
+                } else {
+                    export_write(mb, mb_n);
+                }
             }
         }
-
-    }                           /* for (i = 0; i < WIDTH; i++) */
-    fprintf(file, "\n");
+        if (double_pad == Q_TRUE) {
+            export_putc(' ');
+        }
+    }
+    export_putc('\n');
 }
 
 /**
- * Save the scrollback to a file.
+ * Save a range of the scrollback to a file.
  *
  * @param filename the file to save to
- * @param visible_only if true, only save the part that is on the screen
+ * @param type either HTML or NORMAL
+ * @param title the strftime() format of the BEGIN/END banner, or NULL to
+ * omit the banners
+ * @param first the first line to save
+ * @param count the number of lines to save, or -1 to save through the end
+ * of the scrollback
+ * @return true if the file was written successfully
  */
-static Q_BOOL save_scrollback(const char * filename,
-                              const Q_BOOL visible_only) {
+static Q_BOOL export_scrollback(const char * filename,
+                                const Q_CAPTURE_TYPE type,
+                                const char * title,
+                                struct q_scrolline_struct * first,
+                                const int count) {
 
     struct q_scrolline_struct * line;
-    FILE * file;
     time_t current_time;
     char time_string[TIME_STRING_LENGTH];
-    char * new_filename = NULL;
-    char notify_message[DIALOG_MESSAGE_SIZE];
-    attr_t color = Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
-    int row;
-
-    assert(q_status.read_only == Q_FALSE);
+    char banner[TIME_STRING_LENGTH + 64];
+    Q_BOOL used[Q_HTML_CLASS_MAX];
+    attr_t pad_color;
+    int html_class;
+    int i;
+    int n;
 
-    file = open_workingdir_file(filename, &new_filename);
-    if (file == NULL) {
-        snprintf(notify_message, sizeof(notify_message),
-                 _("Error opening file \"%s\" for writing: %s"), new_filename,
-                 strerror(errno));
-        notify_form(notify_message, 0);
-        if (new_filename != NULL) {
-            Xfree(new_filename, __FILE__, __LINE__);
-        }
+    if (export_open(filename, type) == Q_FALSE) {
         return Q_FALSE;
     }
-    time(&current_time);
-
-    if (q_status.scrollback_save_type == Q_CAPTURE_TYPE_HTML) {
-        /*
-         * HTML
-         */
-        strftime(time_string, sizeof(time_string),
-                 _("Saved Scrollback Generated %a, %d %b %Y %H:%M:%S %z"),
-                 localtime(&current_time));
-        fprintf(file, "<html>\n\n");
-        fprintf(file, "<!-- * - * Qodem " Q_VERSION " %s BEGIN * - * --> \n\n",
-                time_string);
-        fprintf(file,
-                "<body bgcolor=\"black\">\n<pre {font-family: 'Courier New', monospace;}><code><font %s>",
-                color_to_html(q_current_color));
-    } else {
-        strftime(time_string, sizeof(time_string),
-                 _("Saved Scrollback Generated %a, %d %b %Y %H:%M:%S %z"),
+    time_string[0] = 0;
+    if (title != NULL) {
+        time(&current_time);
+        strftime(time_string, sizeof(time_string), title,
                  localtime(&current_time));
-        fprintf(file, "* - * Qodem " Q_VERSION " %s BEGIN * - *\n\n",
-                time_string);
     }
 
-    if (visible_only == Q_TRUE) {
+    if (type == Q_CAPTURE_TYPE_HTML) {
         /*
-         * Save what is visible to file
+         * HTML: declare one CSS class for every attribute that appears in
+         * the range, so that the body only needs short span tags.
          */
-        line = q_scrollback_position;
-        row = HEIGHT - STATUS_HEIGHT - 1;
-        while ((row > 0) && (line->prev != NULL)) {
-            line = line->prev;
-            row--;
-        }
-        while ((row < HEIGHT - STATUS_HEIGHT) && (line != NULL)) {
-            save_scrollback_line(file, line, q_status.scrollback_save_type,
-                                 &color);
-            line = line->next;
-            row++;
+        memset(used, 0, sizeof(used));
+        pad_color = Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
+        used[color_to_html_class(pad_color)] = Q_TRUE;
+        for (line = first, n = 0; (line != NULL) && (n != count);
+             line = line->next, n++) {
+            for (i = 0; i < line->length; i++) {
+                used[color_to_html_class(line->colors[i])] = Q_TRUE;
+            }
         }
-    } else {
-        /*
-         * Save everything to file
-         */
-        for (line = q_scrollback_buffer; line != NULL; line = line->next) {
-            save_scrollback_line(file, line, q_status.scrollback_save_type,
-                                 &color);
+
+        export_puts("<html>\n\n");
+        if (title != NULL) {
+            snprintf(banner, sizeof(banner),
+                     "<!-- * - * Qodem " Q_VERSION " %s BEGIN * - * --> \n\n",
+                     time_string);
+            export_puts(banner);
+        }
+        export_puts("<head>\n<style type=\"text/css\">\n");
+        export_puts("pre { font-family: 'Courier New', monospace; }\n");
+        for (html_class = 0; html_class < Q_HTML_CLASS_MAX; html_class++) {
+            if (used[html_class] == Q_TRUE) {
+                snprintf(banner, sizeof(banner), ".q%d { ", html_class);
+                export_puts(banner);
+                export_puts(color_html_class_style(html_class));
+                export_puts(" }\n");
+            }
         }
+        export_puts("</style>\n</head>\n");
+        export_puts("<body bgcolor=\"black\">\n<pre><code>");
+    } else if (title != NULL) {
+        snprintf(banner, sizeof(banner),
+                 "* - * Qodem " Q_VERSION " %s BEGIN * - *\n\n",
+                 time_string);
+        export_puts(banner);
+    }
+
+    for (line = first, n = 0; (line != NULL) && (n != count);
+         line = line->next, n++) {
+        export_line(line);
     }
 
-    if (q_status.scrollback_save_type == Q_CAPTURE_TYPE_HTML) {
+    if (type == Q_CAPTURE_TYPE_HTML) {
         /*
          * HTML
          */
-        fprintf(file, "</code></pre></font>\n</body>\n");
-        strftime(time_string, sizeof(time_string),
-                 _("Saved Scrollback Generated %a, %d %b %Y %H:%M:%S %z"),
-                 localtime(&current_time));
-        fprintf(file, "\n<!-- * - * Qodem " Q_VERSION " %s END * - * -->\n",
-                time_string);
-        fprintf(file, "\n</html>\n");
-    } else {
-        strftime(time_string, sizeof(time_string),
-                 _("Saved Scrollback Generated %a, %d %b %Y %H:%M:%S %z"),
-                 localtime(&current_time));
-        fprintf(file, "\n* - * Qodem " Q_VERSION " %s END * - *\n",
-                time_string);
+        if (export_file.html_class != -1) {
+            export_puts("</span>");
+        }
+        export_puts("</code></pre>\n</body>\n");
+        if (title != NULL) {
+            snprintf(banner, sizeof(banner),
+                     "\n<!-- * - * Qodem " Q_VERSION " %s END * - * -->\n",
+                     time_string);
+            export_puts(banner);
+        }
+        export_puts("\n</html>\n");
+    } else if (title != NULL) {
+        snprintf(banner, sizeof(banner),
+                 "\n* - * Qodem " Q_VERSION " %s END * - *\n",
+                 time_string);
+        export_puts(banner);
     }
 
-    fclose(file);
-    if (new_filename != filename) {
-        Xfree(new_filename, __FILE__, __LINE__);
-    }
-    return Q_TRUE;
+    return export_close();
 }
 
 /**
- * Perform the Alt-T dump screen to a file.
+ * Save the scrollback to a file.
  *
- * @param filename the file to write to
+ * @param filename the file to save to
+ * @param visible_only if true, only save the part that is on the screen
  */
-Q_BOOL screen_dump(const char * filename) {
+static Q_BOOL save_scrollback(const char * filename,
+                              const Q_BOOL visible_only) {
+
     struct q_scrolline_struct * line;
-    FILE * file;
-    time_t current_time;
-    char time_string[TIME_STRING_LENGTH];
-    char * new_filename = NULL;
-    char notify_message[DIALOG_MESSAGE_SIZE];
-    attr_t color = Q_A_NORMAL | scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
+    int row;
 
-    file = open_workingdir_file(filename, &new_filename);
-    if (file == NULL) {
-        snprintf(notify_message, sizeof(notify_message),
-                 _("Error opening file \"%s\" for writing: %s"), new_filename,
-                 strerror(errno));
-        notify_form(notify_message, 0);
-        if (new_filename != NULL) {
-            Xfree(new_filename, __FILE__, __LINE__);
-        }
-        return Q_FALSE;
-    }
-    time(&current_time);
+    assert(q_status.read_only == Q_FALSE);
 
-    if (q_status.screen_dump_type == Q_CAPTURE_TYPE_HTML) {
+    if (visible_only == Q_TRUE) {
         /*
-         * HTML
+         * Save what is visible to file
          */
-        strftime(time_string, sizeof(time_string),
-                 _("Screen Dump Generated %a, %d %b %Y %H:%M:%S %z"),
-                 localtime(&current_time));
-        fprintf(file, "<html>\n\n");
-        fprintf(file, "<!-- * - * Qodem " Q_VERSION " %s BEGIN * - * --> \n\n",
-                time_string);
-        fprintf(file,
-                "<body bgcolor=\"black\">\n<pre {font-family: 'Courier New', monospace;}><code><font %s>",
-                color_to_html(q_current_color));
-    } else {
-        strftime(time_string, sizeof(time_string),
-                 _("Screen Dump Generated %a, %d %b %Y %H:%M:%S %z"),
-                 localtime(&current_time));
-        fprintf(file, "* - * Qodem " Q_VERSION " %s BEGIN * - *\n\n",
-                time_string);
+        line = q_scrollback_position;
+        row = HEIGHT - STATUS_HEIGHT - 1;
+        while ((row > 0) && (line->prev != NULL)) {
+            line = line->prev;
+            row--;
+        }
+        return export_scrollback(filename, q_status.scrollback_save_type,
+            _("Saved Scrollback Generated %a, %d %b %Y %H:%M:%S %z"),
+            line, HEIGHT - STATUS_HEIGHT - row);
     }
 
-    line = find_top_scrollback_line();
-
     /*
-     * Now loop from line onward
+     * Save everything to file
      */
-    while (line != NULL) {
-        save_scrollback_line(file, line, q_status.screen_dump_type, &color);
-        line = line->next;
-    }
+    return export_scrollback(filename, q_status.scrollback_save_type,
+        _("Saved Scrollback Generated %a, %d %b %Y %H:%M:%S %z"),
+        q_scrollback_buffer, -1);
+}
 
-    if (q_status.screen_dump_type == Q_CAPTURE_TYPE_HTML) {
-        /*
-         * HTML
-         */
-        fprintf(file, "</code></pre></font>\n</body>\n");
-        strftime(time_string, sizeof(time_string),
-                 _("Screen Dump Generated %a, %d %b %Y %H:%M:%S %z"),
-                 localtime(&current_time));
-        fprintf(file, "\n<!-- * - * Qodem " Q_VERSION " %s END * - * -->\n",
-                time_string);
-        fprintf(file, "\n</html>\n");
-    } else {
-        strftime(time_string, sizeof(time_string),
-                 _("Screen Dump Generated %a, %d %b %Y %H:%M:%S %z"),
-                 localtime(&current_time));
-        fprintf(file, "\n* - * Qodem " Q_VERSION " %s END * - *\n",
-                time_string);
-    }
+/**
+ * Perform the Alt-T dump screen to a file.
+ *
+ * @param filename the file to write to
+ */
+Q_BOOL screen_dump(const char * filename) {
+    return export_scrollback(filename, q_status.screen_dump_type,
+        _("Screen Dump Generated %a, %d %b %Y %H:%M:%S %z"),
+        find_top_scrollback_line(), -1);
+}
 
-    fclose(file);
-    if (new_filename != filename) {
-        Xfree(new_filename, __FILE__, __LINE__);
-    }
-    return Q_TRUE;
+/**
+ * Save the entire scrollback to a file for the --render batch mode.  No
+ * banners are written, and errors are reported to stderr.
+ *
+ * @param filename the file to write to
+ * @param type either HTML or NORMAL
+ * @return true if the file was written successfully
+ */
+Q_BOOL render_scrollback_file(const char * filename,
+                              const Q_CAPTURE_TYPE type) {
+    Q_BOOL rc;
+
+    export_file.batch = Q_TRUE;
+    rc = export_scrollback(filename, type, NULL, q_scrollback_buffer, -1);
+    export_file.batch = Q_FALSE;
+    return rc;
 }
 
 /**
@@ -1581,6 +1891,8 @@ void render_scrollback(const int skip_lines) {
     struct q_scrolline_struct * line;
     int row;
     int renderable_lines;
+    int screen_rows;
+    Q_BOOL use_damage = Q_TRUE;
     int i;
 
 #ifndef Q_PDCURSES
@@ -1644,6 +1956,7 @@ void render_scrollback(const int skip_lines) {
                 HEIGHT, WIDTH, STATUS_HEIGHT, skip_lines);
         return;
     }
+    screen_rows = row + 1;
 
     /*
      * Count the lines available
@@ -1689,20 +2002,82 @@ void render_scrollback(const int skip_lines) {
         (double_on_this_screen == Q_TRUE ? "true" : "false"));
      */
 
+    /*
+     * The xterm double-width path emits escapes for every row, so it
+     * always paints everything.
+     */
+    if ((xterm == Q_TRUE) &&
+        ((double_on_last_screen == Q_TRUE) ||
+         (double_on_this_screen == Q_TRUE))
+    ) {
+        use_damage = Q_FALSE;
+    }
 #endif
 
+    /*
+     * Scrollback view highlights search matches, always paint everything
+     * there.
+     */
+    if (q_program_state == Q_STATE_SCROLLBACK) {
+        use_damage = Q_FALSE;
+    }
+
+    /*
+     * Forget what was painted if the layout changed
+     */
+    if ((screen_rows != rendered_rows) ||
+        (WIDTH != rendered_width) ||
+        (q_program_state != rendered_state) ||
+        (q_status.emulation != rendered_emulation) ||
+        (q_status.codepage != rendered_codepage)
+    ) {
+        rendered_lines = (struct q_scrolline_struct **)
+            Xrealloc(rendered_lines,
+                     sizeof(struct q_scrolline_struct *) * screen_rows,
+                     __FILE__, __LINE__);
+        memset(rendered_lines, 0,
+               sizeof(struct q_scrolline_struct *) * screen_rows);
+        rendered_rows = screen_rows;
+        rendered_width = WIDTH;
+        rendered_state = q_program_state;
+        rendered_emulation = q_status.emulation;
+        rendered_codepage = q_status.codepage;
+    }
+    if (use_damage == Q_FALSE) {
+        memset(rendered_lines, 0,
+               sizeof(struct q_scrolline_struct *) * screen_rows);
+    }
+
+    /*
+     * If everything moved up (new lines arrived at the bottom), scroll the
+     * screen to match so that only the new rows need painting.
+     */
+    if ((rendered_lines[0] != NULL) && (rendered_lines[0] != line)) {
+        for (i = 1; i < renderable_lines; i++) {
+            if (rendered_lines[i] == line) {
+                screen_scroll_rows(0, renderable_lines - 1, i);
+                memmove(rendered_lines, rendered_lines + i,
+                        sizeof(struct q_scrolline_struct *) *
+                        (renderable_lines - i));
+                memset(rendered_lines + renderable_lines - i, 0,
+                       sizeof(struct q_scrolline_struct *) * i);
+                break;
+            }
+        }
+    }
+
     /*
      * Now loop from line onward
      */
     for (row = 0; row < renderable_lines; row++) {
 
         /*
-         * ncurses-based drawing needs to refresh the whole screen no matter
-         * what.  ncurses itself handles its own dirty state.  But I want to
-         * keep the stub for doing dirty-line handling here for the case of
-         * rendering to a larger scrollback region (ala Turbo Vision).
+         * Skip rows that already show this line as it is now
          */
-        if ((line->dirty == Q_TRUE) || Q_TRUE) {
+        if ((line->dirty == Q_TRUE) ||
+            (rendered_lines[row] != line) ||
+            (screen_row_damaged(row) == Q_TRUE)
+        ) {
 #ifndef Q_PDCURSES
             /*
              * For xterm, we need to set the double-width flag appropriately
@@ -1847,6 +2222,8 @@ void render_scrollback(const int skip_lines) {
 #endif
 
             line->dirty = Q_FALSE;
+            rendered_lines[row] = line;
+            screen_row_repaired(row);
 
         } /* if (line->dirty == Q_TRUE) */
 
@@ -1855,6 +2232,9 @@ void render_scrollback(const int skip_lines) {
     } /* for (row = 0; row < renderable_lines; row++) */
 
     for (row = renderable_lines; row < HEIGHT - STATUS_HEIGHT; row++) {
+        if (row < rendered_rows) {
+            rendered_lines[row] = NULL;
+        }
         screen_move_yx(row, 0);
 
 #ifdef Q_PDCURSES
@@ -2262,6 +2642,7 @@ void cursor_down(const int count, const Q_BOOL honor_scroll_region) {
                 /*
                  * Pad spaces if necessary
                  */
+                q_scrollback_last->dirty = Q_TRUE;
                 for (j = q_status.cursor_x; j > q_scrollback_current->length;) {
                     q_scrollback_last->colors[q_scrollback_last->length] =
                         scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
@@ -2378,6 +2759,7 @@ void cursor_right(const int count, const Q_BOOL honor_scroll_region) {
                 /*
                  * Append a space and push the line out
                  */
+                q_scrollback_current->dirty = Q_TRUE;
                 q_scrollback_current->colors[q_scrollback_current->length] =
                     q_current_color;
                 q_scrollback_current->chars[q_scrollback_current->length] = ' ';
@@ -2700,8 +3082,6 @@ void cursor_formfeed() {
  * @param new_line_mode if true, set the column to 0
  */
 void cursor_linefeed(const Q_BOOL new_line_mode) {
-    int i;
-    struct q_scrolline_struct *line = NULL;
 
     /*
      * Capture
@@ -2785,15 +3165,10 @@ void cursor_linefeed(const Q_BOOL new_line_mode) {
             }
 
             /*
-             * Mark every line on the screen dirty
+             * The other lines on the screen just moved up a row, which
+             * render_scrollback() notices on its own.
              */
-            line = q_scrollback_position;
-            for (i = 0; i < HEIGHT - STATUS_HEIGHT - 1; i++) {
-                if (line != NULL) {
-                    line->dirty = Q_TRUE;
-                    line = line->prev;
-                }
-            }
+            q_scrollback_current->dirty = Q_TRUE;
 
         } else {
             /*
@@ -3079,6 +3454,7 @@ void deinvert_scrollback_colors() {
  * @param double_width if true, this line will be rendered double-width
  */
 void set_double_width(Q_BOOL double_width) {
+    q_scrollback_current->dirty = Q_TRUE;
     q_scrollback_current->double_width = double_width;
     q_scrollback_current->double_height = 0;
 }
@@ -3090,6 +3466,7 @@ void set_double_width(Q_BOOL double_width) {
  * @param double_height 0, 1, 2
  */
 void set_double_height(int double_height) {
+    q_scrollback_current->dirty = Q_TRUE;
     q_scrollback_current->double_width = Q_TRUE;
     q_scrollback_current->double_height = double_height;
 }
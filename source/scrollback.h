@@ -23,6 +23,7 @@
 #include <stdio.h>              /* FILE */
 #include <stddef.h>             /* wchar_t */
 #include "common.h"             /* Q_BOOL */
+#include "qodem.h"              /* Q_CAPTURE_TYPE */
 
 #ifdef __cplusplus
 extern "C" {
@@ -174,6 +175,15 @@ extern void render_scrollback(const int skip_lines);
  */
 extern void print_character(const wchar_t character);
 
+/**
+ * Print the same character several times, as for ANSI REP or an Avatar
+ * repeat.
+ *
+ * @param character the character to print
+ * @param count the number of times to print it
+ */
+extern void print_character_repeat(const wchar_t character, int count);
+
 /**
  * Perform the Alt-T dump screen to a file.
  *
@@ -181,6 +191,17 @@ extern void print_character(const wchar_t character);
  */
 extern Q_BOOL screen_dump(const char * filename);
 
+/**
+ * Save the entire scrollback to a file for the --render batch mode.  No
+ * banners are written, and errors are reported to stderr.
+ *
+ * @param filename the file to write to
+ * @param type either HTML or NORMAL
+ * @return true if the file was written successfully
+ */
+extern Q_BOOL render_scrollback_file(const char * filename,
+                                     const Q_CAPTURE_TYPE type);
+
 /**
  * Move the cursor up zero or more rows.
  *
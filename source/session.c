@@ -0,0 +1,567 @@
+/*
+ * session.c
+ *
+ * qodem - Qodem Terminal Emulator
+ *
+ * Written 2003-2017 by Kevin Lamonte
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to the
+ * public domain worldwide. This software is distributed without any
+ * warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see
+ * <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+/*
+ * Multiple sessions are implemented by swapping.  Qodem keeps its
+ * per-connection state in globals and file-scope statics spread across
+ * qodem.c, netclient.c, the scrollback, and the emulators.  Each of those
+ * modules exposes a *_session_state() function that copies its statics in
+ * or out of an opaque buffer.  A session is just one such buffer per
+ * module.
+ *
+ * The foreground session always lives in the real globals, so none of the
+ * existing code needs to know that sessions exist.  Background sessions are
+ * swapped in one at a time by session_process_background() when their
+ * descriptor is readable, run through the normal console data path, and
+ * swapped back out.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qodem.h"
+#include "screen.h"
+#include "forms.h"
+#include "states.h"
+#include "console.h"
+#include "keyboard.h"
+#include "scrollback.h"
+#include "host.h"
+#include "script.h"
+#include "session.h"
+
+/* Set this to a not-NULL value to enable debug log. */
+/* static const char * DLOGNAME = "session"; */
+static const char * DLOGNAME = NULL;
+
+#ifndef Q_PDCURSES_WIN32
+/**
+ * Set by the SIGCHLD handler, stored in qodem.c.
+ */
+extern Q_BOOL q_child_exited;
+#endif
+
+/**
+ * The modules that have per-connection state.  The order here is the order
+ * that state is saved and restored.
+ */
+static size_t (*session_modules[])(void *, const Q_SESSION_OP) = {
+    qodem_session_state,
+    net_session_state,
+    console_session_state,
+    scrollback_session_state,
+    emulation_session_state,
+    ansi_session_state,
+    avatar_session_state,
+    vt52_session_state,
+    vt100_session_state,
+    petscii_session_state,
+    atascii_session_state
+};
+
+#define SESSION_MODULES_N \
+    (sizeof(session_modules) / sizeof(session_modules[0]))
+
+/**
+ * One session.
+ */
+struct q_session_struct {
+    /**
+     * The saved state of each module in session_modules.  This is stale for
+     * the foreground session.
+     */
+    void * state[SESSION_MODULES_N];
+
+    /**
+     * The phonebook entry that was dialed.
+     */
+    struct q_phone_struct * dial_entry;
+
+    /**
+     * Copies of a few fields from the saved state, so that the main loop
+     * can look at background sessions without swapping them in.
+     */
+    int child_tty_fd;
+    int child_pid;
+    Q_BOOL online;
+
+    /**
+     * Set by the SIGCHLD handler when this session's child process exits
+     * while it is not in the foreground.
+     */
+    volatile Q_BOOL child_exited;
+
+    /**
+     * The next session in the list.
+     */
+    struct q_session_struct * next;
+};
+
+/**
+ * The list of sessions.  This stays NULL until the first new session is
+ * opened.
+ */
+static struct q_session_struct * sessions = NULL;
+
+/**
+ * The foreground session.
+ */
+static struct q_session_struct * current = NULL;
+
+/**
+ * True while a background session is swapped in.
+ */
+static Q_BOOL background = Q_FALSE;
+
+/**
+ * Allocate a new session with zeroed buffers.
+ *
+ * @return the new session
+ */
+static struct q_session_struct * session_alloc() {
+    struct q_session_struct * session;
+    size_t size;
+    int i;
+
+    session = (struct q_session_struct *) Xmalloc(
+        sizeof(struct q_session_struct), __FILE__, __LINE__);
+    memset(session, 0, sizeof(struct q_session_struct));
+    for (i = 0; i < SESSION_MODULES_N; i++) {
+        size = session_modules[i](NULL, Q_SESSION_SIZE);
+        session->state[i] = Xmalloc(size, __FILE__, __LINE__);
+        memset(session->state[i], 0, size);
+    }
+    session->child_tty_fd = -1;
+    session->child_pid = -1;
+    return session;
+}
+
+/**
+ * Free a session's buffers.  Resources referenced from the buffers must
+ * already have been released with Q_SESSION_FREE.
+ *
+ * @param session the session to free
+ */
+static void session_free(struct q_session_struct * session) {
+    int i;
+
+    for (i = 0; i < SESSION_MODULES_N; i++) {
+        Xfree(session->state[i], __FILE__, __LINE__);
+    }
+    Xfree(session, __FILE__, __LINE__);
+}
+
+/**
+ * Copy the live globals into a session.
+ *
+ * @param session the session to save to
+ */
+static void save_session(struct q_session_struct * session) {
+    int i;
+
+    for (i = 0; i < SESSION_MODULES_N; i++) {
+        session_modules[i](session->state[i], Q_SESSION_SAVE);
+    }
+    session->dial_entry = q_current_dial_entry;
+    session->child_tty_fd = q_child_tty_fd;
+    session->child_pid = q_child_pid;
+    session->online = q_status.online;
+}
+
+/**
+ * Copy a session into the live globals.
+ *
+ * @param session the session to restore from
+ */
+static void restore_session(struct q_session_struct * session) {
+    int i;
+
+    for (i = 0; i < SESSION_MODULES_N; i++) {
+        session_modules[i](session->state[i], Q_SESSION_RESTORE);
+    }
+    q_current_dial_entry = session->dial_entry;
+#ifndef Q_PDCURSES_WIN32
+    if (session->child_exited == Q_TRUE) {
+        q_child_exited = Q_TRUE;
+        session->child_exited = Q_FALSE;
+    }
+#endif
+}
+
+/**
+ * Release everything held by the live globals and leave them detached.
+ */
+static void free_live_session() {
+    int i;
+
+    stop_capture();
+    stop_logging();
+    for (i = 0; i < SESSION_MODULES_N; i++) {
+        session_modules[i](NULL, Q_SESSION_FREE);
+    }
+    q_current_dial_entry = NULL;
+}
+
+/**
+ * Get the 1-based position of a session in the list.
+ *
+ * @param session the session
+ * @return the position
+ */
+static int session_number(const struct q_session_struct * session) {
+    struct q_session_struct * s;
+    int n = 1;
+
+    for (s = sessions; s != session; s = s->next) {
+        assert(s != NULL);
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Get the number of open sessions.
+ *
+ * @return the number of sessions, always at least 1
+ */
+int session_count() {
+    struct q_session_struct * s;
+    int n = 0;
+
+    if (sessions == NULL) {
+        return 1;
+    }
+    for (s = sessions; s != NULL; s = s->next) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * See if the emulators are currently running on behalf of a background
+ * session.
+ *
+ * @return true if a background session is swapped in
+ */
+Q_BOOL session_in_background() {
+    return background;
+}
+
+/**
+ * See if the foreground session can be moved out of the live globals.  If
+ * not, tell the user why.
+ *
+ * @return true if the foreground session can be swapped out
+ */
+static Q_BOOL can_swap_foreground() {
+    if (Q_SERIAL_OPEN) {
+        notify_form(_("Modem and serial connections cannot run in the background"),
+                    1.5);
+        q_cursor_on();
+        return Q_FALSE;
+    }
+    if (q_status.quicklearn == Q_TRUE) {
+        notify_form(_("Stop QuickLearn before switching sessions"), 1.5);
+        q_cursor_on();
+        return Q_FALSE;
+    }
+    if (q_running_script.running == Q_TRUE) {
+        notify_form(_("Stop the running script before switching sessions"),
+                    1.5);
+        q_cursor_on();
+        return Q_FALSE;
+    }
+    return Q_TRUE;
+}
+
+/**
+ * Bring the UI in line with the foreground session after it has been
+ * swapped in.
+ */
+static void show_foreground() {
+    char notify_message[DIALOG_MESSAGE_SIZE];
+
+    if (q_current_dial_entry != NULL) {
+        switch_current_keyboard(q_current_dial_entry->keybindings_filename);
+    } else {
+        switch_current_keyboard("");
+    }
+
+    if ((q_status.xterm_mouse_reporting == Q_TRUE) &&
+        ((q_status.emulation == Q_EMUL_XTERM) ||
+         (q_status.emulation == Q_EMUL_XTERM_UTF8))
+    ) {
+        enable_mouse_listener();
+    } else {
+        disable_mouse_listener();
+    }
+
+    q_screen_dirty = Q_TRUE;
+    snprintf(notify_message, sizeof(notify_message), _("Session %d of %d"),
+             session_number(current), session_count());
+    notify_form(notify_message, 1.5);
+    q_cursor_on();
+}
+
+/**
+ * Open a new session.  The current connection keeps running in the
+ * background, and the foreground is switched to a fresh offline session at
+ * the phonebook.
+ */
+void session_new() {
+    struct q_session_struct * session;
+    int i;
+
+    if (q_status.online == Q_FALSE) {
+        notify_form(_("Not connected, use the phonebook to dial"), 1.5);
+        q_cursor_on();
+        return;
+    }
+    if (session_count() >= Q_SESSION_MAX) {
+        notify_form(_("Too many sessions are open"), 1.5);
+        q_cursor_on();
+        return;
+    }
+    if (can_swap_foreground() == Q_FALSE) {
+        return;
+    }
+
+    DLOG(("session_new()\n"));
+
+    if (sessions == NULL) {
+        sessions = session_alloc();
+        current = sessions;
+    }
+
+    /*
+     * Move the live state into the current session, and forget about the
+     * resources it now owns.
+     */
+    save_session(current);
+    for (i = 0; i < SESSION_MODULES_N; i++) {
+        session_modules[i](NULL, Q_SESSION_DETACH);
+    }
+    q_current_dial_entry = NULL;
+
+    /*
+     * Append the new session and make it the foreground.
+     */
+    session = session_alloc();
+    for (current = sessions; current->next != NULL; current = current->next) {
+        /* Find the tail */
+    }
+    current->next = session;
+    current = session;
+
+    /*
+     * Fresh emulation and scrollback.
+     */
+    reset_emulation();
+    new_scrollback_line();
+    q_scrollback_current = q_scrollback_last;
+    q_scrollback_position = q_scrollback_current;
+    q_status.cursor_y = 0;
+    q_status.cursor_x = 0;
+
+    show_foreground();
+    switch_state(Q_STATE_PHONEBOOK);
+}
+
+/**
+ * Switch the foreground to the next session.  A foreground session that
+ * has gone offline is discarded when it is switched away from.
+ */
+void session_switch() {
+    struct q_session_struct * next;
+    struct q_session_struct * s;
+
+    if (session_count() < 2) {
+        notify_form(_("There is only one session"), 1.5);
+        q_cursor_on();
+        return;
+    }
+    if (can_swap_foreground() == Q_FALSE) {
+        return;
+    }
+
+    DLOG(("session_switch()\n"));
+
+    next = current->next;
+    if (next == NULL) {
+        next = sessions;
+    }
+
+    if (q_status.online == Q_FALSE) {
+        /*
+         * Nothing to come back to, discard it.
+         */
+        free_live_session();
+        if (sessions == current) {
+            sessions = current->next;
+        } else {
+            for (s = sessions; s->next != current; s = s->next) {
+                /* Find the previous session */
+            }
+            s->next = current->next;
+        }
+        session_free(current);
+    } else {
+        save_session(current);
+    }
+
+    current = next;
+    restore_session(current);
+    show_foreground();
+}
+
+/**
+ * Add the descriptors of all background sessions to a select() read set.
+ *
+ * @param readfds the set to add to
+ * @param select_fd_max the highest descriptor in the set, updated as
+ * descriptors are added
+ */
+void session_add_background_fds(fd_set * readfds, int * select_fd_max) {
+    struct q_session_struct * s;
+
+    for (s = sessions; s != NULL; s = s->next) {
+        if ((s == current) || (s->online == Q_FALSE) ||
+            (s->child_tty_fd == -1)
+        ) {
+            continue;
+        }
+        FD_SET(s->child_tty_fd, readfds);
+        if (s->child_tty_fd > *select_fd_max) {
+            *select_fd_max = s->child_tty_fd;
+        }
+    }
+}
+
+/**
+ * Process incoming data for every background session.  Each session is
+ * swapped into the live globals in turn, the process function is called,
+ * and the foreground session is swapped back in.
+ *
+ * @param readfds the read set returned by select()
+ * @param process the function that reads and dispatches data for the live
+ * connection
+ */
+void session_process_background(fd_set * readfds, void (*process)()) {
+    struct q_session_struct * s;
+    Q_PROGRAM_STATE old_state;
+    Q_BOOL old_screen_dirty;
+    Q_BOOL old_split_screen_dirty;
+    Q_BOOL old_console_flood;
+    Q_BOOL swapped = Q_FALSE;
+
+    if ((sessions == NULL) || (sessions->next == NULL)) {
+        return;
+    }
+
+    /*
+     * Host mode drives close_connection() and friends differently, so leave
+     * the background alone until it is done.
+     */
+    if ((q_program_state == Q_STATE_HOST) || (q_host_active == Q_TRUE)) {
+        return;
+    }
+
+    old_state = q_program_state;
+    old_screen_dirty = q_screen_dirty;
+    old_split_screen_dirty = q_split_screen_dirty;
+    old_console_flood = q_console_flood;
+
+    for (s = sessions; s != NULL; s = s->next) {
+        if ((s == current) || (s->online == Q_FALSE)) {
+            continue;
+        }
+        if ((s->child_exited == Q_FALSE) &&
+            ((s->child_tty_fd == -1) ||
+                !FD_ISSET(s->child_tty_fd, readfds))
+        ) {
+            continue;
+        }
+
+        if (swapped == Q_FALSE) {
+            save_session(current);
+            swapped = Q_TRUE;
+        }
+
+        DLOG(("session_process_background(): session %d fd %d\n",
+                session_number(s), s->child_tty_fd));
+
+        restore_session(s);
+        q_program_state = Q_STATE_CONSOLE;
+        background = Q_TRUE;
+        process();
+        background = Q_FALSE;
+        save_session(s);
+    }
+
+    if (swapped == Q_TRUE) {
+        restore_session(current);
+        q_program_state = old_state;
+        q_screen_dirty = old_screen_dirty;
+        q_split_screen_dirty = old_split_screen_dirty;
+        q_console_flood = old_console_flood;
+    }
+}
+
+/**
+ * Called from the SIGCHLD handler for a child process that does not belong
+ * to the foreground session.
+ *
+ * @param pid the process ID that exited
+ */
+void session_child_exited(const int pid) {
+    struct q_session_struct * s;
+
+    for (s = sessions; s != NULL; s = s->next) {
+        if ((s->child_pid != -1) && (s->child_pid == pid)) {
+            s->child_exited = Q_TRUE;
+        }
+    }
+}
+
+/**
+ * Stop capture and logging for all background sessions and hang them up.
+ * Called on program exit.
+ */
+void session_close_all() {
+    struct q_session_struct * s;
+
+    if ((sessions == NULL) || (sessions->next == NULL)) {
+        return;
+    }
+
+    save_session(current);
+    for (s = sessions; s != NULL; s = s->next) {
+        if (s == current) {
+            continue;
+        }
+        restore_session(s);
+        if (q_status.online == Q_TRUE) {
+            close_connection();
+        }
+        stop_capture();
+        stop_logging();
+        save_session(s);
+    }
+    restore_session(current);
+}
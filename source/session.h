@@ -0,0 +1,235 @@
+/*
+ * session.h
+ *
+ * qodem - Qodem Terminal Emulator
+ *
+ * Written 2003-2017 by Kevin Lamonte
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to the
+ * public domain worldwide. This software is distributed without any
+ * warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see
+ * <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+/* Includes --------------------------------------------------------------- */
+
+#include <stddef.h>             /* size_t */
+#include <string.h>             /* memcpy() */
+#ifndef Q_PDCURSES_WIN32
+#include <sys/select.h>         /* fd_set */
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defines ---------------------------------------------------------------- */
+
+/**
+ * The maximum number of simultaneous sessions.
+ */
+#define Q_SESSION_MAX 16
+
+/**
+ * The operations a module's session state function is asked to perform.
+ */
+typedef enum Q_SESSION_OPS {
+    Q_SESSION_SIZE,             /* Return the size of the saved state only */
+    Q_SESSION_SAVE,             /* Copy live state into the buffer */
+    Q_SESSION_RESTORE,          /* Copy the buffer into live state */
+    Q_SESSION_DETACH,           /* Forget resources now owned by a buffer */
+    Q_SESSION_FREE              /* Release resources held by live state */
+} Q_SESSION_OP;
+
+/**
+ * Copy one field between live state and a saved session buffer, in the
+ * direction requested by op.  SIZE, DETACH, and FREE are no-ops.
+ */
+#define Q_SESSION_COPY(op, saved, live)                                 \
+    do {                                                                \
+        if ((op) == Q_SESSION_SAVE) {                                   \
+            memcpy(&(saved), &(live), sizeof(live));                    \
+        } else if ((op) == Q_SESSION_RESTORE) {                         \
+            memcpy(&(live), &(saved), sizeof(live));                    \
+        }                                                               \
+    } while (0)
+
+/* Globals ---------------------------------------------------------------- */
+
+/* Functions -------------------------------------------------------------- */
+
+/**
+ * Open a new session.  The current connection keeps running in the
+ * background, and the foreground is switched to a fresh offline session at
+ * the phonebook.
+ */
+extern void session_new();
+
+/**
+ * Switch the foreground to the next session.  A foreground session that
+ * has gone offline is discarded when it is switched away from.
+ */
+extern void session_switch();
+
+/**
+ * Get the number of open sessions.
+ *
+ * @return the number of sessions, always at least 1
+ */
+extern int session_count();
+
+/**
+ * See if the emulators are currently running on behalf of a background
+ * session.
+ *
+ * @return true if a background session is swapped in
+ */
+extern Q_BOOL session_in_background();
+
+/**
+ * Add the descriptors of all background sessions to a select() read set.
+ *
+ * @param readfds the set to add to
+ * @param select_fd_max the highest descriptor in the set, updated as
+ * descriptors are added
+ */
+extern void session_add_background_fds(fd_set * readfds,
+                                       int * select_fd_max);
+
+/**
+ * Process incoming data for every background session.  Each session is
+ * swapped into the live globals in turn, the process function is called,
+ * and the foreground session is swapped back in.
+ *
+ * @param readfds the read set returned by select()
+ * @param process the function that reads and dispatches data for the live
+ * connection
+ */
+extern void session_process_background(fd_set * readfds,
+                                       void (*process)());
+
+/**
+ * Called from the SIGCHLD handler for a child process that does not belong
+ * to the foreground session.
+ *
+ * @param pid the process ID that exited
+ */
+extern void session_child_exited(const int pid);
+
+/**
+ * Stop capture and logging for all background sessions and hang them up.
+ * Called on program exit.
+ */
+extern void session_close_all();
+
+/**
+ * Save or restore the qodem.c connection state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t qodem_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the console.c autostart state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t console_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the scrollback buffer.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t scrollback_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the common emulation state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t emulation_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the ANSI emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t ansi_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the Avatar emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t avatar_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the VT52 emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t vt52_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the VT100 emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t vt100_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the PETSCII emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t petscii_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the ATASCII emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t atascii_session_state(void * buffer, const Q_SESSION_OP op);
+
+/**
+ * Save or restore the network connection state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+extern size_t net_session_state(void * buffer, const Q_SESSION_OP op);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SESSION_H__ */
@@ -160,53 +160,103 @@ void keyboard_handler() {
 }
 
 /**
- * Dispatch to the appropriate draw function for the current program state.
+ * The earliest time that the next frame of the console may be drawn.
  */
-void refresh_handler() {
-
-#ifdef Q_PDCURSES_WIN32
-    static long last_time = 1000000;
-#else
-    static suseconds_t last_time = 1000000;
-#endif
+static struct timeval next_frame_time;
 
+/**
+ * See if it is time to draw another frame of the console.  A frame is
+ * always drawn right away if the last one is old enough, so a single
+ * keystroke echo is never delayed; only a burst of updates is spread out.
+ * Whatever is skipped stays dirty and goes out with the next frame.
+ *
+ * @param max_rate the most frames per second to allow, on top of the
+ * screen_frame_rate option
+ * @return true if the caller should draw now
+ */
+static Q_BOOL frame_due(const int max_rate) {
     struct timeval tv;
+    long interval;
+    int rate;
+
+    gettimeofday(&tv, NULL);
+    if ((tv.tv_sec < next_frame_time.tv_sec) ||
+        ((tv.tv_sec == next_frame_time.tv_sec) &&
+         (tv.tv_usec < next_frame_time.tv_usec))
+    ) {
+        if (next_frame_time.tv_sec - tv.tv_sec <= 1) {
+            return Q_FALSE;
+        }
+        /*
+         * The clock went backwards, fall through and reschedule
+         */
+    }
+
+    rate = atoi(get_option(Q_OPTION_SCREEN_FRAME_RATE));
+    if ((rate <= 0) || (rate > 1000)) {
+        rate = 1000;
+    }
+    if ((max_rate > 0) && (rate > max_rate)) {
+        rate = max_rate;
+    }
+    interval = 1000000 / rate;
+
+    next_frame_time.tv_sec = tv.tv_sec + (tv.tv_usec + interval) / 1000000;
+    next_frame_time.tv_usec = (tv.tv_usec + interval) % 1000000;
+    return Q_TRUE;
+}
+
+/**
+ * Draw the screen from the main loop.  The console, script, and host
+ * screens are drawn at most once per frame; everything else, and every
+ * direct call to refresh_handler(), is drawn right away.
+ */
+void paced_refresh_handler() {
 
     switch (q_program_state) {
 
     case Q_STATE_CONSOLE:
         /*
-         * Only update the console 16 times a second when in flood.
+         * Nothing new to show, don't use up a frame
          */
-        if (q_console_flood == Q_TRUE) {
-            gettimeofday(&tv, NULL);
-            if ((tv.tv_usec < last_time) || (tv.tv_usec - last_time > 62500)) {
-                console_refresh(Q_TRUE);
-                last_time = tv.tv_usec;
-            }
-        } else {
-            console_refresh(Q_TRUE);
+        if ((q_screen_dirty == Q_FALSE) && (q_split_screen_dirty == Q_FALSE)) {
+            break;
+        }
+        if (frame_due(0) == Q_FALSE) {
+            return;
         }
         break;
     case Q_STATE_SCRIPT_EXECUTE:
+    case Q_STATE_HOST:
         /*
          * Only update the console 8 times a second
          */
-        gettimeofday(&tv, NULL);
-        if ((tv.tv_usec < last_time) || (tv.tv_usec - last_time > 125000)) {
-            script_refresh();
-            last_time = tv.tv_usec;
+        if (frame_due(8) == Q_FALSE) {
+            return;
         }
         break;
+    default:
+        break;
+    }
+
+    refresh_handler();
+}
+
+/**
+ * Dispatch to the appropriate draw function for the current program state.
+ */
+void refresh_handler() {
+
+    switch (q_program_state) {
+
+    case Q_STATE_CONSOLE:
+        console_refresh(Q_TRUE);
+        break;
+    case Q_STATE_SCRIPT_EXECUTE:
+        script_refresh();
+        break;
     case Q_STATE_HOST:
-        /*
-         * Only update the console 8 times a second
-         */
-        gettimeofday(&tv, NULL);
-        if ((tv.tv_usec < last_time) || (tv.tv_usec - last_time > 125000)) {
-            host_refresh();
-            last_time = tv.tv_usec;
-        }
+        host_refresh();
         break;
     case Q_STATE_CONSOLE_MENU:
         console_menu_refresh();
@@ -290,6 +340,15 @@ void refresh_handler() {
  */
 void switch_state(const Q_PROGRAM_STATE new_state) {
 
+    if ((q_program_state == Q_STATE_PHONEBOOK) &&
+        (new_state != Q_STATE_PHONEBOOK)
+    ) {
+        /*
+         * Write out the tags set while in the phonebook.
+         */
+        flush_phonebook_journal();
+    }
+
     if ((q_program_state == Q_STATE_CONSOLE) &&
         (has_true_doublewidth() == Q_TRUE)) {
 
@@ -146,6 +146,13 @@ extern void keyboard_handler();
  */
 extern void refresh_handler();
 
+/**
+ * Draw the screen from the main loop.  The console, script, and host
+ * screens are drawn at most once per frame; everything else, and every
+ * direct call to refresh_handler(), is drawn right away.
+ */
+extern void paced_refresh_handler();
+
 /**
  * Keyboard handler for the screensaver.
  *
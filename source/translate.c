@@ -69,12 +69,16 @@ struct q_wchar_tuple {
 };
 
 /**
- * A Unicode translation table.  This is currently a very stupid list of
- * tuples.
+ * A Unicode translation table.  The Basic Multilingual Plane is a page
+ * table indexed by the high byte of the code point, with a page allocated
+ * only where there are overrides.  Code points above the BMP are kept in a
+ * small open-addressed hash.
  */
 struct table_unicode_struct {
-    struct q_wchar_tuple * mappings;
-    size_t mappings_n;
+    wchar_t * bmp[256];
+    struct q_wchar_tuple * astral;
+    int astral_bits;
+    size_t astral_n;
 };
 
 /**
@@ -87,6 +91,22 @@ static struct table_8bit_struct table_8bit_input;
  */
 static struct table_8bit_struct table_8bit_output;
 
+/**
+ * The 8-bit input translation table composed with the strip 8th bit
+ * option, see translate_8bit_in_map().
+ */
+static unsigned char inbound_map[256];
+
+/**
+ * If true, an 8-bit table has changed since inbound_map was built.
+ */
+static Q_BOOL inbound_map_stale = Q_TRUE;
+
+/**
+ * The strip 8th bit option that inbound_map was built for.
+ */
+static Q_BOOL inbound_map_strip = Q_FALSE;
+
 /**
  * The Unicode input translation table.
  */
@@ -203,6 +223,7 @@ void load_translate_tables_8bit(const char * filename,
         table_input->map_to[i] = i;
         table_output->map_to[i] = i;
     }
+    inbound_map_stale = Q_TRUE;
 
     memset(line, 0, sizeof(line));
     while (!feof(file)) {
@@ -392,6 +413,153 @@ static void save_translate_tables_8bit(const char * filename,
     saved_changes = Q_TRUE;
 }
 
+/**
+ * Sets a translate table mapping to do nothing.
+ *
+ * @param table the table to reset
+ */
+static void reset_table_unicode(struct table_unicode_struct * table) {
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        if (table->bmp[i] != NULL) {
+            Xfree(table->bmp[i], __FILE__, __LINE__);
+            table->bmp[i] = NULL;
+        }
+    }
+    if (table->astral != NULL) {
+        Xfree(table->astral, __FILE__, __LINE__);
+        table->astral = NULL;
+    }
+    table->astral_bits = 0;
+    table->astral_n = 0;
+}
+
+/**
+ * Find the hash slot for a code point above the BMP: either the slot that
+ * holds it, or the empty slot where it belongs.  Slots are empty when their
+ * key is 0, which can never be an astral code point.
+ *
+ * @param table the table to search, which must have a hash allocated
+ * @param key the mapping key
+ * @return the slot index
+ */
+static size_t unicode_table_astral_slot(
+    const struct table_unicode_struct * table, const wchar_t key) {
+
+    size_t mask = ((size_t) 1 << table->astral_bits) - 1;
+    size_t i;
+
+    i = (uint32_t) ((uint32_t) key * 0x9E3779B1U) >> (32 - table->astral_bits);
+    while ((table->astral[i].key != 0) && (table->astral[i].key != key)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * Get the value part of a Unicode mapping.
+ *
+ * @param table the table to search
+ * @param key the mapping key
+ * @return the mapping value
+ */
+static wchar_t unicode_table_get(const struct table_unicode_struct * table,
+                                 const wchar_t key) {
+    wchar_t * page;
+    size_t i;
+
+    if ((uint32_t) key < 0x10000) {
+        page = table->bmp[((uint32_t) key >> 8) & 0xFF];
+        if (page == NULL) {
+            return key;
+        }
+        return page[key & 0xFF];
+    }
+
+    if (table->astral_n == 0) {
+        return key;
+    }
+    i = unicode_table_astral_slot(table, key);
+    if (table->astral[i].key == key) {
+        return table->astral[i].value;
+    }
+
+    /*
+     * No overrides found.
+     */
+    return key;
+}
+
+/**
+ * Set a new (key, value) Unicode mapping into a table.
+ *
+ * @param table the table to modify
+ * @param key the mapping key
+ * @param value the new mapping value
+ */
+static void unicode_table_set(struct table_unicode_struct * table,
+                              const wchar_t key,
+                              const wchar_t value) {
+    struct q_wchar_tuple * old_astral;
+    size_t old_max;
+    wchar_t * page;
+    size_t i;
+    size_t j;
+
+    if ((uint32_t) key < 0x10000) {
+        page = table->bmp[((uint32_t) key >> 8) & 0xFF];
+        if (page == NULL) {
+            if (value == key) {
+                return;
+            }
+            /*
+             * First override on this page, start it as the identity.
+             */
+            page = (wchar_t *) Xmalloc(sizeof(wchar_t) * 256, __FILE__,
+                                       __LINE__);
+            for (i = 0; i < 256; i++) {
+                page[i] = (wchar_t) (((uint32_t) key & 0xFF00) | i);
+            }
+            table->bmp[((uint32_t) key >> 8) & 0xFF] = page;
+        }
+        page[key & 0xFF] = value;
+        return;
+    }
+
+    /*
+     * Keep the hash at most half full.
+     */
+    if ((table->astral_n + 1) * 2 > ((size_t) 1 << table->astral_bits)) {
+        old_astral = table->astral;
+        old_max = (table->astral_bits == 0) ? 0 :
+                  ((size_t) 1 << table->astral_bits);
+        table->astral_bits = (table->astral_bits == 0) ? 4 :
+                             table->astral_bits + 1;
+        table->astral = (struct q_wchar_tuple *) Xmalloc(
+            sizeof(struct q_wchar_tuple) * ((size_t) 1 << table->astral_bits),
+            __FILE__, __LINE__);
+        memset(table->astral, 0,
+            sizeof(struct q_wchar_tuple) * ((size_t) 1 << table->astral_bits));
+        for (j = 0; j < old_max; j++) {
+            if (old_astral[j].key != 0) {
+                i = unicode_table_astral_slot(table, old_astral[j].key);
+                table->astral[i] = old_astral[j];
+            }
+        }
+        if (old_astral != NULL) {
+            Xfree(old_astral, __FILE__, __LINE__);
+        }
+    }
+
+    i = unicode_table_astral_slot(table, key);
+    if (table->astral[i].key == 0) {
+        table->astral[i].key = key;
+        table->astral_n++;
+    }
+    table->astral[i].value = value;
+}
+
 /**
  * Load a Unicode translate table pair from a file into the global translate
  * table structs.
@@ -438,23 +606,8 @@ void load_translate_tables_unicode(const char * filename,
     /*
      * Set defaults to do no translation.
      */
-    if (table_input->mappings_n > 0) {
-        assert(table_input->mappings != NULL);
-        Xfree(table_input->mappings, __FILE__, __LINE__);
-        table_input->mappings = NULL;
-        table_input->mappings_n = 0;
-    }
-    assert(table_input->mappings == NULL);
-    assert(table_input->mappings_n == 0);
-
-    if (table_output->mappings_n > 0) {
-        assert(table_output->mappings != NULL);
-        Xfree(table_output->mappings, __FILE__, __LINE__);
-        table_output->mappings = NULL;
-        table_output->mappings_n = 0;
-    }
-    assert(table_output->mappings == NULL);
-    assert(table_output->mappings_n == 0);
+    reset_table_unicode(table_input);
+    reset_table_unicode(table_output);
 
     /*
      * Read the data file.
@@ -572,24 +725,17 @@ void load_translate_tables_unicode(const char * filename,
         }
 
         /*
-         * map_from and map_to are both valid unsigned integers
+         * map_from and map_to are both valid unsigned integers.  The first
+         * mapping for a code point wins.
          */
         if (state == SCAN_INPUT_VALUES) {
-            table_input->mappings = (struct q_wchar_tuple *) Xrealloc(
-                table_input->mappings,
-                sizeof(struct q_wchar_tuple) * (table_input->mappings_n + 1),
-                __FILE__, __LINE__);
-            table_input->mappings[table_input->mappings_n].key = map_from;
-            table_input->mappings[table_input->mappings_n].value = map_to;
-            table_input->mappings_n++;
+            if (unicode_table_get(table_input, map_from) == map_from) {
+                unicode_table_set(table_input, map_from, map_to);
+            }
         } else {
-            table_output->mappings = (struct q_wchar_tuple *) Xrealloc(
-                table_output->mappings,
-                sizeof(struct q_wchar_tuple) * (table_output->mappings_n + 1),
-                __FILE__, __LINE__);
-            table_output->mappings[table_output->mappings_n].key = map_from;
-            table_output->mappings[table_output->mappings_n].value = map_to;
-            table_output->mappings_n++;
+            if (unicode_table_get(table_output, map_from) == map_from) {
+                unicode_table_set(table_output, map_from, map_to);
+            }
         }
 
     } /* while (!feof(file)) */
@@ -603,6 +749,47 @@ void load_translate_tables_unicode(const char * filename,
     saved_changes = Q_TRUE;
 }
 
+/**
+ * Write the overrides of one Unicode translate table, in code point order.
+ *
+ * @param file the file to write to
+ * @param table the table to write
+ */
+static void save_table_unicode_section(FILE * file,
+    const struct table_unicode_struct * table) {
+
+    wchar_t * page;
+    size_t i;
+    int j;
+
+    for (i = 0; i < 256; i++) {
+        page = table->bmp[i];
+        if (page == NULL) {
+            continue;
+        }
+        for (j = 0; j < 256; j++) {
+            if (page[j] != (wchar_t) ((i << 8) | j)) {
+                fprintf(file, "\\u%04lx = \\u%04lx\n",
+                    (unsigned long) ((i << 8) | j),
+                    (unsigned long) (uint32_t) page[j]);
+            }
+        }
+    }
+
+    if (table->astral_n == 0) {
+        return;
+    }
+    for (i = 0; i < ((size_t) 1 << table->astral_bits); i++) {
+        if ((table->astral[i].key != 0) &&
+            (table->astral[i].key != table->astral[i].value)
+        ) {
+            fprintf(file, "\\u%04lx = \\u%04lx\n",
+                (unsigned long) (uint32_t) table->astral[i].key,
+                (unsigned long) (uint32_t) table->astral[i].value);
+        }
+    }
+}
+
 /**
  * Save a Unicode translate table pair to a file.
  *
@@ -617,7 +804,6 @@ static void save_translate_tables_unicode(const char * filename,
     char notify_message[DIALOG_MESSAGE_SIZE];
     char * full_filename;
     FILE * file;
-    int i;
 
     if (q_status.read_only == Q_TRUE) {
         return;
@@ -659,27 +845,13 @@ static void save_translate_tables_unicode(const char * filename,
      * Input
      */
     fprintf(file, "\n[input]\n");
-    for (i = 0; i < table_unicode_input.mappings_n; i++) {
-        if (table_unicode_input.mappings[i].key !=
-            table_unicode_input.mappings[i].value) {
-            fprintf(file, "\\u%04x = \\u%04x\n",
-                (uint16_t) table_unicode_input.mappings[i].key,
-                (uint16_t) table_unicode_input.mappings[i].value);
-        }
-    }
+    save_table_unicode_section(file, table_input);
 
     /*
      * Output
      */
     fprintf(file, "\n[output]\n");
-    for (i = 0; i < table_unicode_output.mappings_n; i++) {
-        if (table_unicode_output.mappings[i].key !=
-            table_unicode_output.mappings[i].value) {
-            fprintf(file, "\\u%04x = \\u%04x\n",
-                (uint16_t) table_unicode_output.mappings[i].key,
-                (uint16_t) table_unicode_output.mappings[i].value);
-        }
-    }
+    save_table_unicode_section(file, table_output);
 
     Xfree(full_filename, __FILE__, __LINE__);
     fclose(file);
@@ -701,20 +873,7 @@ static void reset_table_8bit(struct table_8bit_struct * table) {
     for (i = 0; i < 256; i++) {
         table->map_to[i] = i;
     }
-}
-
-/**
- * Sets a translate table mapping to do nothing.
- *
- * @param table the table to reset
- */
-static void reset_table_unicode(struct table_unicode_struct * table) {
-    if (table->mappings != NULL) {
-        assert(table->mappings_n > 0);
-        Xfree(table->mappings, __FILE__, __LINE__);
-    }
-    table->mappings = NULL;
-    table->mappings_n = 0;
+    inbound_map_stale = Q_TRUE;
 }
 
 /**
@@ -731,6 +890,7 @@ static void copy_table_8bit(struct table_8bit_struct * src,
     for (i = 0; i < 256; i++) {
         dest->map_to[i] = src->map_to[i];
     }
+    inbound_map_stale = Q_TRUE;
 }
 
 /**
@@ -741,17 +901,28 @@ static void copy_table_8bit(struct table_8bit_struct * src,
  */
 static void copy_table_unicode(struct table_unicode_struct * src,
                                struct table_unicode_struct * dest) {
+    size_t astral_size;
     int i;
 
+    if (src == dest) {
+        return;
+    }
     reset_table_unicode(dest);
-    if (src->mappings_n > 0) {
-        dest->mappings = (struct q_wchar_tuple *) Xmalloc(sizeof(
-            struct q_wchar_tuple) * (src->mappings_n), __FILE__, __LINE__);
-        for (i = 0; i < src->mappings_n; i++) {
-            dest->mappings[i].key   = src->mappings[i].key;
-            dest->mappings[i].value = src->mappings[i].value;
+    for (i = 0; i < 256; i++) {
+        if (src->bmp[i] != NULL) {
+            dest->bmp[i] = (wchar_t *) Xmalloc(sizeof(wchar_t) * 256,
+                                               __FILE__, __LINE__);
+            memcpy(dest->bmp[i], src->bmp[i], sizeof(wchar_t) * 256);
         }
-        dest->mappings_n = src->mappings_n;
+    }
+    if (src->astral != NULL) {
+        astral_size = sizeof(struct q_wchar_tuple) *
+                      ((size_t) 1 << src->astral_bits);
+        dest->astral = (struct q_wchar_tuple *) Xmalloc(astral_size,
+                                                        __FILE__, __LINE__);
+        memcpy(dest->astral, src->astral, astral_size);
+        dest->astral_bits = src->astral_bits;
+        dest->astral_n = src->astral_n;
     }
 }
 
@@ -766,6 +937,31 @@ unsigned char translate_8bit_in(const unsigned char in) {
     return table_8bit_input.map_to[in];
 }
 
+/**
+ * Get the complete mapping for bytes received from the remote side: the
+ * input table read via use_translate_table_8bit(), followed by the strip
+ * 8th bit option.  The map is rebuilt only when one of those changes.
+ *
+ * @return a 256-byte table indexed by the received byte
+ */
+const unsigned char * translate_8bit_in_map() {
+    int i;
+
+    if ((inbound_map_stale == Q_TRUE) ||
+        (inbound_map_strip != q_status.strip_8th_bit)
+    ) {
+        for (i = 0; i < 256; i++) {
+            inbound_map[i] = table_8bit_input.map_to[i];
+            if (q_status.strip_8th_bit == Q_TRUE) {
+                inbound_map[i] &= 0x7F;
+            }
+        }
+        inbound_map_strip = q_status.strip_8th_bit;
+        inbound_map_stale = Q_FALSE;
+    }
+    return inbound_map;
+}
+
 /**
  * Translate an 8-bit byte using the output table read via
  * use_translate_table_8bit().
@@ -785,19 +981,7 @@ unsigned char translate_8bit_out(const unsigned char in) {
  * @return the translated code point
  */
 wchar_t translate_unicode_in(const wchar_t in) {
-    int i = 0;
-
-    while (i < table_unicode_input.mappings_n) {
-        if (table_unicode_input.mappings[i].key == in) {
-            return table_unicode_input.mappings[i].value;
-        }
-        i++;
-    }
-
-    /*
-     * No overrides found.
-     */
-    return in;
+    return unicode_table_get(&table_unicode_input, in);
 }
 
 /**
@@ -808,74 +992,7 @@ wchar_t translate_unicode_in(const wchar_t in) {
  * @return the translated code point
  */
 wchar_t translate_unicode_out(const wchar_t in) {
-    int i = 0;
-
-    while (i < table_unicode_output.mappings_n) {
-        if (table_unicode_output.mappings[i].key == in) {
-            return table_unicode_output.mappings[i].value;
-        }
-        i++;
-    }
-
-    /*
-     * No overrides found.
-     */
-    return in;
-}
-
-/**
- * Get the value part of a Unicode mapping.
- *
- * @param table the table to search
- * @param key the mapping key
- * @return the mapping value
- */
-static wchar_t unicode_table_get(struct table_unicode_struct * table,
-                                 const wchar_t key) {
-    int i = 0;
-
-    while (i < table->mappings_n) {
-        if (table->mappings[i].key == key) {
-            return table->mappings[i].value;
-        }
-        i++;
-    }
-
-    /*
-     * No overrides found.
-     */
-    return key;
-}
-
-/**
- * Set a new (key, value) Unicode mapping into a table.
- *
- * @param table the table to modify
- * @param key the mapping key
- * @param value the new mapping value
- */
-static void unicode_table_set(struct table_unicode_struct * table,
-                              const wchar_t key,
-                              const wchar_t value) {
-    int i = 0;
-
-    while (i < table->mappings_n) {
-        if (table->mappings[i].key == key) {
-            table->mappings[i].value = value;
-            return;
-        }
-        i++;
-    }
-
-    /*
-     * No overrides found, add this one to the end.
-     */
-    table->mappings = (struct q_wchar_tuple *) Xrealloc(table->mappings,
-        sizeof(struct q_wchar_tuple) * (table->mappings_n + 1),
-        __FILE__, __LINE__);
-    table->mappings[table->mappings_n].key = key;
-    table->mappings[table->mappings_n].value = value;
-    table->mappings_n++;
+    return unicode_table_get(&table_unicode_output, in);
 }
 
 /**
@@ -1074,10 +1191,8 @@ static void create_ebcdic_file(const char * filename) {
 void initialize_translate_tables() {
     reset_table_8bit(&table_8bit_input);
     reset_table_8bit(&table_8bit_output);
-    table_unicode_input.mappings    = NULL;
-    table_unicode_input.mappings_n  = 0;
-    table_unicode_output.mappings   = NULL;
-    table_unicode_output.mappings_n = 0;
+    memset(&table_unicode_input, 0, sizeof(table_unicode_input));
+    memset(&table_unicode_output, 0, sizeof(table_unicode_output));
     reset_table_unicode(&table_unicode_input);
     reset_table_unicode(&table_unicode_output);
     use_translate_table_8bit(DEFAULT_8BIT_FILENAME);
@@ -104,6 +104,15 @@ extern void use_translate_table_unicode(const char * filename);
  */
 extern unsigned char translate_8bit_in(const unsigned char in);
 
+/**
+ * Get the complete mapping for bytes received from the remote side: the
+ * input table read via use_translate_table_8bit(), followed by the strip
+ * 8th bit option.  The map is rebuilt only when one of those changes.
+ *
+ * @return a 256-byte table indexed by the received byte
+ */
+extern const unsigned char * translate_8bit_in_map();
+
 /**
  * Translate an 8-bit byte using the output table read via
  * use_translate_table_8bit().
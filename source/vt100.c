@@ -32,6 +32,7 @@
 #include "screen.h"
 #include "options.h"
 #include "netclient.h"
+#include "session.h"
 #include "vt100.h"
 
 /* Set this to a not-NULL value to enable debug log. */
@@ -127,6 +128,55 @@ typedef enum SCAN_STATES {
  */
 static SCAN_STATE scan_state;
 
+/**
+ * Transitions that are taken from any state, before the current state gets
+ * a look at the byte.
+ */
+typedef enum {
+    ANYWHERE_NONE,              /* Left to the current state */
+    ANYWHERE_CANCEL,            /* CAN, SUB: abort the sequence */
+    ANYWHERE_DOWN_ARROW,        /* EM: down-arrow in SCAN_GROUND */
+    ANYWHERE_ESCAPE,            /* ESC, except inside a DCS string */
+    ANYWHERE_CSI,               /* 8-bit CSI */
+    ANYWHERE_OSC,               /* 8-bit OSC */
+    ANYWHERE_DCS,               /* 8-bit DCS */
+    ANYWHERE_SOSPMAPC,          /* 8-bit SOS, PM, and APC */
+    ANYWHERE_DISCARD            /* DEL */
+} ANYWHERE_ACTION;
+
+/* Bits in byte_class[] */
+#define BYTE_EXECUTE            0x01    /* C0, and C1 on VT100/VT102/VT220 */
+#define BYTE_PRINT              0x02    /* 20-7E, and A0-FF on VT220/Xterm */
+#define BYTE_UP_ARROW           0x04    /* CAN, SUB: up-arrow in SCAN_GROUND */
+
+/**
+ * The emulation that byte_class[] and friends were built for.  Everything
+ * the VT100 family variants disagree on about single bytes is folded into
+ * these tables when the emulation changes, so vt100() does not have to ask
+ * again for every byte.
+ */
+static Q_EMULATION byte_tables_emulation = Q_EMULATION_MAX;
+
+/**
+ * BYTE_EXECUTE, BYTE_PRINT, etc. for each byte.
+ */
+static unsigned char byte_class[256];
+
+/**
+ * The ANYWHERE_ACTION for each byte.
+ */
+static unsigned char byte_anywhere[256];
+
+/**
+ * 0x7F for the 7-bit emulations (VT100 and VT102), 0xFF for the rest.
+ */
+static unsigned char byte_mask = 0xFF;
+
+/**
+ * If true, decode UTF-8 before running the state machine.
+ */
+static Q_BOOL byte_utf8 = Q_FALSE;
+
 /*
  * We will support up to 16 bytes per CSI parameter, and 16 CSI parameters.
  */
@@ -641,6 +691,64 @@ void vt100_reset() {
 
 }
 
+/**
+ * The VT100 emulator state that is saved with a session.
+ */
+struct vt100_session {
+    SCAN_STATE scan_state;
+    struct vt100_state state;
+    Q_EMULATION arrow_keys;
+    Q_BOOL new_line_mode;
+    Q_BOOL is_default_color;
+    struct q_keypad_mode keypad_mode;
+    int linux_beep_frequency;
+    int linux_beep_duration;
+    XTERM_MOUSE_PROTOCOL xterm_mouse_protocol;
+    XTERM_MOUSE_ENCODING xterm_mouse_encoding;
+};
+
+/**
+ * Save or restore the VT100 emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t vt100_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct vt100_session * saved = (struct vt100_session *) buffer;
+
+    switch (op) {
+    case Q_SESSION_SAVE:
+    case Q_SESSION_RESTORE:
+        Q_SESSION_COPY(op, saved->scan_state, scan_state);
+        Q_SESSION_COPY(op, saved->state, state);
+        Q_SESSION_COPY(op, saved->arrow_keys, q_vt100_arrow_keys);
+        Q_SESSION_COPY(op, saved->new_line_mode, q_vt100_new_line_mode);
+        Q_SESSION_COPY(op, saved->is_default_color, is_default_color);
+        Q_SESSION_COPY(op, saved->keypad_mode, q_vt100_keypad_mode);
+        Q_SESSION_COPY(op, saved->linux_beep_frequency,
+                       q_linux_beep_frequency);
+        Q_SESSION_COPY(op, saved->linux_beep_duration, q_linux_beep_duration);
+        Q_SESSION_COPY(op, saved->xterm_mouse_protocol,
+                       q_xterm_mouse_protocol);
+        Q_SESSION_COPY(op, saved->xterm_mouse_encoding,
+                       q_xterm_mouse_encoding);
+        break;
+    case Q_SESSION_FREE:
+        if (state.tab_stops != NULL) {
+            Xfree(state.tab_stops, __FILE__, __LINE__);
+        }
+        /* Fall through... */
+    case Q_SESSION_DETACH:
+        state.tab_stops = NULL;
+        state.tab_stops_n = 0;
+        break;
+    case Q_SESSION_SIZE:
+        break;
+    }
+    return sizeof(struct vt100_session);
+}
+
 /**
  * Save one character into the collect buffer.
  *
@@ -1711,6 +1819,7 @@ static void decaln() {
                 scrollback_full_attr(Q_COLOR_CONSOLE_TEXT);
         }
         q_scrollback_current->length = WIDTH;
+        q_scrollback_current->dirty = Q_TRUE;
         cursor_down(1, Q_FALSE);
     }
     cursor_position(y, x);
@@ -3504,10 +3613,7 @@ static void rep() {
         if (i <= 0) {
             print_character(state.rep_ch);
         } else {
-            while (i > 0) {
-                print_character(state.rep_ch);
-                i--;
-            }
+            print_character_repeat(state.rep_ch, i);
         }
     }
 }
@@ -3645,6 +3751,106 @@ static void cht() {
     }
 }
 
+/**
+ * Build byte_class[], byte_anywhere[], byte_mask, and byte_utf8 for
+ * q_status.emulation.
+ */
+static void build_byte_tables() {
+    Q_EMULATION emulation = q_status.emulation;
+    Q_BOOL c1_execute = Q_FALSE;
+    Q_BOOL eight_bit = Q_FALSE;
+    Q_BOOL arrows = Q_FALSE;
+    int ch;
+
+    if ((emulation == Q_EMUL_VT100) ||
+        (emulation == Q_EMUL_VT102) ||
+        (emulation == Q_EMUL_VT220)
+    ) {
+        c1_execute = Q_TRUE;
+    }
+    if ((emulation == Q_EMUL_VT220) || (emulation == Q_EMUL_XTERM)) {
+        eight_bit = Q_TRUE;
+    }
+    if ((emulation == Q_EMUL_LINUX) || (emulation == Q_EMUL_XTERM)) {
+        /*
+         * CAN, SUB, and EM are arrows in 8-bit encodings.
+         */
+        arrows = Q_TRUE;
+    }
+
+    if ((emulation == Q_EMUL_VT100) || (emulation == Q_EMUL_VT102)) {
+        byte_mask = 0x7F;
+    } else {
+        byte_mask = 0xFF;
+    }
+    if ((emulation == Q_EMUL_LINUX_UTF8) || (emulation == Q_EMUL_XTERM_UTF8)) {
+        byte_utf8 = Q_TRUE;
+    } else {
+        byte_utf8 = Q_FALSE;
+    }
+
+    for (ch = 0; ch < 256; ch++) {
+        byte_class[ch] = 0;
+        byte_anywhere[ch] = ANYWHERE_NONE;
+
+        if ((ch <= 0x1F) ||
+            ((c1_execute == Q_TRUE) && (ch >= 0x80) && (ch <= 0x9F))
+        ) {
+            byte_class[ch] |= BYTE_EXECUTE;
+        }
+        if (((ch >= 0x20) && (ch <= 0x7E)) ||
+            ((eight_bit == Q_TRUE) && (ch >= 0xA0))
+        ) {
+            byte_class[ch] |= BYTE_PRINT;
+        }
+
+        switch (ch) {
+        case 0x18:
+        case 0x1A:
+            byte_anywhere[ch] = ANYWHERE_CANCEL;
+            if (arrows == Q_TRUE) {
+                byte_class[ch] |= BYTE_UP_ARROW;
+            }
+            break;
+        case 0x19:
+            if (arrows == Q_TRUE) {
+                byte_anywhere[ch] = ANYWHERE_DOWN_ARROW;
+            }
+            break;
+        case C_ESC:
+            byte_anywhere[ch] = ANYWHERE_ESCAPE;
+            break;
+        case 0x7F:
+            byte_anywhere[ch] = ANYWHERE_DISCARD;
+            break;
+        case 0x9B:
+            if (eight_bit == Q_TRUE) {
+                byte_anywhere[ch] = ANYWHERE_CSI;
+            }
+            break;
+        case 0x9D:
+            if (eight_bit == Q_TRUE) {
+                byte_anywhere[ch] = ANYWHERE_OSC;
+            }
+            break;
+        case 0x90:
+            if (eight_bit == Q_TRUE) {
+                byte_anywhere[ch] = ANYWHERE_DCS;
+            }
+            break;
+        case 0x98:
+        case 0x9E:
+        case 0x9F:
+            if (eight_bit == Q_TRUE) {
+                byte_anywhere[ch] = ANYWHERE_SOSPMAPC;
+            }
+            break;
+        }
+    }
+
+    byte_tables_emulation = emulation;
+}
+
 /**
  * Push one byte through the VT100, VT102, VT220, LINUX, L_UTF8, XTERM, or
  * X_UTF8 emulator.
@@ -3664,25 +3870,31 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     DLOG(("STATE: %d CHAR: 0x%02x '%c' UTF-8: %d\n", scan_state, from_modem,
             from_modem, state.utf8_state));
 
-    /* Special case for VT10x: 7-bit characters only */
-    if ((q_status.emulation == Q_EMUL_VT100) ||
-        (q_status.emulation == Q_EMUL_VT102)
-    ) {
-        from_modem = from_modem1 & 0x7F;
-    } else {
-        from_modem = from_modem1;
+    if (q_status.emulation != byte_tables_emulation) {
+        build_byte_tables();
     }
 
+    /* Special case for VT10x: 7-bit characters only */
+    from_modem = from_modem1 & byte_mask;
+
     /*
      * Perform UTF-8 decode as needed.  We will save the UTF-8 character to
      * state.utf8_char now, yet run the rest of the state machine against
      * from_modem.  If from_modem doesn't cause a state change that sets
      * discard, then we had a printable UTF-8 character that will be emitted
      * at the very end.
+     *
+     * Between sequences an ASCII byte always decodes to itself, so most
+     * text skips the decoder entirely.  Anything else, including ASCII that
+     * interrupts a multibyte sequence, goes through utf8_decode() so that
+     * malformed input is dropped exactly as before.
      */
-    if ((q_status.emulation == Q_EMUL_LINUX_UTF8) ||
-        (q_status.emulation == Q_EMUL_XTERM_UTF8)
+    if ((byte_utf8 == Q_TRUE) &&
+        (from_modem < 0x80) &&
+        (state.utf8_state == UTF8_ACCEPT)
     ) {
+        state.utf8_char = from_modem;
+    } else if (byte_utf8 == Q_TRUE) {
         /*
         DLOG(("    UTF-8: decode before VTxxx state: %d\n", state.utf8_state));
          */
@@ -3714,13 +3926,33 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
 
     }
 
+    /*
+     * Printable characters in SCAN_GROUND are by far the most common, and
+     * nothing below treats them differently.
+     */
+    if ((scan_state == SCAN_GROUND) &&
+        (byte_class[from_modem] & BYTE_PRINT) &&
+        (state.printer_controller_mode == Q_FALSE)
+    ) {
+        *to_screen = map_character(from_modem);
+
+#ifdef DEBUG_VT100_VERBOSE
+        render_screen_to_debug_file(dlogfile);
+#endif
+
+        state.rep_ch = *to_screen;
+        return Q_EMUL_FSM_ONE_CHAR;
+    }
+
     /* Special "anywhere" states */
+    switch (byte_anywhere[from_modem]) {
+    case ANYWHERE_NONE:
+        break;
 
-    /* 18, 1A --> execute, then switch to SCAN_GROUND */
-    if ((from_modem == 0x18) || (from_modem == 0x1A)) {
+    case ANYWHERE_CANCEL:
+        /* 18, 1A --> execute, then switch to SCAN_GROUND */
         if ((scan_state == SCAN_GROUND) &&
-            ((q_status.emulation == Q_EMUL_LINUX) ||
-                (q_status.emulation == Q_EMUL_XTERM))
+            (byte_class[from_modem] & BYTE_UP_ARROW)
         ) {
             /*
              * CAN aborts an escape sequence, but it is also used as up-arrow
@@ -3733,76 +3965,60 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
             scan_state = SCAN_GROUND;
         }
         discard = Q_TRUE;
-    }
-
-    /* 19 --> printable */
-    if ((from_modem == 0x19) &&
-        (scan_state == SCAN_GROUND) &&
-        ((q_status.emulation == Q_EMUL_LINUX) ||
-            (q_status.emulation == Q_EMUL_XTERM))
-    ) {
-        /*
-         * EM is down-arrow for 8-bit encodings.
-         */
-        print_character(cp437_chars[DOWNARROW]);
-        discard = Q_TRUE;
-    }
+        break;
 
-    /* 80-8F, 91-97, 99, 9A, 9C --> execute, then switch to SCAN_GROUND */
+    case ANYWHERE_DOWN_ARROW:
+        /* 19 --> printable */
+        if (scan_state == SCAN_GROUND) {
+            /*
+             * EM is down-arrow for 8-bit encodings.
+             */
+            print_character(cp437_chars[DOWNARROW]);
+            discard = Q_TRUE;
+        }
+        break;
 
-    /* 0x1B == C_ESC */
-    if ((from_modem == C_ESC) &&
-        (scan_state != SCAN_DCS_ENTRY) &&
-        (scan_state != SCAN_DCS_INTERMEDIATE) &&
-        (scan_state != SCAN_DCS_IGNORE) &&
-        (scan_state != SCAN_DCS_PARAM) &&
-        (scan_state != SCAN_DCS_PASSTHROUGH)
-    ) {
-        scan_state = SCAN_ESCAPE;
-        discard = Q_TRUE;
-    }
+    case ANYWHERE_ESCAPE:
+        /* 0x1B == C_ESC */
+        if ((scan_state != SCAN_DCS_ENTRY) &&
+            (scan_state != SCAN_DCS_INTERMEDIATE) &&
+            (scan_state != SCAN_DCS_IGNORE) &&
+            (scan_state != SCAN_DCS_PARAM) &&
+            (scan_state != SCAN_DCS_PASSTHROUGH)
+        ) {
+            scan_state = SCAN_ESCAPE;
+            discard = Q_TRUE;
+        }
+        break;
 
-    /* 0x9B == CSI 8-bit sequence */
-    if ((from_modem == 0x9B) &&
-        ((q_status.emulation == Q_EMUL_VT220) ||
-            (q_status.emulation == Q_EMUL_XTERM))
-    ) {
+    case ANYWHERE_CSI:
+        /* 0x9B == CSI 8-bit sequence */
         scan_state = SCAN_CSI_ENTRY;
         discard = Q_TRUE;
-    }
+        break;
 
-    /* 0x9D goes to SCAN_OSC_STRING */
-    if ((from_modem == 0x9D) &&
-        ((q_status.emulation == Q_EMUL_VT220) ||
-            (q_status.emulation == Q_EMUL_XTERM))
-    ) {
+    case ANYWHERE_OSC:
+        /* 0x9D goes to SCAN_OSC_STRING */
         scan_state = SCAN_OSC_STRING;
         discard = Q_TRUE;
-    }
+        break;
 
-    /* 0x90 goes to SCAN_DCS_ENTRY */
-    if ((from_modem == 0x90) &&
-        ((q_status.emulation == Q_EMUL_VT220) ||
-            (q_status.emulation == Q_EMUL_XTERM))
-    ) {
+    case ANYWHERE_DCS:
+        /* 0x90 goes to SCAN_DCS_ENTRY */
         scan_state = SCAN_DCS_ENTRY;
         discard = Q_TRUE;
-    }
+        break;
 
-    /* 0x98, 0x9E, and 0x9F go to SCAN_SOSPMAPC_STRING */
-    if (((from_modem == 0x98) ||
-            (from_modem == 0x9E) ||
-            (from_modem == 0x9F)) &&
-        ((q_status.emulation == Q_EMUL_VT220) ||
-            (q_status.emulation == Q_EMUL_XTERM))
-    ) {
+    case ANYWHERE_SOSPMAPC:
+        /* 0x98, 0x9E, and 0x9F go to SCAN_SOSPMAPC_STRING */
         scan_state = SCAN_SOSPMAPC_STRING;
         discard = Q_TRUE;
-    }
+        break;
 
-    /* 0x7F (DEL) is always discarded */
-    if (from_modem == 0x7F) {
+    case ANYWHERE_DISCARD:
+        /* 0x7F (DEL) is always discarded */
         discard = Q_TRUE;
+        break;
     }
 
     /* If the character has been consumed, exit. */
@@ -3816,12 +4032,7 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     case SCAN_GROUND:
         /* 00-17, 19, 1C-1F --> execute */
         /* 80-8F, 91-9A, 9C --> execute (VTxxx only) */
-        if ((from_modem <= 0x1F) ||
-            (((q_status.emulation == Q_EMUL_VT100) ||
-                (q_status.emulation == Q_EMUL_VT102) ||
-                (q_status.emulation == Q_EMUL_VT220)) &&
-                (from_modem >= 0x80) && (from_modem <= 0x9F))
-        ) {
+        if (byte_class[from_modem] & BYTE_EXECUTE) {
             handle_control_char(from_modem);
             discard = Q_TRUE;
             break;
@@ -3877,12 +4088,7 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     case SCAN_ESCAPE:
         /* 00-17, 19, 1C-1F --> execute */
         /* 80-8F, 91-9A, 9C --> execute (VTxxx only) */
-        if ((from_modem <= 0x1F) ||
-            (((q_status.emulation == Q_EMUL_VT100) ||
-                (q_status.emulation == Q_EMUL_VT102) ||
-                (q_status.emulation == Q_EMUL_VT220)) &&
-                (from_modem >= 0x80) && (from_modem <= 0x9F))
-        ) {
+        if (byte_class[from_modem] & BYTE_EXECUTE) {
             handle_control_char(from_modem);
             discard = Q_TRUE;
             break;
@@ -4327,12 +4533,7 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     case SCAN_ESCAPE_INTERMEDIATE:
         /* 00-17, 19, 1C-1F --> execute */
         /* 80-8F, 91-9A, 9C --> execute (VTxxx only) */
-        if ((from_modem <= 0x1F) ||
-            (((q_status.emulation == Q_EMUL_VT100) ||
-                (q_status.emulation == Q_EMUL_VT102) ||
-                (q_status.emulation == Q_EMUL_VT220)) &&
-                (from_modem >= 0x80) && (from_modem <= 0x9F))
-        ) {
+        if (byte_class[from_modem] & BYTE_EXECUTE) {
             handle_control_char(from_modem);
             discard = Q_TRUE;
             break;
@@ -4984,12 +5185,7 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     case SCAN_CSI_ENTRY:
         /* 00-17, 19, 1C-1F --> execute */
         /* 80-8F, 91-9A, 9C --> execute (VTxxx only) */
-        if ((from_modem <= 0x1F) ||
-            (((q_status.emulation == Q_EMUL_VT100) ||
-                (q_status.emulation == Q_EMUL_VT102) ||
-                (q_status.emulation == Q_EMUL_VT220)) &&
-                (from_modem >= 0x80) && (from_modem <= 0x9F))
-        ) {
+        if (byte_class[from_modem] & BYTE_EXECUTE) {
             handle_control_char(from_modem);
             discard = Q_TRUE;
             break;
@@ -5351,12 +5547,7 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     case SCAN_CSI_PARAM:
         /* 00-17, 19, 1C-1F --> execute */
         /* 80-8F, 91-9A, 9C --> execute (VTxxx only) */
-        if ((from_modem <= 0x1F) ||
-            (((q_status.emulation == Q_EMUL_VT100) ||
-                (q_status.emulation == Q_EMUL_VT102) ||
-                (q_status.emulation == Q_EMUL_VT220)) &&
-                (from_modem >= 0x80) && (from_modem <= 0x9F))
-        ) {
+        if (byte_class[from_modem] & BYTE_EXECUTE) {
             handle_control_char(from_modem);
             discard = Q_TRUE;
             break;
@@ -5706,12 +5897,7 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     case SCAN_CSI_INTERMEDIATE:
         /* 00-17, 19, 1C-1F --> execute */
         /* 80-8F, 91-9A, 9C --> execute (VTxxx only) */
-        if ((from_modem <= 0x1F) ||
-            (((q_status.emulation == Q_EMUL_VT100) ||
-                (q_status.emulation == Q_EMUL_VT102) ||
-                (q_status.emulation == Q_EMUL_VT220)) &&
-                (from_modem >= 0x80) && (from_modem <= 0x9F))
-        ) {
+        if (byte_class[from_modem] & BYTE_EXECUTE) {
             handle_control_char(from_modem);
             discard = Q_TRUE;
             break;
@@ -5842,12 +6028,7 @@ Q_EMULATION_STATUS vt100(const unsigned char from_modem1, wchar_t * to_screen) {
     case SCAN_CSI_IGNORE:
         /* 00-17, 19, 1C-1F --> execute */
         /* 80-8F, 91-9A, 9C --> execute (VTxxx only) */
-        if ((from_modem <= 0x1F) ||
-            (((q_status.emulation == Q_EMUL_VT100) ||
-                (q_status.emulation == Q_EMUL_VT102) ||
-                (q_status.emulation == Q_EMUL_VT220)) &&
-                (from_modem >= 0x80) && (from_modem <= 0x9F))
-        ) {
+        if (byte_class[from_modem] & BYTE_EXECUTE) {
             handle_control_char(from_modem);
             discard = Q_TRUE;
             break;
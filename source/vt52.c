@@ -23,6 +23,7 @@
 #include "screen.h"
 #include "ansi.h"
 #include "netclient.h"
+#include "session.h"
 #include "vt52.h"
 
 /**
@@ -63,6 +64,34 @@ void vt52_reset() {
     DLOG(("vt52_reset()\n"));
 }
 
+/**
+ * The VT52 emulator state that is saved with a session.
+ */
+struct vt52_session {
+    SCAN_STATE scan_state;
+    Q_BOOL graphics_mode;
+    Q_BOOL alternate_keypad_mode;
+};
+
+/**
+ * Save or restore the VT52 emulator state.
+ *
+ * @param buffer the saved session buffer
+ * @param op the operation to perform
+ * @return the size of the saved state
+ */
+size_t vt52_session_state(void * buffer, const Q_SESSION_OP op) {
+    struct vt52_session * saved = (struct vt52_session *) buffer;
+
+    if ((op == Q_SESSION_SAVE) || (op == Q_SESSION_RESTORE)) {
+        Q_SESSION_COPY(op, saved->scan_state, scan_state);
+        Q_SESSION_COPY(op, saved->graphics_mode, graphics_mode);
+        Q_SESSION_COPY(op, saved->alternate_keypad_mode,
+                       q_vt52_alternate_keypad_mode);
+    }
+    return sizeof(struct vt52_session);
+}
+
 /**
  * Reset the scan state for a new sequence.
  *
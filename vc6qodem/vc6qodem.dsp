@@ -106,6 +106,10 @@ SOURCE=..\source\avatar.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\source\batch.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\source\codepage.c
 # End Source File
 # Begin Source File
@@ -194,6 +198,10 @@ SOURCE=..\build\win32\resources.rc
 # End Source File
 # Begin Source File
 
+SOURCE=..\source\replay.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\source\screen.c
 # End Source File
 # Begin Source File
@@ -206,6 +214,10 @@ SOURCE=..\source\scrollback.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\source\session.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\source\states.c
 # End Source File
 # Begin Source File
@@ -246,6 +258,10 @@ SOURCE=..\source\avatar.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\source\batch.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\source\codepage.h
 # End Source File
 # Begin Source File
@@ -334,6 +350,10 @@ SOURCE=..\source\qodem.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\source\replay.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\source\screen.h
 # End Source File
 # Begin Source File
@@ -346,6 +366,10 @@ SOURCE=..\source\scrollback.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\source\session.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\source\states.h
 # End Source File
 # Begin Source File